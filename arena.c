@@ -0,0 +1,124 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "./include/arena.h"
+
+struct _ArenaBlock
+{
+  ArenaBlock *next;
+  size_t size;
+  size_t used;
+};
+
+#define BLOCK_HEADER                                                          \
+  ((sizeof (ArenaBlock) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+void
+arena_init (Arena *arena, size_t budget)
+{
+  arena->blocks = NULL;
+  arena->reserved = 0;
+  arena->used = 0;
+  arena->budget = budget;
+}
+
+static ArenaBlock *
+arena_grow (Arena *arena, size_t size)
+{
+  if (arena->budget != 0
+      && (size > arena->budget || arena->reserved > arena->budget - size))
+    {
+      fprintf (stderr, "Per-file memory budget of %zu bytes exceeded.\n",
+               arena->budget);
+      return NULL;
+    }
+
+  ArenaBlock *block = malloc (BLOCK_HEADER + size);
+  if (block == NULL)
+    {
+      fprintf (stderr, "Failed to allocate memory.\n");
+      return NULL;
+    }
+
+  block->next = arena->blocks;
+  block->size = size;
+  block->used = 0;
+  arena->blocks = block;
+  arena->reserved += size;
+
+  return block;
+}
+
+// ARENA_ALIGN aligned; NULL when out of memory or over the budget
+void *
+arena_alloc (Arena *arena, size_t size)
+{
+  if (size > SIZE_MAX - BLOCK_HEADER - ARENA_ALIGN)
+    {
+      fprintf (stderr, "Failed to allocate memory.\n");
+      return NULL;
+    }
+
+  size = size ? (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1)
+              : ARENA_ALIGN;
+
+  ArenaBlock *block = arena->blocks;
+  if (block == NULL || block->size - block->used < size)
+    {
+      // blocks double so a file with many tables needs only a few, but
+      // never past what the budget has left
+      size_t want = block != NULL ? block->size * 2 : ARENA_BLOCK_SIZE;
+      if (want < size)
+        want = size;
+      if (arena->budget != 0 && arena->reserved <= arena->budget
+          && want > arena->budget - arena->reserved
+          && size <= arena->budget - arena->reserved)
+        want = arena->budget - arena->reserved;
+
+      block = arena_grow (arena, want);
+      if (block == NULL)
+        return NULL;
+    }
+
+  void *p = (char *)block + BLOCK_HEADER + block->used;
+  block->used += size;
+  arena->used += size;
+
+  return p;
+}
+
+static void
+free_blocks (Arena *arena)
+{
+  while (arena->blocks != NULL)
+    {
+      ArenaBlock *next = arena->blocks->next;
+      free (arena->blocks);
+      arena->blocks = next;
+    }
+  arena->reserved = 0;
+}
+
+void
+arena_reset (Arena *arena)
+{
+  if (arena->blocks != NULL && arena->blocks->next != NULL)
+    {
+      size_t need = arena->used > ARENA_BLOCK_SIZE ? arena->used
+                                                   : ARENA_BLOCK_SIZE;
+      free_blocks (arena);
+      arena_grow (arena, need);
+    }
+  else if (arena->blocks != NULL)
+    arena->blocks->used = 0;
+
+  arena->used = 0;
+}
+
+void
+arena_release (Arena *arena)
+{
+  free_blocks (arena);
+  arena->used = 0;
+}
@@ -0,0 +1,317 @@
+/* bench_lookup.c
+ * Compares the generated perfect-hash tables against the switch
+ * statements they replaced, on the same stream of section/segment types
+ * fed once in sorted order (perfectly predictable) and once shuffled.
+ * usage:
+ * $ make bench-lookup
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#ifdef __APPLE__
+#include <libelf/libelf.h>
+#elif __linux__
+#include <libelf.h>
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/elf_android.h"
+#include "../include/p_type_perfect.h"
+#include "../include/s_type_perfect.h"
+
+#define NLOOKUPS (1 << 20)
+#define ROUNDS 20
+
+// the switch get_s_type_index() used before the tables were generated
+static int __attribute__ ((noinline))
+s_type_switch (Elf64_Word type)
+{
+  switch (type)
+    {
+    case SHT_PROGBITS:
+      return 1;
+    case SHT_SYMTAB:
+      return 2;
+    case SHT_STRTAB:
+      return 3;
+    case SHT_RELA:
+      return 4;
+    case SHT_HASH:
+      return 5;
+    case SHT_DYNAMIC:
+      return 6;
+    case SHT_NOTE:
+      return 7;
+    case SHT_NOBITS:
+      return 8;
+    case SHT_REL:
+      return 9;
+    case SHT_SHLIB:
+      return 10;
+    case SHT_DYNSYM:
+      return 11;
+    case SHT_INIT_ARRAY:
+      return 12;
+    case SHT_FINI_ARRAY:
+      return 13;
+    case SHT_PREINIT_ARRAY:
+      return 14;
+    case SHT_GROUP:
+      return 15;
+    case SHT_SYMTAB_SHNDX:
+      return 16;
+    case SHT_NUM:
+      return 17;
+    case SHT_LOOS:
+      return 18;
+    case SHT_GNU_ATTRIBUTES:
+      return 19;
+    case SHT_GNU_HASH:
+      return 20;
+    case SHT_GNU_LIBLIST:
+      return 21;
+    case SHT_CHECKSUM:
+      return 22;
+    case SHT_LOSUNW:
+      return 23;
+    case SHT_SUNW_COMDAT:
+      return 24;
+    case SHT_SUNW_syminfo:
+      return 25;
+    case SHT_GNU_verdef:
+      return 26;
+    case SHT_GNU_verneed:
+      return 27;
+    case SHT_GNU_versym:
+      return 28;
+    case SHT_LOPROC:
+      return 29;
+    case SHT_HIPROC:
+      return 30;
+    case SHT_LOUSER:
+      return 31;
+    case SHT_HIUSER:
+      return 32;
+    case SHT_RELR:
+      return 33;
+    case SHT_ANDROID_REL:
+      return 34;
+    case SHT_ANDROID_RELA:
+      return 35;
+    case SHT_ANDROID_RELR:
+      return 36;
+    default:
+      return 0;
+    }
+}
+
+static int __attribute__ ((noinline)) s_type_perfect_hash (Elf64_Word type)
+{
+  return s_type_lookup (type);
+}
+
+static const char *__attribute__ ((noinline)) p_type_switch (uint32_t p_type)
+{
+  switch (p_type)
+    {
+    case PT_NULL:
+      return "NULL";
+    case PT_LOAD:
+      return "LOAD";
+    case PT_DYNAMIC:
+      return "DYNAMIC";
+    case PT_INTERP:
+      return "INTERP";
+    case PT_NOTE:
+      return "NOTE";
+    case PT_SHLIB:
+      return "SHLIB";
+    case PT_PHDR:
+      return "PHDR";
+    case PT_TLS:
+      return "TLS";
+    case PT_NUM:
+      return "NUM";
+    case PT_LOOS:
+      return "LOOS";
+    case PT_GNU_EH_FRAME:
+      return "GNU_EH_FRAME";
+    case PT_GNU_STACK:
+      return "GNU_STACK";
+    case PT_GNU_RELRO:
+      return "GNU_RELRO";
+    case PT_GNU_PROPERTY:
+      return "GNU_PROPERTY";
+    case 0x6474e554:
+      return "GNU_SFRAME";
+    case PT_LOSUNW:
+      return "LOSUNW";
+    case PT_SUNWSTACK:
+      return "SUNWSTACK";
+    case PT_HIOS:
+      return "HIOS";
+    case PT_LOPROC:
+      return "LOPROC";
+    case PT_HIPROC:
+      return "HIPROC";
+    default:
+      return "UNKNOWN";
+    }
+}
+
+static const char *__attribute__ ((noinline))
+p_type_perfect_hash (uint32_t p_type)
+{
+  return p_type_lookup (p_type);
+}
+
+static const uint32_t section_types[]
+    = { SHT_PROGBITS,   SHT_PROGBITS,    SHT_PROGBITS,      SHT_RELA,
+        SHT_RELA,       SHT_NOBITS,      SHT_STRTAB,        SHT_SYMTAB,
+        SHT_NOTE,       SHT_DYNSYM,      SHT_GNU_HASH,      SHT_GNU_versym,
+        SHT_GNU_verneed, SHT_INIT_ARRAY, SHT_FINI_ARRAY,    SHT_DYNAMIC,
+        SHT_GROUP,      SHT_REL,         SHT_X86_64_UNWIND, 0x12345678 };
+
+static const uint32_t segment_types[]
+    = { PT_LOAD,      PT_LOAD,      PT_LOAD,         PT_LOAD,
+        PT_PHDR,      PT_INTERP,    PT_DYNAMIC,      PT_NOTE,
+        PT_TLS,       PT_GNU_STACK, PT_GNU_EH_FRAME, PT_GNU_RELRO,
+        PT_GNU_PROPERTY, 0x6474e554, 0x70000001,     PT_NULL };
+
+static double
+now_ns (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int
+compare_u32 (const void *a, const void *b)
+{
+  uint32_t x = *(const uint32_t *)a;
+  uint32_t y = *(const uint32_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+static void
+fill_keys (uint32_t *keys, const uint32_t *pool, size_t npool, int shuffled)
+{
+  uint32_t state = 12345;
+
+  for (size_t i = 0; i < NLOOKUPS; i++)
+    {
+      state = state * 1103515245 + 12345;
+      keys[i] = pool[(state >> 8) % npool];
+    }
+
+  if (!shuffled)
+    qsort (keys, NLOOKUPS, sizeof (uint32_t), compare_u32);
+}
+
+static double
+time_int (int (*fn) (Elf64_Word), const uint32_t *keys, long *sink)
+{
+  double best = 1e300;
+
+  for (int r = 0; r < ROUNDS; r++)
+    {
+      long sum = 0;
+      double t0 = now_ns ();
+      for (size_t i = 0; i < NLOOKUPS; i++)
+        sum += fn (keys[i]);
+      double t = now_ns () - t0;
+      *sink += sum;
+      if (t < best)
+        best = t;
+    }
+
+  return best / NLOOKUPS;
+}
+
+static double
+time_str (const char *(*fn) (uint32_t), const uint32_t *keys, long *sink)
+{
+  double best = 1e300;
+
+  for (int r = 0; r < ROUNDS; r++)
+    {
+      long sum = 0;
+      double t0 = now_ns ();
+      for (size_t i = 0; i < NLOOKUPS; i++)
+        sum += fn (keys[i])[0];
+      double t = now_ns () - t0;
+      *sink += sum;
+      if (t < best)
+        best = t;
+    }
+
+  return best / NLOOKUPS;
+}
+
+int
+main (void)
+{
+  uint32_t *keys = malloc (NLOOKUPS * sizeof (uint32_t));
+  long sink = 0;
+
+  if (keys == NULL)
+    return 1;
+
+  // both implementations must agree before their speed means anything
+  for (uint64_t v = 0; v <= 0xffffffffu; v += 0x10001)
+    if (s_type_switch ((uint32_t)v) != s_type_lookup ((uint32_t)v)
+        || strcmp (p_type_switch ((uint32_t)v), p_type_lookup ((uint32_t)v)))
+      {
+        fprintf (stderr, "mismatch at 0x%08x\n", (unsigned)v);
+        return 1;
+      }
+  for (size_t i = 0; i < sizeof (section_types) / sizeof (uint32_t); i++)
+    if (s_type_switch (section_types[i]) != s_type_lookup (section_types[i]))
+      return 1;
+  for (size_t i = 0; i < sizeof (segment_types) / sizeof (uint32_t); i++)
+    if (strcmp (p_type_switch (segment_types[i]),
+                p_type_lookup (segment_types[i])))
+      return 1;
+
+  printf ("%-22s %12s %12s\n", "ns/lookup", "sorted", "shuffled");
+
+  double sorted, shuffled;
+  size_t nsec = sizeof (section_types) / sizeof (uint32_t);
+  size_t nseg = sizeof (segment_types) / sizeof (uint32_t);
+
+  fill_keys (keys, section_types, nsec, 0);
+  sorted = time_int (s_type_switch, keys, &sink);
+  fill_keys (keys, section_types, nsec, 1);
+  shuffled = time_int (s_type_switch, keys, &sink);
+  printf ("%-22s %12.3f %12.3f\n", "s_type switch", sorted, shuffled);
+
+  fill_keys (keys, section_types, nsec, 0);
+  sorted = time_int (s_type_perfect_hash, keys, &sink);
+  fill_keys (keys, section_types, nsec, 1);
+  shuffled = time_int (s_type_perfect_hash, keys, &sink);
+  printf ("%-22s %12.3f %12.3f\n", "s_type perfect hash", sorted, shuffled);
+
+  fill_keys (keys, segment_types, nseg, 0);
+  sorted = time_str (p_type_switch, keys, &sink);
+  fill_keys (keys, segment_types, nseg, 1);
+  shuffled = time_str (p_type_switch, keys, &sink);
+  printf ("%-22s %12.3f %12.3f\n", "p_type switch", sorted, shuffled);
+
+  fill_keys (keys, segment_types, nseg, 0);
+  sorted = time_str (p_type_perfect_hash, keys, &sink);
+  fill_keys (keys, segment_types, nseg, 1);
+  shuffled = time_str (p_type_perfect_hash, keys, &sink);
+  printf ("%-22s %12.3f %12.3f\n", "p_type perfect hash", sorted, shuffled);
+
+  printf ("(%d lookups per run, best of %d; checksum %ld)\n", NLOOKUPS,
+          ROUNDS, sink);
+
+  free (keys);
+  return 0;
+}
@@ -0,0 +1,362 @@
+/* bench_parse.c
+ * Times each stage of reading one ELF file: the header, the section
+ * headers, symbol decoding, relocation decoding with its summary, the
+ * string table index, and the text output of -e -s.  Each stage reports
+ * the entries it covered, the best time per entry over ROUNDS runs, and
+ * the rate through the bytes that stage reads (or, for output, writes).
+ * usage:
+ * $ make bench
+ * $ ./bench/bench_parse file...
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#ifdef __APPLE__
+#include <libelf/libelf.h>
+#elif __linux__
+#include <libelf.h>
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/arena.h"
+#include "../include/elf_controller.h"
+#include "../include/elf_image.h"
+#include "../include/fileio.h"
+#include "../include/my_elf.h"
+#include "../include/outbuf.h"
+#include "../include/reloc.h"
+#include "../include/strtab.h"
+#include "../include/symtab.h"
+
+#define ROUNDS 10
+
+// the header is too quick to time alone
+#define HEADER_REPEAT 4096
+
+typedef struct
+{
+  const char *name;
+  size_t entries;
+  size_t bytes;
+  double best_ns;
+} StageResult;
+
+static double
+now_ns (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void
+report (const StageResult *r)
+{
+  double per_entry = r->entries ? r->best_ns / r->entries : 0;
+  double mb_per_s = r->best_ns > 0 ? r->bytes / r->best_ns * 1e3 : 0;
+
+  printf ("%-22s %12zu %12.2f %12.1f\n", r->name, r->entries, per_entry,
+          mb_per_s);
+}
+
+static int
+bench_header (const FileContents *file, StageResult *r, long *sink)
+{
+  r->name = "header";
+  r->entries = HEADER_REPEAT;
+  r->bytes = HEADER_REPEAT * sizeof (Elf64_Ehdr);
+  r->best_ns = 1e300;
+
+  for (int round = 0; round < ROUNDS; round++)
+    {
+      double t0 = now_ns ();
+      for (int i = 0; i < HEADER_REPEAT; i++)
+        {
+          Elf64_Ehdr ehdr;
+          ElfCounts counts;
+          if (get_elf_header (file->buffer, file->length, &ehdr) != 0
+              || get_elf_counts (file->buffer, file->length, &ehdr, &counts)
+                     != 0)
+            return -1;
+          *sink += counts.shnum;
+        }
+      double t = now_ns () - t0;
+      if (t < r->best_ns)
+        r->best_ns = t;
+    }
+
+  return 0;
+}
+
+// validation, section views and section names, as at open
+static int
+bench_sections (FileContents *file, StageResult *r, long *sink)
+{
+  Arena arena;
+  ElfImage image;
+  int retval = -1;
+
+  arena_init (&arena, 0);
+  r->name = "sections";
+  r->best_ns = 1e300;
+
+  for (int round = 0; round < ROUNDS; round++)
+    {
+      arena_reset (&arena);
+      double t0 = now_ns ();
+      if (elf_image_init (&image, file, &arena) != 0)
+        goto clean;
+      double t = now_ns () - t0;
+      if (t < r->best_ns)
+        r->best_ns = t;
+      *sink += image.name_offsets[image.shdrs.count / 2];
+    }
+
+  r->entries = image.shdrs.count;
+  r->bytes = image.shdrs.count * image.layout->shdr_size
+             + image.shstrtab_size;
+  retval = 0;
+
+clean:
+  arena_release (&arena);
+  return retval;
+}
+
+static int
+bench_symbols (ElfImage *image, StageResult *r, long *sink)
+{
+  long section = find_symbol_section (image, SHT_SYMTAB);
+  if (section < 0)
+    section = find_symbol_section (image, SHT_DYNSYM);
+  if (section < 0)
+    return 1;
+
+  // columns go to a scratch arena reset every round, so the image's own
+  // arena does not grow with the number of rounds
+  Arena *image_arena = image->arena;
+  Arena scratch;
+  SymbolStore store;
+  int retval = -1;
+
+  arena_init (&scratch, 0);
+  image->arena = &scratch;
+  r->name = "symbols";
+  r->best_ns = 1e300;
+
+  for (int round = 0; round < ROUNDS; round++)
+    {
+      arena_reset (&scratch);
+      double t0 = now_ns ();
+      if (symstore_load (&store, image, (size_t)section) != 0)
+        goto clean;
+      double t = now_ns () - t0;
+      if (t < r->best_ns)
+        r->best_ns = t;
+      *sink += store.count ? store.value[store.count - 1] : 0;
+    }
+
+  r->entries = store.count;
+  r->bytes = store.count * image->layout->sym_size;
+  retval = 0;
+
+clean:
+  image->arena = image_arena;
+  arena_release (&scratch);
+  return retval;
+}
+
+// every SHT_REL and SHT_RELA table decoded into columns and summarized
+static int
+bench_relocations (ElfImage *image, StageResult *r, long *sink)
+{
+  // as for symbols, the columns go to a scratch arena reset every round
+  Arena *image_arena = image->arena;
+  Arena scratch;
+  int retval = -1;
+
+  arena_init (&scratch, 0);
+  image->arena = &scratch;
+  r->name = "relocations";
+  r->entries = 0;
+  r->bytes = 0;
+  r->best_ns = 1e300;
+
+  for (int round = 0; round < ROUNDS; round++)
+    {
+      RelocSummary summary;
+      arena_reset (&scratch);
+      image->relocs = NULL;
+      double t0 = now_ns ();
+      RelocSet *set = elf_image_relocs (image);
+      if (set == NULL || reloc_summarize (image, set, 0, &summary) != 0)
+        goto clean;
+      double t = now_ns () - t0;
+      if (t < r->best_ns)
+        r->best_ns = t;
+      *sink += summary.ntypes + summary.tables;
+      r->entries = summary.entries;
+      reloc_summary_free (&summary);
+
+      r->bytes = 0;
+      for (size_t t = 0; t < set->ntables; t++)
+        {
+          Elf64_Shdr scratch_shdr;
+          const Elf64_Shdr *sh
+              = elf_image_shdr (image, set->tables[t].section, &scratch_shdr);
+          r->bytes += sh->sh_size;
+        }
+    }
+
+  retval = r->entries == 0;
+
+clean:
+  image->relocs = NULL;
+  image->arena = image_arena;
+  arena_release (&scratch);
+  return retval;
+}
+
+// every string section split into its strings and indexed
+static int
+bench_strings (const ElfImage *image, StageResult *r, long *sink)
+{
+  r->name = "string tables";
+  r->best_ns = 1e300;
+
+  for (int round = 0; round < ROUNDS; round++)
+    {
+      size_t entries = 0;
+      size_t bytes = 0;
+      double t0 = now_ns ();
+      for (size_t s = 1; s < image->shdrs.count; s++)
+        {
+          StringTable table;
+          if (!strtab_is_strings (image, s)
+              || strtab_load (&table, image, s) != 0)
+            continue;
+          entries += table.count;
+          bytes += table.size;
+          *sink += table.count ? table.starts[table.count - 1] : 0;
+          strtab_free (&table);
+        }
+      double t = now_ns () - t0;
+      if (t < r->best_ns)
+        r->best_ns = t;
+      r->entries = entries;
+      r->bytes = bytes;
+    }
+
+  return r->entries == 0;
+}
+
+// the text of -e -s rendered into memory, reopening the file each time
+static int
+bench_output (const char *path, const ElfImage *image, StageResult *r)
+{
+  Arena arena;
+  OutBuf out;
+  int flags = BATCH_FILE_HEADER | BATCH_PROGRAM_HEADERS
+              | BATCH_SECTION_HEADERS | BATCH_SYMBOLS;
+
+  if (outbuf_init (&out, -1, OUTBUF_DEFAULT_SIZE) != 0)
+    return -1;
+
+  arena_init (&arena, 0);
+  r->name = "output -e -s";
+  r->best_ns = 1e300;
+
+  for (int round = 0; round < ROUNDS; round++)
+    {
+      out.len = 0;
+      arena_reset (&arena);
+      double t0 = now_ns ();
+      int ret = do_batch_to (&out, path, flags, 0, &arena);
+      double t = now_ns () - t0;
+      if (ret != 0)
+        break;
+      if (t < r->best_ns)
+        r->best_ns = t;
+    }
+
+  const SymbolStore *symtab = image->symbols[0];
+  r->entries = image->phdrs.count + image->shdrs.count
+               + (symtab != NULL ? symtab->count : 0);
+  r->bytes = out.len;
+
+  arena_release (&arena);
+  outbuf_free (&out);
+  return 0;
+}
+
+static int
+bench_file (const char *path, long *sink)
+{
+  FileContents *file = robust_map_file (path);
+  if (file == NULL)
+    return -1;
+
+  Arena arena;
+  ElfImage image;
+  StageResult r;
+
+  arena_init (&arena, 0);
+  if (elf_image_init (&image, file, &arena) != 0)
+    {
+      fprintf (stderr, "%s: not a readable ELF file\n", path);
+      arena_release (&arena);
+      release_file_contents (file);
+      return -1;
+    }
+
+  printf ("%s (%zu bytes)\n", path, file->length);
+  printf ("%-22s %12s %12s %12s\n", "stage", "entries", "ns/entry",
+          "MB/s");
+
+  if (bench_header (file, &r, sink) == 0)
+    report (&r);
+  if (bench_sections (file, &r, sink) == 0)
+    report (&r);
+  if (bench_symbols (&image, &r, sink) == 0)
+    report (&r);
+  if (bench_relocations (&image, &r, sink) == 0)
+    report (&r);
+  if (bench_strings (&image, &r, sink) == 0)
+    report (&r);
+
+  elf_image_symbols (&image, SHT_SYMTAB);
+  if (bench_output (path, &image, &r) == 0)
+    report (&r);
+
+  arena_release (&arena);
+  release_file_contents (file);
+  return 0;
+}
+
+int
+main (int argc, char *argv[])
+{
+  long sink = 0;
+  int retval = 0;
+
+  if (argc < 2)
+    {
+      fprintf (stderr, "usage: %s file...\n", argv[0]);
+      return 1;
+    }
+
+  for (int i = 1; i < argc; i++)
+    {
+      if (i > 1)
+        putchar ('\n');
+      if (bench_file (argv[i], &sink) != 0)
+        retval = 1;
+    }
+
+  printf ("(best of %d; checksum %ld)\n", ROUNDS, sink);
+  return retval;
+}
@@ -0,0 +1,361 @@
+/* gen_elf.c
+ * Writes a synthetic x86-64 relocatable object of any size for the parse
+ * benchmarks: a .text section, one global function symbol per 4 bytes of
+ * it, names padded out to the requested string table size, R_X86_64_PC32
+ * relocations against those symbols, and empty filler sections up to the
+ * requested section count (with extended numbering past SHN_LORESERVE).
+ * usage:
+ * $ ./bench/gen_elf [-S sections] [-s symbols] [-t strtab-bytes]
+ *                   [-r relocations] output
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#ifdef __APPLE__
+#include <libelf/libelf.h>
+#elif __linux__
+#include <libelf.h>
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// fixed sections ahead of the fillers
+enum
+{
+  SEC_NULL,
+  SEC_TEXT,
+  SEC_RELA,
+  SEC_SYMTAB,
+  SEC_STRTAB,
+  SEC_SHSTRTAB,
+  SEC_FIXED
+};
+
+#define FILLER_NAME_MAX 24
+#define SYMBOL_NAME_MAX 255
+
+typedef struct
+{
+  size_t sections;
+  size_t symbols;
+  size_t strtab;
+  size_t relocs;
+} GenParams;
+
+static int
+write_all (FILE *f, const void *data, size_t len)
+{
+  if (len != 0 && fwrite (data, 1, len, f) != len)
+    {
+      fprintf (stderr, "Failed to write output.\n");
+      return -1;
+    }
+
+  return 0;
+}
+
+static int
+write_zeros (FILE *f, size_t len)
+{
+  static const char zeros[4096];
+
+  while (len > 0)
+    {
+      size_t n = len < sizeof (zeros) ? len : sizeof (zeros);
+      if (write_all (f, zeros, n) != 0)
+        return -1;
+      len -= n;
+    }
+
+  return 0;
+}
+
+static size_t
+align8 (size_t offset)
+{
+  return (offset + 7) & ~(size_t)7;
+}
+
+// every name is "sym_<index>" padded with 'x' so that all of them together
+// fill about strtab bytes
+static size_t
+symbol_name_length (const GenParams *p, size_t index)
+{
+  size_t base = (size_t)snprintf (NULL, 0, "sym_%zu", index);
+  size_t want = p->symbols ? p->strtab / p->symbols : 0;
+
+  if (want > SYMBOL_NAME_MAX + 1)
+    want = SYMBOL_NAME_MAX + 1;
+
+  return want > base + 1 ? want - 1 : base;
+}
+
+static int
+write_strtab (FILE *f, const GenParams *p)
+{
+  char name[SYMBOL_NAME_MAX + 1];
+
+  if (write_all (f, "", 1) != 0)
+    return -1;
+
+  for (size_t i = 0; i < p->symbols; i++)
+    {
+      size_t len = symbol_name_length (p, i);
+      int n = snprintf (name, sizeof (name), "sym_%zu", i);
+      memset (name + n, 'x', len - (size_t)n);
+      name[len] = '\0';
+      if (write_all (f, name, len + 1) != 0)
+        return -1;
+    }
+
+  return 0;
+}
+
+static size_t
+strtab_size (const GenParams *p)
+{
+  size_t size = 1;
+
+  for (size_t i = 0; i < p->symbols; i++)
+    size += symbol_name_length (p, i) + 1;
+
+  return size;
+}
+
+static int
+generate (FILE *f, const GenParams *p)
+{
+  static const char shstrtab_fixed[]
+      = "\0.text\0.rela.text\0.symtab\0.strtab\0.shstrtab";
+  // offsets of the fixed names above
+  static const Elf64_Word fixed_names[SEC_FIXED] = { 0, 1, 7, 18, 26, 34 };
+
+  size_t fillers = p->sections - SEC_FIXED;
+  size_t text_size = p->symbols ? p->symbols * 4 : 16;
+  size_t nsyms = p->symbols + 1;
+
+  // the filler names follow the fixed ones in .shstrtab
+  size_t shstrtab_size = sizeof (shstrtab_fixed);
+  for (size_t i = 0; i < fillers; i++)
+    shstrtab_size += (size_t)snprintf (NULL, 0, ".data.%zu", i) + 1;
+
+  size_t text_off = sizeof (Elf64_Ehdr);
+  size_t rela_off = align8 (text_off + text_size);
+  size_t rela_size = p->relocs * sizeof (Elf64_Rela);
+  size_t symtab_off = align8 (rela_off + rela_size);
+  size_t symtab_size = nsyms * sizeof (Elf64_Sym);
+  size_t strtab_off = symtab_off + symtab_size;
+  size_t strtab_len = strtab_size (p);
+  size_t shstrtab_off = strtab_off + strtab_len;
+  size_t shdr_off = align8 (shstrtab_off + shstrtab_size);
+
+  Elf64_Ehdr ehdr;
+  memset (&ehdr, 0, sizeof (ehdr));
+  memcpy (ehdr.e_ident, ELFMAG, SELFMAG);
+  ehdr.e_ident[EI_CLASS] = ELFCLASS64;
+  ehdr.e_ident[EI_DATA] = ELFDATA2LSB;
+  ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+  ehdr.e_type = ET_REL;
+  ehdr.e_machine = EM_X86_64;
+  ehdr.e_version = EV_CURRENT;
+  ehdr.e_shoff = shdr_off;
+  ehdr.e_ehsize = sizeof (Elf64_Ehdr);
+  ehdr.e_shentsize = sizeof (Elf64_Shdr);
+  ehdr.e_shnum = p->sections < SHN_LORESERVE ? (Elf64_Half)p->sections : 0;
+  ehdr.e_shstrndx = SEC_SHSTRTAB;
+  if (write_all (f, &ehdr, sizeof (ehdr)) != 0)
+    return -1;
+
+  // .text: nothing but ret instructions
+  for (size_t i = 0; i < text_size; i++)
+    if (fputc (0xc3, f) == EOF)
+      return -1;
+  if (write_zeros (f, rela_off - (text_off + text_size)) != 0)
+    return -1;
+
+  for (size_t i = 0; i < p->relocs; i++)
+    {
+      Elf64_Rela rela;
+      rela.r_offset = (i * 4) % text_size;
+      rela.r_info = ELF64_R_INFO (p->symbols ? i % p->symbols + 1 : 0,
+                                  R_X86_64_PC32);
+      rela.r_addend = -4;
+      if (write_all (f, &rela, sizeof (rela)) != 0)
+        return -1;
+    }
+  if (write_zeros (f, symtab_off - (rela_off + rela_size)) != 0)
+    return -1;
+
+  Elf64_Sym sym;
+  memset (&sym, 0, sizeof (sym));
+  if (write_all (f, &sym, sizeof (sym)) != 0)
+    return -1;
+  size_t name = 1;
+  for (size_t i = 0; i < p->symbols; i++)
+    {
+      size_t len = symbol_name_length (p, i);
+      sym.st_name = (Elf64_Word)name;
+      sym.st_info = ELF64_ST_INFO (STB_GLOBAL, STT_FUNC);
+      sym.st_shndx = SEC_TEXT;
+      sym.st_value = i * 4;
+      sym.st_size = 4;
+      if (write_all (f, &sym, sizeof (sym)) != 0)
+        return -1;
+      name += len + 1;
+    }
+
+  if (write_strtab (f, p) != 0)
+    return -1;
+
+  if (write_all (f, shstrtab_fixed, sizeof (shstrtab_fixed)) != 0)
+    return -1;
+  for (size_t i = 0; i < fillers; i++)
+    {
+      char filler[FILLER_NAME_MAX];
+      int n = snprintf (filler, sizeof (filler), ".data.%zu", i);
+      if (write_all (f, filler, (size_t)n + 1) != 0)
+        return -1;
+    }
+  if (write_zeros (f, shdr_off - (shstrtab_off + shstrtab_size)) != 0)
+    return -1;
+
+  Elf64_Shdr sh[SEC_FIXED];
+  memset (sh, 0, sizeof (sh));
+  if (p->sections >= SHN_LORESERVE)
+    sh[SEC_NULL].sh_size = p->sections;
+
+  sh[SEC_TEXT].sh_type = SHT_PROGBITS;
+  sh[SEC_TEXT].sh_flags = SHF_ALLOC | SHF_EXECINSTR;
+  sh[SEC_TEXT].sh_offset = text_off;
+  sh[SEC_TEXT].sh_size = text_size;
+  sh[SEC_TEXT].sh_addralign = 16;
+
+  sh[SEC_RELA].sh_type = SHT_RELA;
+  sh[SEC_RELA].sh_flags = SHF_INFO_LINK;
+  sh[SEC_RELA].sh_offset = rela_off;
+  sh[SEC_RELA].sh_size = rela_size;
+  sh[SEC_RELA].sh_link = SEC_SYMTAB;
+  sh[SEC_RELA].sh_info = SEC_TEXT;
+  sh[SEC_RELA].sh_addralign = 8;
+  sh[SEC_RELA].sh_entsize = sizeof (Elf64_Rela);
+
+  sh[SEC_SYMTAB].sh_type = SHT_SYMTAB;
+  sh[SEC_SYMTAB].sh_offset = symtab_off;
+  sh[SEC_SYMTAB].sh_size = symtab_size;
+  sh[SEC_SYMTAB].sh_link = SEC_STRTAB;
+  sh[SEC_SYMTAB].sh_info = 1;
+  sh[SEC_SYMTAB].sh_addralign = 8;
+  sh[SEC_SYMTAB].sh_entsize = sizeof (Elf64_Sym);
+
+  sh[SEC_STRTAB].sh_type = SHT_STRTAB;
+  sh[SEC_STRTAB].sh_offset = strtab_off;
+  sh[SEC_STRTAB].sh_size = strtab_len;
+  sh[SEC_STRTAB].sh_addralign = 1;
+
+  sh[SEC_SHSTRTAB].sh_type = SHT_STRTAB;
+  sh[SEC_SHSTRTAB].sh_offset = shstrtab_off;
+  sh[SEC_SHSTRTAB].sh_size = shstrtab_size;
+  sh[SEC_SHSTRTAB].sh_addralign = 1;
+
+  for (int i = 0; i < SEC_FIXED; i++)
+    sh[i].sh_name = fixed_names[i];
+  if (write_all (f, sh, sizeof (sh)) != 0)
+    return -1;
+
+  Elf64_Shdr filler;
+  memset (&filler, 0, sizeof (filler));
+  filler.sh_type = SHT_PROGBITS;
+  filler.sh_flags = SHF_ALLOC | SHF_WRITE;
+  filler.sh_offset = shdr_off;
+  filler.sh_addralign = 1;
+  name = sizeof (shstrtab_fixed);
+  for (size_t i = 0; i < fillers; i++)
+    {
+      filler.sh_name = (Elf64_Word)name;
+      if (write_all (f, &filler, sizeof (filler)) != 0)
+        return -1;
+      name += (size_t)snprintf (NULL, 0, ".data.%zu", i) + 1;
+    }
+
+  return 0;
+}
+
+static int
+parse_count (const char *text, size_t *out)
+{
+  char *end;
+  unsigned long long value = strtoull (text, &end, 10);
+
+  if (end == text || *end != '\0' || *text == '-')
+    {
+      fprintf (stderr, "Invalid count: %s\n", text);
+      return -1;
+    }
+
+  *out = (size_t)value;
+  return 0;
+}
+
+int
+main (int argc, char *argv[])
+{
+  GenParams p = { 1000, 10000, 200000, 10000 };
+  int c;
+
+  while ((c = getopt (argc, argv, "S:s:t:r:")) != -1)
+    {
+      size_t *field = c == 'S'   ? &p.sections
+                      : c == 's' ? &p.symbols
+                      : c == 't' ? &p.strtab
+                      : c == 'r' ? &p.relocs
+                                 : NULL;
+      if (field == NULL || parse_count (optarg, field) != 0)
+        {
+          fprintf (stderr, "usage: %s [-S sections] [-s symbols] "
+                           "[-t strtab-bytes] [-r relocations] output\n",
+                   argv[0]);
+          return 1;
+        }
+    }
+
+  if (optind + 1 != argc)
+    {
+      fprintf (stderr, "usage: %s [-S sections] [-s symbols] "
+                       "[-t strtab-bytes] [-r relocations] output\n",
+               argv[0]);
+      return 1;
+    }
+
+  if (p.sections < SEC_FIXED)
+    p.sections = SEC_FIXED;
+  if (p.symbols > UINT32_MAX / 4)
+    {
+      fprintf (stderr, "Too many symbols: %zu\n", p.symbols);
+      return 1;
+    }
+
+  FILE *f = fopen (argv[optind], "wb");
+  if (f == NULL)
+    {
+      fprintf (stderr, "Failed to create %s.\n", argv[optind]);
+      return 1;
+    }
+
+  int ret = generate (f, &p);
+  if (fclose (f) != 0)
+    ret = -1;
+
+  if (ret != 0)
+    {
+      unlink (argv[optind]);
+      return 1;
+    }
+
+  printf ("%s: %zu sections, %zu symbols, %zu relocations\n", argv[optind],
+          p.sections, p.symbols, p.relocs);
+  return 0;
+}
@@ -0,0 +1,810 @@
+#ifdef __APPLE__
+#include <libelf/libelf.h>
+#elif __linux__
+#include <libelf.h>
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./include/bindings.h"
+#include "./include/deps.h"
+#include "./include/dynamic.h"
+#include "./include/elf_hash.h"
+#include "./include/elf_image.h"
+#include "./include/reloc.h"
+#include "./include/stats.h"
+#include "./include/symtab.h"
+
+// DT_SYMBOLIC or DF_SYMBOLIC: the object's own definitions come first
+static int
+is_symbolic (ElfImage *image)
+{
+  const DynamicInfo *dyn = elf_image_dynamic (image);
+  if (dyn == NULL)
+    return 0;
+
+  if (dyn->flags & DF_SYMBOLIC)
+    return 1;
+  for (size_t i = 0; i < dyn->count; i++)
+    if (dyn->tag[i] == DT_SYMBOLIC)
+      return 1;
+
+  return 0;
+}
+
+// whether a reference is looked up or binds in the object by itself
+static int
+binds_globally (const SymbolStore *dynsym, size_t index)
+{
+  unsigned char info = dynsym->info[index];
+
+  if (ELF64_ST_BIND (info) == STB_LOCAL
+      || ELF64_ST_TYPE (info) == STT_SECTION
+      || symstore_name (dynsym, index)[0] == '\0')
+    return 0;
+
+  if (dynsym->shndx[index] == SHN_UNDEF)
+    return 1;
+
+  return ELF64_ST_VISIBILITY (dynsym->other[index]) == STV_DEFAULT;
+}
+
+// The lookup class of a relocation type, as glibc's
+// elf_machine_type_class gives it for the machines it supports.
+static int
+reloc_bind_class (Elf64_Half machine, Elf64_Word type)
+{
+  switch (machine)
+    {
+    case EM_X86_64:
+      if (type == R_X86_64_COPY)
+        return BIND_COPY;
+      return type == R_X86_64_JUMP_SLOT || type == R_X86_64_DTPMOD64
+                     || type == R_X86_64_DTPOFF64 || type == R_X86_64_TPOFF64
+                     || type == R_X86_64_TLSDESC
+                 ? BIND_PLT
+                 : BIND_NORMAL;
+    case EM_386:
+      if (type == R_386_COPY)
+        return BIND_COPY;
+      return type == R_386_JMP_SLOT || type == R_386_TLS_DTPMOD32
+                     || type == R_386_TLS_DTPOFF32 || type == R_386_TLS_TPOFF32
+                     || type == R_386_TLS_TPOFF || type == R_386_TLS_DESC
+                 ? BIND_PLT
+                 : BIND_NORMAL;
+    case EM_AARCH64:
+      if (type == R_AARCH64_COPY)
+        return BIND_COPY;
+      return type == R_AARCH64_JUMP_SLOT || type == R_AARCH64_TLS_DTPMOD
+                     || type == R_AARCH64_TLS_DTPREL
+                     || type == R_AARCH64_TLS_TPREL
+                     || type == R_AARCH64_TLSDESC
+                 ? BIND_PLT
+                 : BIND_NORMAL;
+    case EM_ARM:
+      if (type == R_ARM_COPY)
+        return BIND_COPY;
+      return type == R_ARM_JUMP_SLOT || type == R_ARM_TLS_DTPMOD32
+                     || type == R_ARM_TLS_DTPOFF32 || type == R_ARM_TLS_TPOFF32
+                     || type == R_ARM_TLS_DESC
+                 ? BIND_PLT
+                 : BIND_NORMAL;
+    case EM_RISCV:
+      if (type == R_RISCV_COPY)
+        return BIND_COPY;
+      return type == R_RISCV_JUMP_SLOT ? BIND_PLT : BIND_NORMAL;
+    default:
+      return BIND_NORMAL;
+    }
+}
+
+static void
+count_table_refs (const RelocTable *table, const SymbolStore *dynsym,
+                  Elf64_Half machine, uint32_t *counts)
+{
+  for (size_t i = 0; i < table->count; i++)
+    if (table->sym[i] != STN_UNDEF && table->sym[i] < dynsym->count)
+      counts[(size_t)table->sym[i] * BIND_CLASSES
+             + reloc_bind_class (machine, table->type[i])]++;
+}
+
+// Relocations against each .dynsym entry by class, over the plain tables
+// and the Android packed ones; RELR tables are relative and name no symbol.
+static void
+count_refs (ElfImage *image, RelocSet *set, const SymbolStore *dynsym,
+            uint32_t *counts)
+{
+  Elf64_Half machine = image->ehdr.e_machine;
+
+  for (size_t i = 0; i < set->ntables; i++)
+    {
+      const RelocTable *table = &set->tables[i];
+      if (table->dynamic && table->symtab == dynsym->section)
+        count_table_refs (table, dynsym, machine, counts);
+    }
+
+  for (size_t i = 0; i < set->npacked; i++)
+    {
+      const PackedTable *table = &set->packed[i];
+      if (!table->dynamic || table->kind != PACKED_APS2
+          || table->symtab != dynsym->section)
+        continue;
+
+      PackedIter it;
+      RelocEntry entry;
+      packed_iter_init (&it, image, table);
+      while (packed_iter_next (&it, &entry) > 0)
+        if (entry.sym != STN_UNDEF && entry.sym < dynsym->count)
+          counts[(size_t)entry.sym * BIND_CLASSES
+                 + reloc_bind_class (machine, entry.type)]++;
+    }
+}
+
+static uint32_t
+ref_total (const uint32_t *counts)
+{
+  uint32_t total = 0;
+  for (int c = 0; c < BIND_CLASSES; c++)
+    total += counts[c];
+  return total;
+}
+
+// a section of the given type linked to the dynamic symbol table, if it
+// lies in the file
+static const unsigned char *
+find_linked_section (const ElfImage *image, Elf64_Word sh_type, size_t link,
+                     size_t *size, size_t *info)
+{
+  for (size_t i = 1; i < image->shdrs.count; i++)
+    {
+      Elf64_Shdr scratch;
+      const Elf64_Shdr *sh = elf_image_shdr (image, i, &scratch);
+      if (sh->sh_type != sh_type || sh->sh_link != link)
+        continue;
+
+      if (sh->sh_offset > image->file->length
+          || sh->sh_size > image->file->length - sh->sh_offset)
+        return NULL;
+
+      *size = sh->sh_size;
+      *info = sh->sh_info;
+      return (const unsigned char *)image->file->buffer + sh->sh_offset;
+    }
+
+  return NULL;
+}
+
+static const char *
+version_string (const SymbolStore *dynsym, Elf64_Word offset)
+{
+  if (dynsym->strtab == NULL || offset >= dynsym->strtab_size)
+    return NULL;
+
+  return dynsym->strtab + offset;
+}
+
+static int
+set_version (BindScope *scope, uint16_t ndx, const char *name, uint32_t hash,
+             int hidden)
+{
+  if (name == NULL)
+    return 0;
+
+  if (ndx >= scope->nversions)
+    {
+      size_t n = (size_t)ndx + 1;
+      BindVersion *versions = realloc (scope->versions,
+                                       n * sizeof (BindVersion));
+      if (versions == NULL)
+        {
+          fprintf (stderr, "Failed to allocate memory.\n");
+          return -1;
+        }
+      memset (versions + scope->nversions, 0,
+              (n - scope->nversions) * sizeof (BindVersion));
+      scope->versions = versions;
+      scope->nversions = n;
+    }
+
+  BindVersion *version = &scope->versions[ndx];
+  version->name = name;
+  version->hash = hash;
+  version->hidden = hidden;
+  return 0;
+}
+
+// Version indices of the object as ld.so numbers them: the versions it
+// defines, except the base one named after the file, and the ones it
+// needs from others.  Entries are walked by their offsets, each checked
+// against the section; a malformed chain stops the walk.
+static int
+load_versions (BindScope *scope)
+{
+  const ElfImage *image = scope->image;
+  const ElfLayout *layout = image->layout;
+  const SymbolStore *dynsym = scope->hash.dynsym;
+  const unsigned char *p;
+  size_t size;
+  size_t count;
+
+  p = find_linked_section (image, SHT_GNU_versym, dynsym->section, &size,
+                           &count);
+  if (p == NULL)
+    return 0;
+  scope->versym = p;
+  scope->nversym = size / 2;
+
+  Elf64_Shdr scratch;
+  size_t strtab = elf_image_shdr (image, dynsym->section, &scratch)->sh_link;
+
+  p = find_linked_section (image, SHT_GNU_verdef, strtab, &size, &count);
+  for (size_t off = 0, n = 0; p != NULL && n < count && off + 20 <= size;
+       n++)
+    {
+      uint16_t flags = layout->read_half (p + off + 2);
+      uint16_t ndx = layout->read_half (p + off + 4);
+      uint32_t hash = layout->read_word (p + off + 8);
+      uint32_t aux = layout->read_word (p + off + 12);
+      uint32_t next = layout->read_word (p + off + 16);
+
+      if (!(flags & VER_FLG_BASE) && aux <= size - off
+          && size - off - aux >= 8
+          && set_version (scope, ndx & 0x7fff,
+                          version_string (dynsym,
+                                          layout->read_word (p + off + aux)),
+                          hash, 0)
+                 != 0)
+        return -1;
+
+      if (next == 0 || next > size - off)
+        break;
+      off += next;
+    }
+
+  p = find_linked_section (image, SHT_GNU_verneed, strtab, &size, &count);
+  for (size_t off = 0, n = 0; p != NULL && n < count && off + 16 <= size;
+       n++)
+    {
+      uint16_t cnt = layout->read_half (p + off + 2);
+      uint32_t aux = layout->read_word (p + off + 8);
+      uint32_t next = layout->read_word (p + off + 12);
+
+      for (size_t a = off + aux, k = 0; aux != 0 && k < cnt && a < size
+                                        && size - a >= 16;
+           k++)
+        {
+          uint32_t hash = layout->read_word (p + a);
+          uint16_t other = layout->read_half (p + a + 6);
+          uint32_t name = layout->read_word (p + a + 8);
+          uint32_t anext = layout->read_word (p + a + 12);
+
+          if (set_version (scope, other & 0x7fff,
+                           version_string (dynsym, name), hash,
+                           (other & 0x8000) != 0)
+              != 0)
+            return -1;
+
+          if (anext == 0)
+            break;
+          a += anext;
+        }
+
+      if (next == 0 || next > size - off)
+        break;
+      off += next;
+    }
+
+  return 0;
+}
+
+// the version a symbol of the object has, or asks for when undefined
+static const BindVersion *
+symbol_version (const BindScope *scope, size_t index)
+{
+  if (scope->versym == NULL || index >= scope->nversym)
+    return NULL;
+
+  uint16_t ndx = scope->image->layout->read_half (scope->versym + index * 2)
+                 & 0x7fff;
+  if (ndx >= scope->nversions || scope->versions[ndx].hash == 0)
+    return NULL;
+
+  return &scope->versions[ndx];
+}
+
+static int
+collect_refs (BindScope *scope)
+{
+  ElfImage *image = scope->image;
+  const SymbolStore *dynsym = scope->hash.dynsym;
+
+  RelocSet *set = elf_image_relocs (image);
+  if (set == NULL)
+    return -1;
+
+  uint32_t *counts = calloc ((dynsym->count + 1) * BIND_CLASSES,
+                             sizeof (uint32_t));
+  if (counts == NULL)
+    {
+      fprintf (stderr, "Failed to allocate memory.\n");
+      return -1;
+    }
+
+  count_refs (image, set, dynsym, counts);
+
+  scope->symbolic = is_symbolic (image);
+  size_t n = 0;
+  for (size_t i = 0; i < dynsym->count; i++)
+    n += ref_total (counts + i * BIND_CLASSES) != 0
+         && binds_globally (dynsym, i);
+
+  scope->refs = arena_alloc (image->arena, n * sizeof (SymbolRef));
+  if (scope->refs == NULL)
+    {
+      free (counts);
+      return -1;
+    }
+
+  for (size_t i = 0; i < dynsym->count; i++)
+    {
+      const uint32_t *count = counts + i * BIND_CLASSES;
+      uint32_t total = ref_total (count);
+      if (total == 0 || !binds_globally (dynsym, i))
+        continue;
+
+      SymbolRef *ref = &scope->refs[scope->nrefs++];
+      ref->name = symstore_name (dynsym, i);
+      ref->gnu = dynhash_gnu (ref->name);
+      ref->sysv = dynhash_sysv (ref->name);
+      ref->version = symbol_version (scope, i);
+      memcpy (ref->count, count, sizeof (ref->count));
+      ref->weak = dynsym->shndx[i] == SHN_UNDEF
+                  && ELF64_ST_BIND (dynsym->info[i]) == STB_WEAK;
+      scope->lookups += total;
+    }
+
+  free (counts);
+  return 0;
+}
+
+// NULL when the file has no dynamic symbol table to bind through
+BindScope *
+bind_scope_open (const char *path)
+{
+  STAT_SCOPE (STAT_PHASE_SYMBOLS);
+  BindScope *scope = calloc (1, sizeof (BindScope));
+  if (scope == NULL)
+    {
+      fprintf (stderr, "Failed to allocate memory.\n");
+      return NULL;
+    }
+
+  scope->image = elf_image_open (path);
+  if (scope->image == NULL || dynhash_init (&scope->hash, scope->image) != 0
+      || load_versions (scope) != 0 || collect_refs (scope) != 0)
+    {
+      bind_scope_close (scope);
+      return NULL;
+    }
+
+  return scope;
+}
+
+void
+bind_scope_close (BindScope *scope)
+{
+  if (scope == NULL)
+    return;
+
+  elf_image_close (scope->image);
+  free (scope->versions);
+  free (scope);
+}
+
+// every name looked up in a closure once, by its GNU hash
+typedef struct
+{
+  uint32_t *slots; // index into the report's symbols plus one, 0 when free
+  size_t cap;      // a power of two
+} NameIndex;
+
+// one lookup in one object, as glibc's check_match tests versions
+typedef struct
+{
+  const BindScope *scope;
+  const BindVersion *want;
+  long versioned; // the only visible versioned symbol an unversioned
+  int nversioned; // lookup passed over, which it falls back to
+} VersionQuery;
+
+static int
+version_accepts (const SymbolStore *dynsym, size_t index, void *arg)
+{
+  VersionQuery *q = arg;
+  const BindScope *scope = q->scope;
+  (void)dynsym;
+
+  // objects without versions satisfy any reference
+  if (scope->versym == NULL || index >= scope->nversym)
+    return 1;
+
+  uint16_t versym = scope->image->layout->read_half (scope->versym
+                                                     + index * 2);
+  uint16_t ndx = versym & 0x7fff;
+
+  if (q->want != NULL)
+    {
+      const BindVersion *have
+          = ndx < scope->nversions ? &scope->versions[ndx] : NULL;
+      uint32_t hash = have != NULL ? have->hash : 0;
+      if (hash != 0 && hash == q->want->hash
+          && strcmp (have->name, q->want->name) == 0)
+        return 1;
+      // an unversioned definition still serves a version it never had
+      return !q->want->hidden && hash == 0 && !(versym & 0x8000);
+    }
+
+  // local, global and the oldest version stand for no version at all
+  if (ndx < 3)
+    return 1;
+  if (!(versym & 0x8000) && q->nversioned++ == 0)
+    q->versioned = (long)index;
+  return 0;
+}
+
+// the symbol of name and version an object answers a lookup with
+static long
+lookup_version (const BindScope *scope, const SymbolBinding *symbol,
+                const SymbolRef *ref)
+{
+  VersionQuery q = { scope, symbol->version, -1, 0 };
+
+  long found = dynhash_lookup_binding (&scope->hash, ref->name, ref->gnu,
+                                       ref->sysv, version_accepts, &q);
+  if (found < 0 && q.nversioned == 1)
+    found = q.versioned;
+
+  return found;
+}
+
+static int
+same_version (const BindVersion *a, const BindVersion *b)
+{
+  if (a == NULL || b == NULL)
+    return a == b;
+
+  return a->hash == b->hash && strcmp (a->name, b->name) == 0;
+}
+
+static int
+add_def (BindReport *report, size_t *cap, size_t entry, int canonical,
+         int unique)
+{
+  if (report->ndefs == *cap)
+    {
+      size_t grown = *cap ? *cap * 2 : 256;
+      BindDef *defs = realloc (report->defs, grown * sizeof (BindDef));
+      if (defs == NULL)
+        {
+          fprintf (stderr, "Failed to allocate memory.\n");
+          return -1;
+        }
+      report->defs = defs;
+      *cap = grown;
+    }
+
+  BindDef *def = &report->defs[report->ndefs++];
+  def->entry = entry;
+  def->canonical = canonical;
+  def->unique = unique;
+  return 0;
+}
+
+// The symbol for ref's name and version, searched for in every scope in
+// load order the first time it comes up.  Later definitions are what the
+// first one interposes.
+static SymbolBinding *
+bind_name (BindReport *report, NameIndex *index, size_t *defs_cap,
+           const SymbolRef *ref)
+{
+  size_t mask = index->cap - 1;
+  size_t slot = ref->gnu & mask;
+
+  for (; index->slots[slot] != 0; slot = (slot + 1) & mask)
+    {
+      SymbolBinding *symbol = &report->symbols[index->slots[slot] - 1];
+      if (strcmp (symbol->name, ref->name) == 0
+          && same_version (symbol->version, ref->version))
+        return symbol;
+    }
+
+  SymbolBinding *symbol = &report->symbols[report->nsymbols++];
+  index->slots[slot] = (uint32_t)report->nsymbols;
+  symbol->name = ref->name;
+  symbol->version = ref->version;
+  symbol->count = 0;
+  symbol->first_def = report->ndefs;
+  symbol->ndefs = 0;
+  symbol->unique = BIND_UNRESOLVED;
+
+  for (size_t i = 0; i < report->nentries; i++)
+    {
+      const BindScope *scope = report->scopes[i];
+      if (scope == NULL)
+        continue;
+
+      long found = lookup_version (scope, symbol, ref);
+      if (found < 0)
+        continue;
+
+      const SymbolStore *dynsym = scope->hash.dynsym;
+      int canonical = dynsym->shndx[found] == SHN_UNDEF;
+      int unique = ELF64_ST_BIND (dynsym->info[found]) == STB_GNU_UNIQUE;
+      if (add_def (report, defs_cap, i, canonical, unique) != 0)
+        return NULL;
+      symbol->ndefs++;
+    }
+
+  return symbol;
+}
+
+// The symbol that first bound a unique definition of ref's name, whatever
+// its version: the loader enters the name in a table for the process and
+// every later lookup landing on a unique definition gets that one.
+static SymbolBinding *
+unique_owner (BindReport *report, NameIndex *uniques, SymbolBinding *symbol,
+              const SymbolRef *ref)
+{
+  size_t mask = uniques->cap - 1;
+  size_t slot = ref->gnu & mask;
+
+  for (; uniques->slots[slot] != 0; slot = (slot + 1) & mask)
+    {
+      SymbolBinding *owner = &report->symbols[uniques->slots[slot] - 1];
+      if (strcmp (owner->name, symbol->name) == 0)
+        return owner;
+    }
+
+  uniques->slots[slot] = (uint32_t)(symbol - report->symbols) + 1;
+  return symbol;
+}
+
+// the first definition a lookup of the class from referrer accepts
+static const BindDef *
+accepted_def (const BindReport *report, const SymbolBinding *symbol,
+              size_t referrer, int bind_class)
+{
+  if (report->scopes[referrer]->symbolic && bind_class != BIND_COPY)
+    for (size_t k = 0; k < symbol->ndefs; k++)
+      {
+        const BindDef *def = &report->defs[symbol->first_def + k];
+        if (def->entry == referrer && !def->canonical)
+          return def;
+      }
+
+  for (size_t k = 0; k < symbol->ndefs; k++)
+    {
+      const BindDef *def = &report->defs[symbol->first_def + k];
+      if ((bind_class == BIND_PLT && def->canonical)
+          || (bind_class == BIND_COPY && def->entry == referrer))
+        continue;
+      return def;
+    }
+
+  return NULL;
+}
+
+static int
+add_unresolved (BindReport *report, size_t *cap, size_t entry,
+                const SymbolRef *ref)
+{
+  if (report->nunresolved == *cap)
+    {
+      size_t grown = *cap ? *cap * 2 : 64;
+      UnresolvedRef *refs
+          = realloc (report->unresolved, grown * sizeof (UnresolvedRef));
+      if (refs == NULL)
+        {
+          fprintf (stderr, "Failed to allocate memory.\n");
+          return -1;
+        }
+      report->unresolved = refs;
+      *cap = grown;
+    }
+
+  UnresolvedRef *out = &report->unresolved[report->nunresolved++];
+  out->entry = entry;
+  out->ref = ref;
+  report->nweak += ref->weak != 0;
+  return 0;
+}
+
+// Binds the references of one object.  A lookup searches the objects in
+// load order and stops at the first definition it accepts, so the objects
+// before that one, and all of them for an unresolved name, have their
+// tables probed once per relocation; delta collects those ranges.
+static int
+bind_refs (BindReport *report, NameIndex *index, NameIndex *uniques,
+           size_t *defs_cap, size_t *unresolved_cap, size_t entry,
+           int64_t *delta)
+{
+  const BindScope *scope = report->scopes[entry];
+  BindCounts *counts = &report->counts[entry];
+
+  counts->lookups = scope->lookups;
+  for (size_t k = 0; k < scope->nrefs; k++)
+    {
+      const SymbolRef *ref = &scope->refs[k];
+      SymbolBinding *symbol = bind_name (report, index, defs_cap, ref);
+      if (symbol == NULL)
+        return -1;
+
+      int missing = 0;
+      for (int c = 0; c < BIND_CLASSES; c++)
+        {
+          int64_t n = ref->count[c];
+          if (n == 0)
+            continue;
+
+          const BindDef *def = accepted_def (report, symbol, entry, c);
+          size_t winner = def != NULL ? def->entry : BIND_UNRESOLVED;
+          size_t end = def != NULL ? def->entry + 1 : report->nentries;
+          // a symbolic object is searched on its own first
+          if (scope->symbolic && c != BIND_COPY)
+            {
+              delta[entry] += n;
+              delta[entry + 1] -= n;
+              if (winner == entry)
+                end = 0;
+            }
+          if (def != NULL && def->unique)
+            {
+              SymbolBinding *owner
+                  = unique_owner (report, uniques, symbol, ref);
+              if (owner->unique == BIND_UNRESOLVED)
+                owner->unique = def->entry;
+              winner = symbol->unique = owner->unique;
+            }
+          if (end != 0)
+            {
+              delta[0] += n;
+              delta[end] -= n;
+            }
+          // a copy relocation's lookup passes over its own object
+          if (c == BIND_COPY && entry < end)
+            {
+              delta[entry] -= n;
+              delta[entry + 1] += n;
+            }
+
+          symbol->count += n;
+          if (winner != BIND_UNRESOLVED)
+            report->counts[winner].bound += n;
+          else
+            {
+              counts->unresolved += n;
+              missing = 1;
+            }
+        }
+
+      if (missing && add_unresolved (report, unresolved_cap, entry, ref) != 0)
+        return -1;
+    }
+
+  return 0;
+}
+
+static int
+unresolved_order (const void *a, const void *b)
+{
+  const UnresolvedRef *x = a;
+  const UnresolvedRef *y = b;
+
+  if (x->entry != y->entry)
+    return x->entry < y->entry ? -1 : 1;
+  return x->ref < y->ref ? -1 : x->ref > y->ref;
+}
+
+// Binds the relocations of every object of the closure the way the loader
+// does with LD_BIND_NOW: one lookup per relocation against a global
+// symbol, through the global scope in load order.  Objects are relocated
+// last loaded first, which decides who enters a unique name.  Each
+// distinct name is searched for once, with the hashes its first reference
+// already holds.
+int
+bind_closure (Resolver *r, const DepClosure *closure, BindReport *report)
+{
+  STAT_SCOPE (STAT_PHASE_SYMBOLS);
+  NameIndex index = { NULL, 16 };
+  NameIndex uniques = { NULL, 16 };
+  int64_t *delta = NULL;
+  size_t defs_cap = 0;
+  size_t unresolved_cap = 0;
+  size_t nrefs = 0;
+
+  memset (report, 0, sizeof (BindReport));
+  report->nentries = closure->count;
+  report->counts = calloc (closure->count, sizeof (BindCounts));
+  report->scopes = calloc (closure->count, sizeof (BindScope *));
+  delta = calloc (closure->count + 1, sizeof (int64_t));
+  if (report->counts == NULL || report->scopes == NULL || delta == NULL)
+    {
+      fprintf (stderr, "Failed to allocate memory.\n");
+      goto fail;
+    }
+
+  for (size_t i = 0; i < closure->count; i++)
+    {
+      const DepObject *object = closure->entries[i].object;
+      report->scopes[i] = object != NULL ? resolver_scope (r, object) : NULL;
+      if (report->scopes[i] != NULL)
+        nrefs += report->scopes[i]->nrefs;
+    }
+
+  while (index.cap < nrefs * 2)
+    index.cap *= 2;
+  uniques.cap = index.cap;
+  index.slots = calloc (index.cap, sizeof (uint32_t));
+  uniques.slots = calloc (uniques.cap, sizeof (uint32_t));
+  report->symbols = malloc ((nrefs + 1) * sizeof (SymbolBinding));
+  if (index.slots == NULL || uniques.slots == NULL
+      || report->symbols == NULL)
+    {
+      fprintf (stderr, "Failed to allocate memory.\n");
+      goto fail;
+    }
+
+  for (size_t i = closure->count; i-- > 0;)
+    if (report->scopes[i] != NULL
+        && bind_refs (report, &index, &uniques, &defs_cap, &unresolved_cap,
+                      i, delta)
+               != 0)
+      goto fail;
+
+  if (report->nunresolved > 1)
+    qsort (report->unresolved, report->nunresolved, sizeof (UnresolvedRef),
+           unresolved_order);
+
+  int64_t probes = 0;
+  for (size_t i = 0; i < closure->count; i++)
+    {
+      probes += delta[i];
+      if (report->scopes[i] != NULL)
+        {
+          report->counts[i].probes = (uint64_t)probes;
+          report->probes += (uint64_t)probes;
+        }
+    }
+
+  for (size_t i = 0; i < report->nsymbols; i++)
+    {
+      report->lookups += report->symbols[i].count;
+      report->interposed += report->symbols[i].ndefs > 1;
+    }
+
+  free (index.slots);
+  free (uniques.slots);
+  free (delta);
+  return 0;
+
+fail:
+  free (index.slots);
+  free (uniques.slots);
+  free (delta);
+  bind_report_free (report);
+  return -1;
+}
+
+void
+bind_report_free (BindReport *report)
+{
+  free (report->counts);
+  free (report->scopes);
+  free (report->symbols);
+  free (report->defs);
+  free (report->unresolved);
+  memset (report, 0, sizeof (BindReport));
+}
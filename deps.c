@@ -0,0 +1,930 @@
+#define _DEFAULT_SOURCE
+
+#ifdef __APPLE__
+#include <libelf/libelf.h>
+#elif __linux__
+#include <libelf.h>
+#endif
+
+#include <fcntl.h>
+#include <glob.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "./include/arena.h"
+#include "./include/bindings.h"
+#include "./include/deps.h"
+#include "./include/dynamic.h"
+#include "./include/elf_image.h"
+#include "./include/stats.h"
+
+// links followed in the last component of a path, as the kernel allows
+#define DEPS_MAX_LINKS 40
+// nesting of include lines in ld.so.conf
+#define DEPS_MAX_INCLUDE 8
+
+typedef struct
+{
+  const char *key;
+  void *value;
+} MapSlot;
+
+// open addressing over string keys kept in the resolver's arena
+typedef struct
+{
+  MapSlot *slots;
+  size_t cap; // a power of two
+  size_t count;
+} ObjectMap;
+
+typedef struct
+{
+  const char **dirs;
+  size_t count;
+  size_t cap;
+} DirList;
+
+// Shared by every thread of a run.  The maps and the arena are only used
+// under the lock; objects are filled in while they are DEP_PENDING and
+// never change once they are not.
+struct _Resolver
+{
+  const char *sysroot; // no trailing slash, "" for the host's root
+  size_t sysroot_len;
+  DirList conf_dirs; // from the sysroot's ld.so.conf
+  pthread_mutex_t lock;
+  pthread_cond_t parsed;
+  Arena arena;
+  ObjectMap by_path;
+  ObjectMap by_file;    // "dev:ino", so every path to a file shares it
+  ObjectMap by_default; // "class:machine:name" to the path found for it
+  BindScope *scopes;    // every scope loaded, closed with the resolver
+};
+
+static uint64_t
+hash_key (const char *key)
+{
+  uint64_t h = 0xcbf29ce484222325u;
+  for (; *key != '\0'; key++)
+    h = (h ^ (unsigned char)*key) * 0x100000001b3u;
+  return h;
+}
+
+// the slot holding key, or the empty slot it would go in
+static MapSlot *
+map_find (const ObjectMap *map, const char *key)
+{
+  size_t mask = map->cap - 1;
+
+  for (size_t i = hash_key (key) & mask;; i = (i + 1) & mask)
+    if (map->slots[i].key == NULL || strcmp (map->slots[i].key, key) == 0)
+      return &map->slots[i];
+}
+
+static MapSlot *
+map_get (const ObjectMap *map, const char *key)
+{
+  if (map->cap == 0)
+    return NULL;
+
+  MapSlot *slot = map_find (map, key);
+  return slot->key != NULL ? slot : NULL;
+}
+
+// key must outlive the map and not be in it yet
+static int
+map_put (ObjectMap *map, const char *key, void *value)
+{
+  if ((map->count + 1) * 4 > map->cap * 3)
+    {
+      ObjectMap grown = { NULL, map->cap ? map->cap * 2 : 256, 0 };
+      grown.slots = calloc (grown.cap, sizeof (MapSlot));
+      if (grown.slots == NULL)
+        return -1;
+      for (size_t i = 0; i < map->cap; i++)
+        if (map->slots[i].key != NULL)
+          *map_find (&grown, map->slots[i].key) = map->slots[i];
+      grown.count = map->count;
+      free (map->slots);
+      *map = grown;
+    }
+
+  MapSlot *slot = map_find (map, key);
+  slot->key = key;
+  slot->value = value;
+  map->count++;
+
+  return 0;
+}
+
+static const char *
+save_string (Resolver *r, const char *s, size_t len)
+{
+  char *copy = arena_alloc (&r->arena, len + 1);
+  if (copy == NULL)
+    return NULL;
+
+  memcpy (copy, s, len);
+  copy[len] = '\0';
+  return copy;
+}
+
+static void
+dir_list_add (Resolver *r, DirList *list, const char *dir)
+{
+  for (size_t i = 0; i < list->count; i++)
+    if (strcmp (list->dirs[i], dir) == 0)
+      return;
+
+  if (list->count == list->cap)
+    {
+      size_t cap = list->cap ? list->cap * 2 : 16;
+      const char **dirs = realloc (list->dirs, cap * sizeof (char *));
+      if (dirs == NULL)
+        return;
+      list->dirs = dirs;
+      list->cap = cap;
+    }
+
+  const char *copy = save_string (r, dir, strlen (dir));
+  if (copy != NULL)
+    list->dirs[list->count++] = copy;
+}
+
+static void read_conf (Resolver *r, const char *conf, int depth);
+
+// patterns are relative to the including file, absolute ones to the sysroot
+static void
+include_conf (Resolver *r, const char *conf, const char *pattern, int depth)
+{
+  char full[PATH_MAX];
+  const char *slash = strrchr (conf, '/');
+  int len;
+
+  if (pattern[0] == '/')
+    len = snprintf (full, sizeof (full), "%s%s", r->sysroot, pattern);
+  else
+    len = snprintf (full, sizeof (full), "%.*s/%s",
+                    slash != NULL ? (int)(slash - conf) : 1,
+                    slash != NULL ? conf : ".", pattern);
+  if (len < 0 || (size_t)len >= sizeof (full))
+    return;
+
+  glob_t matches;
+  if (glob (full, 0, NULL, &matches) != 0)
+    return;
+
+  for (size_t i = 0; i < matches.gl_pathc; i++)
+    read_conf (r, matches.gl_pathv[i], depth + 1);
+  globfree (&matches);
+}
+
+// Directories ldconfig would put in ld.so.cache.  The cache itself is not
+// read: it describes the host, and a sysroot's may be stale or missing.
+static void
+read_conf (Resolver *r, const char *conf, int depth)
+{
+  if (depth > DEPS_MAX_INCLUDE)
+    return;
+
+  FILE *stream = fopen (conf, "r");
+  if (stream == NULL)
+    return;
+
+  char line[PATH_MAX];
+  while (fgets (line, sizeof (line), stream) != NULL)
+    {
+      line[strcspn (line, "#\r\n")] = '\0';
+      char *p = line + strspn (line, " \t");
+      char *save;
+
+      if (strncmp (p, "include", 7) == 0 && (p[7] == ' ' || p[7] == '\t'))
+        {
+          for (char *pattern = strtok_r (p + 7, " \t", &save);
+               pattern != NULL; pattern = strtok_r (NULL, " \t", &save))
+            include_conf (r, conf, pattern, depth);
+          continue;
+        }
+
+      if (strncmp (p, "hwcap", 5) == 0 && (p[5] == ' ' || p[5] == '\t'))
+        continue;
+
+      // "dir=TYPE" is an old form ldconfig still accepts
+      for (char *dir = strtok_r (p, " \t:,", &save); dir != NULL;
+           dir = strtok_r (NULL, " \t:,", &save))
+        {
+          char full[PATH_MAX];
+          dir[strcspn (dir, "=")] = '\0';
+          int len = snprintf (full, sizeof (full), "%s%s", r->sysroot, dir);
+          if (dir[0] == '/' && len > 0 && (size_t)len < sizeof (full))
+            dir_list_add (r, &r->conf_dirs, full);
+        }
+    }
+
+  fclose (stream);
+}
+
+Resolver *
+resolver_new (const char *sysroot)
+{
+  struct stat sb;
+  if (stat (sysroot, &sb) != 0 || !S_ISDIR (sb.st_mode))
+    {
+      fprintf (stderr, "%s: not a directory\n", sysroot);
+      return NULL;
+    }
+
+  Resolver *r = calloc (1, sizeof (Resolver));
+  if (r == NULL)
+    {
+      fprintf (stderr, "Failed to allocate memory.\n");
+      return NULL;
+    }
+
+  arena_init (&r->arena, 0);
+  pthread_mutex_init (&r->lock, NULL);
+  pthread_cond_init (&r->parsed, NULL);
+
+  size_t len = strlen (sysroot);
+  while (len > 0 && sysroot[len - 1] == '/')
+    len--;
+  r->sysroot = save_string (r, sysroot, len);
+  r->sysroot_len = len;
+  if (r->sysroot == NULL)
+    {
+      resolver_free (r);
+      return NULL;
+    }
+
+  char conf[PATH_MAX];
+  int n = snprintf (conf, sizeof (conf), "%s/etc/ld.so.conf", r->sysroot);
+  if (n > 0 && (size_t)n < sizeof (conf))
+    read_conf (r, conf, 0);
+
+  return r;
+}
+
+void
+resolver_free (Resolver *r)
+{
+  if (r == NULL)
+    return;
+
+  while (r->scopes != NULL)
+    {
+      BindScope *next = r->scopes->next;
+      bind_scope_close (r->scopes);
+      r->scopes = next;
+    }
+
+  free (r->by_path.slots);
+  free (r->by_file.slots);
+  free (r->by_default.slots);
+  free (r->conf_dirs.dirs);
+  pthread_cond_destroy (&r->parsed);
+  pthread_mutex_destroy (&r->lock);
+  arena_release (&r->arena);
+  free (r);
+}
+
+// Follows links in the last component inside the sysroot, so an absolute
+// link resolves under it instead of on the host.
+static int
+resolve_links (const Resolver *r, const char *path, char *out,
+               struct stat *sb)
+{
+  char target[PATH_MAX];
+  char next[PATH_MAX];
+
+  if (strlen (path) >= PATH_MAX)
+    return -1;
+  strcpy (out, path);
+
+  for (int hops = 0; hops < DEPS_MAX_LINKS; hops++)
+    {
+      if (lstat (out, sb) != 0)
+        return -1;
+      if (!S_ISLNK (sb->st_mode))
+        return 0;
+
+      ssize_t n = readlink (out, target, sizeof (target) - 1);
+      if (n < 0)
+        return -1;
+      target[n] = '\0';
+
+      const char *slash = strrchr (out, '/');
+      int len;
+      if (target[0] == '/')
+        len = snprintf (next, sizeof (next), "%s%s", r->sysroot, target);
+      else if (slash != NULL)
+        len = snprintf (next, sizeof (next), "%.*s/%s", (int)(slash - out),
+                        out, target);
+      else
+        len = snprintf (next, sizeof (next), "%s", target);
+      if (len < 0 || (size_t)len >= sizeof (next))
+        return -1;
+      strcpy (out, next);
+    }
+
+  return -1;
+}
+
+// cheap check so linker scripts named like libraries are never mapped
+static int
+has_elf_magic (const char *path)
+{
+  unsigned char ident[SELFMAG];
+
+  int fd = open (path, O_RDONLY);
+  if (fd == -1)
+    return 0;
+
+  ssize_t n = pread (fd, ident, sizeof (ident), 0);
+  close (fd);
+
+  return n == SELFMAG && memcmp (ident, ELFMAG, SELFMAG) == 0;
+}
+
+// One search path entry with $ORIGIN and $LIB substituted; entries with
+// other tokens are dropped, as there is no process to take them from.
+static int
+expand_dir (const Resolver *r, const char *entry, size_t len,
+            const char *origin, int wide, char *out, size_t size)
+{
+  size_t n = 0;
+
+#define DEPS_APPEND(s, l)                                                     \
+  do                                                                          \
+    {                                                                         \
+      if (n + (l) >= size)                                                    \
+        return -1;                                                            \
+      memcpy (out + n, (s), (l));                                             \
+      n += (l);                                                               \
+    }                                                                         \
+  while (0)
+
+  if (entry[0] == '/')
+    DEPS_APPEND (r->sysroot, r->sysroot_len);
+
+  for (size_t i = 0; i < len;)
+    {
+      if (entry[i] != '$')
+        {
+          DEPS_APPEND (entry + i, 1);
+          i++;
+          continue;
+        }
+
+      int braced = i + 1 < len && entry[i + 1] == '{';
+      size_t start = i + 1 + braced;
+      size_t end = start;
+      while (end < len
+             && (entry[end] == '_'
+                 || (entry[end] >= 'A' && entry[end] <= 'Z')))
+        end++;
+      if (braced && (end >= len || entry[end] != '}'))
+        return -1;
+
+      const char *value;
+      if (end - start == 6 && memcmp (entry + start, "ORIGIN", 6) == 0)
+        value = origin;
+      else if (end - start == 3 && memcmp (entry + start, "LIB", 3) == 0)
+        value = wide ? "lib64" : "lib";
+      else
+        return -1;
+
+      DEPS_APPEND (value, strlen (value));
+      i = end + braced;
+    }
+
+#undef DEPS_APPEND
+
+  out[n] = '\0';
+  return 0;
+}
+
+static int
+split_dirs (Resolver *r, const char *list, const char *origin, int wide,
+            const char ***dirs, size_t *count)
+{
+  size_t n = 1;
+  for (const char *p = list; *p != '\0'; p++)
+    n += *p == ':';
+
+  *dirs = arena_alloc (&r->arena, n * sizeof (char *));
+  *count = 0;
+  if (*dirs == NULL)
+    return -1;
+
+  for (const char *p = list;;)
+    {
+      size_t len = strcspn (p, ":");
+      char dir[PATH_MAX];
+      if (len > 0
+          && expand_dir (r, p, len, origin, wide, dir, sizeof (dir)) == 0)
+        {
+          const char *copy = save_string (r, dir, strlen (dir));
+          if (copy == NULL)
+            return -1;
+          (*dirs)[(*count)++] = copy;
+        }
+      if (p[len] == '\0')
+        break;
+      p += len + 1;
+    }
+
+  return 0;
+}
+
+// copies what the search needs out of the image; called under the lock
+static int
+fill_object (Resolver *r, DepObject *obj, const ElfImage *image,
+             const DynamicInfo *dyn, const char *real)
+{
+  obj->elf_class = image->ehdr.e_ident[EI_CLASS];
+  obj->machine = image->ehdr.e_machine;
+  obj->nodeflib = (dyn->flags_1 & DF_1_NODEFLIB) != 0;
+
+  if (dyn->soname != NULL)
+    {
+      obj->soname = save_string (r, dyn->soname, strlen (dyn->soname));
+      if (obj->soname == NULL)
+        return -1;
+    }
+
+  for (size_t i = 0; i < image->phdrs.count; i++)
+    {
+      Elf64_Phdr scratch;
+      const Elf64_Phdr *ph = elf_image_phdr (image, i, &scratch);
+      const char *file = image->file->buffer;
+      if (ph->p_type != PT_INTERP || ph->p_offset > image->file->length
+          || ph->p_filesz > image->file->length - ph->p_offset
+          || memchr (file + ph->p_offset, '\0', ph->p_filesz) == NULL)
+        continue;
+
+      char path[PATH_MAX];
+      int len = snprintf (path, sizeof (path), "%s%s", r->sysroot,
+                          file + ph->p_offset);
+      if (len > 0 && (size_t)len < sizeof (path))
+        obj->interp = save_string (r, path, (size_t)len);
+      break;
+    }
+
+  obj->needed = arena_alloc (&r->arena, dyn->nneeded * sizeof (char *));
+  if (obj->needed == NULL)
+    return -1;
+  for (size_t i = 0; i < dyn->nneeded; i++)
+    {
+      obj->needed[i]
+          = save_string (r, dyn->needed[i], strlen (dyn->needed[i]));
+      if (obj->needed[i] == NULL)
+        return -1;
+    }
+  obj->nneeded = dyn->nneeded;
+
+  // $ORIGIN is where the file really is, after its links
+  char origin[PATH_MAX];
+  const char *slash = strrchr (real, '/');
+  if (slash != NULL)
+    snprintf (origin, sizeof (origin), "%.*s", (int)(slash - real), real);
+  else
+    strcpy (origin, ".");
+
+  int wide = obj->elf_class == ELFCLASS64;
+  if (dyn->runpath != NULL)
+    return split_dirs (r, dyn->runpath, origin, wide, &obj->runpath,
+                       &obj->nrunpath);
+  if (dyn->rpath != NULL)
+    return split_dirs (r, dyn->rpath, origin, wide, &obj->rpath,
+                       &obj->nrpath);
+
+  return 0;
+}
+
+static void
+parse_object (Resolver *r, DepObject *obj, const char *real, ElfImage *image)
+{
+  ElfImage *own = NULL;
+  if (image == NULL && has_elf_magic (real))
+    image = own = elf_image_open (real);
+
+  DynamicInfo *dyn = image != NULL ? elf_image_dynamic (image) : NULL;
+
+  pthread_mutex_lock (&r->lock);
+  if (dyn != NULL && fill_object (r, obj, image, dyn, real) == 0)
+    obj->state = DEP_OK;
+  else
+    obj->state = DEP_INVALID;
+  pthread_cond_broadcast (&r->parsed);
+  pthread_mutex_unlock (&r->lock);
+  STAT_ADD (STAT_OBJECTS_PARSED, 1);
+
+  elf_image_close (own);
+}
+
+// The object behind path, parsed by whichever thread asks for it first
+// while the others wait.  image, when given, is path already opened by the
+// caller and is read instead of mapping the file again.  where is set to a
+// copy of path that lives as long as the resolver.
+static DepObject *
+get_object (Resolver *r, const char *path, ElfImage *image,
+            const char **where)
+{
+  DepObject *obj = NULL;
+
+  pthread_mutex_lock (&r->lock);
+  MapSlot *slot = map_get (&r->by_path, path);
+  if (slot != NULL)
+    {
+      obj = slot->value;
+      *where = slot->key;
+      while (obj->state == DEP_PENDING)
+        pthread_cond_wait (&r->parsed, &r->lock);
+    }
+  pthread_mutex_unlock (&r->lock);
+  if (obj != NULL)
+    return obj;
+
+  // the file system is asked outside the lock
+  char real[PATH_MAX];
+  char id[48];
+  struct stat sb;
+  int exists = resolve_links (r, path, real, &sb) == 0 && S_ISREG (sb.st_mode);
+  if (exists)
+    snprintf (id, sizeof (id), "%llx:%llx", (unsigned long long)sb.st_dev,
+              (unsigned long long)sb.st_ino);
+
+  int parse = 0;
+
+  pthread_mutex_lock (&r->lock);
+  slot = map_get (&r->by_path, path);
+  if (slot != NULL)
+    {
+      obj = slot->value;
+      *where = slot->key;
+    }
+  else
+    {
+      slot = exists ? map_get (&r->by_file, id) : NULL;
+      if (slot != NULL)
+        obj = slot->value;
+      else
+        {
+          obj = arena_alloc (&r->arena, sizeof (DepObject));
+          if (obj != NULL)
+            {
+              memset (obj, 0, sizeof (DepObject));
+              obj->state = exists ? DEP_PENDING : DEP_MISSING;
+              obj->path = exists ? save_string (r, real, strlen (real)) : NULL;
+              parse = exists;
+              // a failed insert only costs the memo, never the answer
+              const char *key
+                  = exists ? save_string (r, id, strlen (id)) : NULL;
+              if (key != NULL)
+                map_put (&r->by_file, key, obj);
+            }
+        }
+
+      *where = save_string (r, path, strlen (path));
+      if (obj != NULL && *where != NULL)
+        map_put (&r->by_path, *where, obj);
+    }
+
+  if (!parse)
+    while (obj != NULL && obj->state == DEP_PENDING)
+      pthread_cond_wait (&r->parsed, &r->lock);
+  pthread_mutex_unlock (&r->lock);
+
+  if (parse)
+    parse_object (r, obj, real, image);
+
+  return obj;
+}
+
+// a file the loader would take for a process of root's class and machine
+static DepObject *
+try_path (Resolver *r, const char *path, const DepObject *root,
+          const char **where)
+{
+  DepObject *obj = get_object (r, path, NULL, where);
+
+  if (obj == NULL || obj->state != DEP_OK || obj->elf_class != root->elf_class
+      || obj->machine != root->machine)
+    return NULL;
+
+  return obj;
+}
+
+static DepObject *
+try_dir (Resolver *r, const char *dir, const char *name,
+         const DepObject *root, const char **where)
+{
+  char path[PATH_MAX];
+
+  int len = snprintf (path, sizeof (path), "%s/%s", dir, name);
+  if (len < 0 || (size_t)len >= sizeof (path))
+    return NULL;
+
+  return try_path (r, path, root, where);
+}
+
+static const char *
+multiarch_dir (const DepObject *root)
+{
+  int wide = root->elf_class == ELFCLASS64;
+
+  switch (root->machine)
+    {
+    case EM_X86_64:
+      return wide ? "x86_64-linux-gnu" : "x86_64-linux-gnux32";
+    case EM_386:
+      return "i386-linux-gnu";
+    case EM_AARCH64:
+      return "aarch64-linux-gnu";
+    case EM_ARM:
+      return "arm-linux-gnueabihf";
+    case EM_RISCV:
+      return wide ? "riscv64-linux-gnu" : NULL;
+    case EM_PPC64:
+      return "powerpc64le-linux-gnu";
+    case EM_S390:
+      return "s390x-linux-gnu";
+    default:
+      return NULL;
+    }
+}
+
+// the loader's built-in directories, covering both the multiarch and the
+// lib64 conventions since either may be what the sysroot follows
+static DepObject *
+search_system_dirs (Resolver *r, const char *name, const DepObject *root,
+                    const char **where)
+{
+  const char *arch = multiarch_dir (root);
+  const char *prefixes[] = { "/lib", "/usr/lib" };
+  char dir[PATH_MAX];
+  DepObject *found;
+
+  for (int i = 0; arch != NULL && i < 2; i++)
+    {
+      snprintf (dir, sizeof (dir), "%s%s/%s", r->sysroot, prefixes[i], arch);
+      if ((found = try_dir (r, dir, name, root, where)) != NULL)
+        return found;
+    }
+
+  for (int wide = root->elf_class == ELFCLASS64; wide >= 0; wide--)
+    for (int i = 0; i < 2; i++)
+      {
+        snprintf (dir, sizeof (dir), "%s%s%s", r->sysroot, prefixes[i],
+                  wide ? "64" : "");
+        if ((found = try_dir (r, dir, name, root, where)) != NULL)
+          return found;
+      }
+
+  return NULL;
+}
+
+// the same for every object of a class and machine, so the path found is
+// remembered by name, or that there was none
+static DepObject *
+search_default (Resolver *r, const char *name, const DepObject *root,
+                const char **where)
+{
+  char key[PATH_MAX];
+  snprintf (key, sizeof (key), "%u:%u:%s", root->elf_class, root->machine,
+            name);
+
+  pthread_mutex_lock (&r->lock);
+  MapSlot *slot = map_get (&r->by_default, key);
+  const char *known = slot != NULL ? slot->value : NULL;
+  pthread_mutex_unlock (&r->lock);
+  if (slot != NULL)
+    return known != NULL ? try_path (r, known, root, where) : NULL;
+
+  DepObject *found = NULL;
+  for (size_t i = 0; found == NULL && i < r->conf_dirs.count; i++)
+    found = try_dir (r, r->conf_dirs.dirs[i], name, root, where);
+  if (found == NULL)
+    found = search_system_dirs (r, name, root, where);
+
+  pthread_mutex_lock (&r->lock);
+  if (map_get (&r->by_default, key) == NULL)
+    {
+      const char *copy = save_string (r, key, strlen (key));
+      if (copy != NULL)
+        map_put (&r->by_default, copy, found != NULL ? (void *)*where : NULL);
+    }
+  pthread_mutex_unlock (&r->lock);
+
+  return found;
+}
+
+// The order of ld.so without an environment: DT_RPATH up the chain of
+// loaders unless the loader has a DT_RUNPATH, then its DT_RUNPATH, then
+// the default directories unless it was linked with -z nodefaultlib.  The
+// interpreter is mapped before any of them and answers to its soname.
+static DepObject *
+search (Resolver *r, const DepClosure *closure, size_t from, const char *name,
+        const char **where)
+{
+  const DepObject *loader = closure->entries[from].object;
+  const DepObject *root = closure->entries[0].object;
+  DepObject *found;
+
+  if (root->interp != NULL)
+    {
+      found = try_path (r, root->interp, root, where);
+      if (found != NULL && found->soname != NULL
+          && strcmp (found->soname, name) == 0)
+        return found;
+    }
+
+  if (strchr (name, '/') != NULL)
+    {
+      char path[PATH_MAX];
+      int len = snprintf (path, sizeof (path), "%s%s",
+                          name[0] == '/' ? r->sysroot : "", name);
+      if (len < 0 || (size_t)len >= sizeof (path))
+        return NULL;
+      return try_path (r, path, root, where);
+    }
+
+  if (loader->nrunpath == 0)
+    for (size_t i = from;; i = closure->entries[i].parent)
+      {
+        const DepObject *obj = closure->entries[i].object;
+        for (size_t k = 0; k < obj->nrpath; k++)
+          if ((found = try_dir (r, obj->rpath[k], name, root, where)) != NULL)
+            return found;
+        if (i == 0)
+          break;
+      }
+
+  for (size_t k = 0; k < loader->nrunpath; k++)
+    if ((found = try_dir (r, loader->runpath[k], name, root, where)) != NULL)
+      return found;
+
+  if (loader->nodeflib)
+    return NULL;
+
+  return search_default (r, name, root, where);
+}
+
+static int
+closure_add (DepClosure *closure, const char *name, const char *path,
+             const DepObject *object, size_t parent, unsigned int depth)
+{
+  if (closure->count == closure->cap)
+    {
+      size_t cap = closure->cap ? closure->cap * 2 : 64;
+      DepEntry *entries = realloc (closure->entries, cap * sizeof (DepEntry));
+      if (entries == NULL)
+        {
+          fprintf (stderr, "Failed to allocate memory.\n");
+          return -1;
+        }
+      closure->entries = entries;
+      closure->cap = cap;
+    }
+
+  DepEntry *entry = &closure->entries[closure->count++];
+  entry->name = name;
+  entry->path = path;
+  entry->object = object;
+  entry->parent = parent;
+  entry->depth = depth;
+
+  return 0;
+}
+
+// a name already asked for, or the soname of an object already mapped
+static int
+is_loaded (const DepClosure *closure, const char *name)
+{
+  for (size_t i = 1; i < closure->count; i++)
+    {
+      const DepEntry *entry = &closure->entries[i];
+      if (strcmp (entry->name, name) == 0
+          || (entry->object != NULL && entry->object->soname != NULL
+              && strcmp (entry->object->soname, name) == 0))
+        return 1;
+    }
+
+  return 0;
+}
+
+static int
+is_mapped (const DepClosure *closure, const DepObject *object)
+{
+  for (size_t i = 0; i < closure->count; i++)
+    if (closure->entries[i].object == object)
+      return 1;
+
+  return 0;
+}
+
+// Breadth first over DT_NEEDED, which is the order the loader maps and
+// later searches the objects in.  Returns -1 when path itself could not
+// be read as an ELF file.
+int
+resolver_closure (Resolver *r, const char *path, ElfImage *image,
+                  DepClosure *closure)
+{
+  const char *where = NULL;
+
+  memset (closure, 0, sizeof (DepClosure));
+
+  DepObject *root = get_object (r, path, image, &where);
+  if (root == NULL || root->state != DEP_OK
+      || closure_add (closure, path, path, root, 0, 0) != 0)
+    return -1;
+
+  for (size_t i = 0; i < closure->count; i++)
+    {
+      const DepObject *obj = closure->entries[i].object;
+      if (obj == NULL)
+        continue;
+
+      for (size_t k = 0; k < obj->nneeded; k++)
+        {
+          const char *name = obj->needed[k];
+          if (is_loaded (closure, name))
+            continue;
+
+          DepObject *found = search (r, closure, i, name, &where);
+          if (found != NULL && is_mapped (closure, found))
+            continue;
+
+          if (closure_add (closure, name, found != NULL ? where : NULL, found,
+                           i, closure->entries[i].depth + 1)
+              != 0)
+            return -1;
+        }
+    }
+
+  return 0;
+}
+
+void
+dep_closure_free (DepClosure *closure)
+{
+  free (closure->entries);
+  memset (closure, 0, sizeof (DepClosure));
+}
+
+// a path found by the resolver as seen inside the sysroot
+const char *
+resolver_path (const Resolver *r, const char *path)
+{
+  if (r->sysroot_len > 0 && strncmp (path, r->sysroot, r->sysroot_len) == 0
+      && path[r->sysroot_len] == '/')
+    return path + r->sysroot_len;
+
+  return path;
+}
+
+// The symbols an object binds and the table it answers lookups from, read
+// by whichever thread asks first and kept until the resolver is freed.
+// NULL when the object has no dynamic symbol table.
+const BindScope *
+resolver_scope (Resolver *r, const DepObject *object)
+{
+  // the scope fields are the resolver's, and only change under its lock
+  DepObject *obj = (DepObject *)object;
+  int load = 0;
+
+  pthread_mutex_lock (&r->lock);
+  if (obj->state == DEP_OK && obj->scope_state == SCOPE_UNLOADED)
+    {
+      obj->scope_state = SCOPE_LOADING;
+      load = 1;
+    }
+  while (obj->scope_state == SCOPE_LOADING && !load)
+    pthread_cond_wait (&r->parsed, &r->lock);
+  const BindScope *known = obj->scope;
+  pthread_mutex_unlock (&r->lock);
+
+  if (!load)
+    return known;
+
+  BindScope *scope = bind_scope_open (obj->path);
+
+  pthread_mutex_lock (&r->lock);
+  if (scope != NULL)
+    {
+      scope->next = r->scopes;
+      r->scopes = scope;
+    }
+  obj->scope = scope;
+  obj->scope_state = SCOPE_LOADED;
+  pthread_cond_broadcast (&r->parsed);
+  pthread_mutex_unlock (&r->lock);
+
+  return scope;
+}
@@ -0,0 +1,1055 @@
+#ifdef __APPLE__
+#include <libelf/libelf.h>
+#elif __linux__
+#include <libelf.h>
+#endif
+
+#include <capstone/capstone.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./include/disasm.h"
+#include "./include/elf_image.h"
+#include "./include/fileio.h"
+#include "./include/outbuf.h"
+#include "./include/stats.h"
+#include "./include/symtab.h"
+#include "./include/threadpool.h"
+
+#define DISASM_BYTES_PER_LINE 7
+
+static const char hex_digits[] = "0123456789abcdef";
+
+typedef struct
+{
+  Elf64_Addr addr;
+  const char *name;
+} DisasmLabel;
+
+typedef struct
+{
+  Elf64_Addr addr;
+  Elf64_Addr end;
+  Elf64_Addr stop; // first address past the last decoded instruction
+  OutBuf *out;
+  size_t nheads;
+  Elf64_Addr head_addr[DISASM_SYNC_WINDOW];
+  size_t head_pos[DISASM_SYNC_WINDOW]; // output offset of each head
+  int failed;
+} DisasmChunk;
+
+typedef struct
+{
+  cs_arch arch;
+  cs_mode mode;
+  size_t min_insn;
+  int fixed_width; // every min_insn aligned address starts an instruction
+  // one capstone handle per pool worker, opened on first use
+  csh handles[POOL_MAX_THREADS];
+  cs_insn *insns[POOL_MAX_THREADS];
+  // section being decoded
+  const uint8_t *code;
+  Elf64_Addr base;
+  Elf64_Addr limit;
+  DisasmLabel *labels;
+  size_t nlabels;
+  DisasmChunk *window;
+  // function symbols of the whole image grouped by section, built on
+  // first use; section s owns section_labels[label_start[s]] up to
+  // label_start[s + 1]
+  DisasmLabel *section_labels;
+  size_t *label_start;
+} Disassembler;
+
+static int
+disasm_open (Disassembler *d, const ElfImage *image)
+{
+  memset (d, 0, sizeof (Disassembler));
+
+  switch (image->ehdr.e_machine)
+    {
+    case EM_X86_64:
+      d->arch = CS_ARCH_X86;
+      d->mode = CS_MODE_64;
+      d->min_insn = 1;
+      break;
+    case EM_386:
+      d->arch = CS_ARCH_X86;
+      d->mode = CS_MODE_32;
+      d->min_insn = 1;
+      break;
+    case EM_AARCH64:
+      d->arch = CS_ARCH_ARM64;
+      d->mode = CS_MODE_ARM;
+      d->min_insn = 4;
+      d->fixed_width = 1;
+      break;
+    case EM_ARM:
+      d->arch = CS_ARCH_ARM;
+      d->mode = CS_MODE_ARM;
+      d->min_insn = 4;
+      d->fixed_width = 1;
+      break;
+    case EM_MIPS:
+      d->arch = CS_ARCH_MIPS;
+      d->mode = image->ehdr.e_ident[EI_CLASS] == ELFCLASS64 ? CS_MODE_MIPS64
+                                                            : CS_MODE_MIPS32;
+      d->min_insn = 4;
+      d->fixed_width = 1;
+      break;
+    case EM_PPC:
+    case EM_PPC64:
+      d->arch = CS_ARCH_PPC;
+      d->mode = image->ehdr.e_machine == EM_PPC64 ? CS_MODE_64 : CS_MODE_32;
+      d->min_insn = 4;
+      d->fixed_width = 1;
+      break;
+    default:
+      fprintf (stderr, "Disassembly is not supported for machine %u\n",
+               image->ehdr.e_machine);
+      return -1;
+    }
+
+  if (image->ehdr.e_ident[EI_DATA] == ELFDATA2MSB)
+    d->mode = (cs_mode)(d->mode | CS_MODE_BIG_ENDIAN);
+
+  return 0;
+}
+
+static void
+disasm_close (Disassembler *d)
+{
+  for (int i = 0; i < POOL_MAX_THREADS; i++)
+    if (d->insns[i] != NULL)
+      {
+        cs_free (d->insns[i], 1);
+        cs_close (&d->handles[i]);
+      }
+  free (d->section_labels);
+  free (d->label_start);
+}
+
+// only the owning worker ever touches its slot
+static int
+disasm_handle (Disassembler *d, int slot)
+{
+  if (d->insns[slot] != NULL)
+    return 0;
+
+  cs_err err = cs_open (d->arch, d->mode, &d->handles[slot]);
+  if (err != CS_ERR_OK)
+    {
+      fprintf (stderr, "Failed to open disassembler: %s\n",
+               cs_strerror (err));
+      return -1;
+    }
+
+  d->insns[slot] = cs_malloc (d->handles[slot]);
+  if (d->insns[slot] == NULL)
+    {
+      fprintf (stderr, "Failed to allocate memory.\n");
+      cs_close (&d->handles[slot]);
+      return -1;
+    }
+
+  return 0;
+}
+
+static size_t
+label_lower_bound (const DisasmLabel *labels, size_t nlabels, Elf64_Addr addr)
+{
+  size_t lo = 0;
+  size_t hi = nlabels;
+
+  while (lo < hi)
+    {
+      size_t mid = lo + (hi - lo) / 2;
+      if (labels[mid].addr < addr)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  return lo;
+}
+
+static void
+print_insn (OutBuf *out, Elf64_Addr addr, const uint8_t *bytes, size_t len,
+            const char *mnemonic, const char *op_str)
+{
+  char hex[3 * DISASM_BYTES_PER_LINE + 1];
+
+  // long encodings continue on following lines, like objdump
+  for (size_t line = 0; line < len; line += DISASM_BYTES_PER_LINE)
+    {
+      size_t n = len - line;
+      if (n > DISASM_BYTES_PER_LINE)
+        n = DISASM_BYTES_PER_LINE;
+
+      char *p = hex;
+      for (size_t i = 0; i < n; i++)
+        {
+          *p++ = hex_digits[bytes[line + i] >> 4];
+          *p++ = hex_digits[bytes[line + i] & 0xf];
+          *p++ = ' ';
+        }
+      *p = '\0';
+
+      if (line > 0)
+        outbuf_printf (out, "%8lx:\t%s\n", addr + line, hex);
+      else if (op_str[0] != '\0')
+        outbuf_printf (out, "%8lx:\t%-21s\t%-6s %s\n", addr, hex, mnemonic,
+                       op_str);
+      else
+        outbuf_printf (out, "%8lx:\t%-21s\t%s\n", addr, hex, mnemonic);
+    }
+}
+
+// Like objdump, every function symbol restarts decoding: no instruction
+// may run into the next label.  That makes each label a known instruction
+// start.  label is the lower bound of pc among the labels.
+static Elf64_Addr
+insn_stop (const Disassembler *d, size_t label, Elf64_Addr pc)
+{
+  if (label < d->nlabels && d->labels[label].addr == pc)
+    label++;
+
+  return label < d->nlabels ? d->labels[label].addr : d->limit;
+}
+
+// decodes the instruction at pc into the slot's cs_insn and returns its
+// length, or 0 if the bytes up to stop do not decode
+static size_t
+decode_insn (Disassembler *d, int slot, Elf64_Addr pc, Elf64_Addr stop)
+{
+  const uint8_t *code = d->code + (pc - d->base);
+  size_t size = stop - pc;
+  uint64_t next = pc;
+
+  if (cs_disasm_iter (d->handles[slot], &code, &size, &next, d->insns[slot]))
+    return next - pc;
+
+  return 0;
+}
+
+// bytes skipped over when nothing decodes at pc
+static size_t
+bad_length (const Disassembler *d, Elf64_Addr pc, Elf64_Addr stop)
+{
+  return d->min_insn < stop - pc ? d->min_insn : stop - pc;
+}
+
+// decodes the instruction at pc, preceded by the label of any function
+// starting there, and returns where the next one begins
+static Elf64_Addr
+decode_one (Disassembler *d, int slot, Elf64_Addr pc, size_t *label,
+            OutBuf *out)
+{
+  while (*label < d->nlabels && d->labels[*label].addr < pc)
+    (*label)++;
+  if (*label < d->nlabels && d->labels[*label].addr == pc)
+    outbuf_printf (out, "\n%016lx <%s>:\n", pc, d->labels[*label].name);
+
+  Elf64_Addr stop = insn_stop (d, *label, pc);
+  size_t len = decode_insn (d, slot, pc, stop);
+  if (len != 0)
+    {
+      const cs_insn *insn = d->insns[slot];
+      print_insn (out, insn->address, insn->bytes, insn->size,
+                  insn->mnemonic, insn->op_str);
+      return pc + len;
+    }
+
+  len = bad_length (d, pc, stop);
+  print_insn (out, pc, d->code + (pc - d->base), len, "(bad)", "");
+
+  return pc + len;
+}
+
+static void
+disasm_chunk (void *ctx, size_t index, int worker)
+{
+  STAT_SCOPE (STAT_PHASE_DISASM);
+  Disassembler *d = ctx;
+  DisasmChunk *chunk = &d->window[index];
+
+  if (disasm_handle (d, worker) != 0)
+    {
+      chunk->failed = 1;
+      return;
+    }
+
+  size_t label = label_lower_bound (d->labels, d->nlabels, chunk->addr);
+  Elf64_Addr pc = chunk->addr;
+
+  // the last instruction may run past the end of the chunk
+  chunk->nheads = 0;
+  while (pc < chunk->end)
+    {
+      if (chunk->nheads < DISASM_SYNC_WINDOW)
+        {
+          chunk->head_addr[chunk->nheads] = pc;
+          chunk->head_pos[chunk->nheads] = chunk->out->len;
+          chunk->nheads++;
+        }
+      pc = decode_one (d, worker, pc, &label, chunk->out);
+    }
+
+  chunk->stop = pc;
+}
+
+// Appends a chunk after everything decoded up to cursor.  The chunk was
+// decoded from its nominal start, which is only right when the previous
+// instruction ended exactly there.  Otherwise decode on from cursor until
+// both instruction streams meet and keep the chunk's output from there;
+// if they never do within the remembered heads, the chunk is redone.
+static Elf64_Addr
+stitch_chunk (Disassembler *d, const DisasmChunk *chunk, Elf64_Addr cursor,
+              OutBuf *out)
+{
+  size_t label = label_lower_bound (d->labels, d->nlabels, cursor);
+  size_t h = 0;
+
+  while (cursor < chunk->end)
+    {
+      while (h < chunk->nheads && chunk->head_addr[h] < cursor)
+        h++;
+      if (h < chunk->nheads && chunk->head_addr[h] == cursor)
+        {
+          outbuf_write (out, chunk->out->data + chunk->head_pos[h],
+                        chunk->out->len - chunk->head_pos[h]);
+          return chunk->stop;
+        }
+      cursor = decode_one (d, 0, cursor, &label, out);
+    }
+
+  return cursor;
+}
+
+// One pass over the symbol tables for all sections: sorted by address,
+// then stably bucketed by section, so .symtab names still win address ties
+// and objects with one section per function don't rescan every symbol for
+// each section.
+static int
+index_labels (Disassembler *d, ElfImage *image)
+{
+  SymbolStore *stores[2] = { elf_image_symbols (image, SHT_SYMTAB),
+                             elf_image_symbols (image, SHT_DYNSYM) };
+  size_t nsections = image->shdrs.count;
+  size_t total = 0;
+
+  for (int s = 0; s < 2; s++)
+    if (stores[s] != NULL)
+      total += stores[s]->count;
+
+  uint64_t *addr = robust_malloc ((total + 1) * sizeof (uint64_t));
+  uint32_t *owner = robust_malloc ((total + 1) * sizeof (uint32_t));
+  uint32_t *order = robust_malloc ((total + 1) * sizeof (uint32_t));
+  const char **name = robust_malloc ((total + 1) * sizeof (const char *));
+  d->section_labels = robust_malloc ((total + 1) * sizeof (DisasmLabel));
+  d->label_start = robust_malloc ((nsections + 1) * sizeof (size_t));
+  int retval = -1;
+
+  if (addr == NULL || owner == NULL || order == NULL || name == NULL
+      || d->section_labels == NULL || d->label_start == NULL)
+    goto clean;
+
+  memset (d->label_start, 0, (nsections + 1) * sizeof (size_t));
+
+  size_t m = 0;
+  for (int s = 0; s < 2; s++)
+    {
+      const SymbolStore *store = stores[s];
+      if (store == NULL)
+        continue;
+
+      for (size_t i = 0; i < store->count; i++)
+        {
+          unsigned char type = ELF64_ST_TYPE (store->info[i]);
+          if (type != STT_FUNC && type != STT_GNU_IFUNC)
+            continue;
+          if (store->shndx[i] == SHN_UNDEF || store->shndx[i] >= nsections)
+            continue;
+          addr[m] = store->value[i];
+          owner[m] = store->shndx[i];
+          name[m] = symstore_name (store, i);
+          order[m] = (uint32_t)m;
+          d->label_start[owner[m] + 1]++;
+          m++;
+        }
+    }
+
+  if (radix_sort_by_key (addr, order, m) != 0)
+    goto clean;
+
+  for (size_t s = 1; s <= nsections; s++)
+    d->label_start[s] += d->label_start[s - 1];
+
+  // placing advances each start to the next section's; shift them back
+  for (size_t i = 0; i < m; i++)
+    {
+      uint32_t o = order[i];
+      DisasmLabel *label = &d->section_labels[d->label_start[owner[o]]++];
+      label->addr = addr[o];
+      label->name = name[o];
+    }
+  memmove (d->label_start + 1, d->label_start, nsections * sizeof (size_t));
+  d->label_start[0] = 0;
+  retval = 0;
+
+clean:
+  free (addr);
+  free (owner);
+  free (order);
+  free (name);
+  if (retval != 0)
+    {
+      free (d->section_labels);
+      free (d->label_start);
+      d->section_labels = NULL;
+      d->label_start = NULL;
+    }
+  return retval;
+}
+
+static int
+collect_labels (Disassembler *d, ElfImage *image, size_t section)
+{
+  if (d->label_start == NULL && index_labels (d, image) != 0)
+    return -1;
+
+  const DisasmLabel *from = d->section_labels + d->label_start[section];
+  size_t count = d->label_start[section + 1] - d->label_start[section];
+
+  d->labels = robust_malloc ((count + 1) * sizeof (DisasmLabel));
+  if (d->labels == NULL)
+    return -1;
+
+  size_t n = 0;
+  for (size_t i = 0; i < count; i++)
+    {
+      if (from[i].addr < d->base || from[i].addr >= d->limit)
+        continue;
+      if (n > 0 && d->labels[n - 1].addr == from[i].addr)
+        continue;
+      d->labels[n++] = from[i];
+    }
+  d->nlabels = n;
+
+  return 0;
+}
+
+// Splits the section at function starts, grouping small functions until a
+// chunk reaches DISASM_CHUNK_MIN.  With chunks == NULL only counts them.
+static size_t
+plan_chunks (const Disassembler *d, DisasmChunk *chunks)
+{
+  Elf64_Addr start = d->base;
+  size_t label = 0;
+  size_t n = 0;
+
+  while (start < d->limit)
+    {
+      Elf64_Addr end = d->limit - start > DISASM_CHUNK_MAX
+                           ? start + DISASM_CHUNK_MAX
+                           : d->limit;
+
+      while (label < d->nlabels
+             && d->labels[label].addr - start < DISASM_CHUNK_MIN)
+        label++;
+      if (label < d->nlabels && d->labels[label].addr < end)
+        end = d->labels[label].addr;
+
+      if (chunks != NULL)
+        {
+          chunks[n].addr = start;
+          chunks[n].end = end;
+        }
+      n++;
+      start = end;
+    }
+
+  return n;
+}
+
+// Points the disassembler at a section's bytes and function labels.
+// Returns 0 for sections without code, -1 on error.
+static int
+load_section (Disassembler *d, ElfImage *image, size_t section)
+{
+  Elf64_Shdr scratch;
+  const Elf64_Shdr *shdr = elf_image_shdr (image, section, &scratch);
+  size_t length = image->file->length;
+
+  if (shdr == NULL || !(shdr->sh_flags & SHF_EXECINSTR)
+      || shdr->sh_type == SHT_NOBITS || shdr->sh_size == 0)
+    return 0;
+
+  if (shdr->sh_offset > length || shdr->sh_size > length - shdr->sh_offset
+      || shdr->sh_addr > UINT64_MAX - shdr->sh_size)
+    {
+      fprintf (stderr, "Section %s lies outside the file\n",
+               elf_image_section_name (image, section));
+      return -1;
+    }
+
+  d->code = (const uint8_t *)image->file->buffer + shdr->sh_offset;
+  d->base = shdr->sh_addr;
+  d->limit = shdr->sh_addr + shdr->sh_size;
+  if (collect_labels (d, image, section) != 0)
+    return -1;
+
+  return 1;
+}
+
+static int
+disasm_run (Disassembler *d, ElfImage *image, size_t section, OutBuf *out,
+            int nthreads)
+{
+  STAT_SCOPE (STAT_PHASE_DISASM);
+  int ret = load_section (d, image, section);
+  if (ret <= 0)
+    return ret;
+
+  if (nthreads < 1)
+    nthreads = 1;
+  if (nthreads > POOL_MAX_THREADS)
+    nthreads = POOL_MAX_THREADS;
+
+  size_t nchunks = plan_chunks (d, NULL);
+  size_t per_window = (size_t)nthreads * DISASM_WINDOW_CHUNKS;
+  if (per_window > nchunks)
+    per_window = nchunks;
+
+  DisasmChunk *chunks = calloc (nchunks, sizeof (DisasmChunk));
+  OutBuf *buffers = calloc (per_window, sizeof (OutBuf));
+  int retval = -1;
+
+  if (chunks == NULL || buffers == NULL)
+    {
+      fprintf (stderr, "Failed to allocate memory.\n");
+      goto clean;
+    }
+
+  plan_chunks (d, chunks);
+  for (size_t i = 0; i < per_window; i++)
+    if (outbuf_init (&buffers[i], -1, OUTBUF_DEFAULT_SIZE) != 0)
+      goto clean;
+
+  outbuf_printf (out, "\nDisassembly of section %s:\n",
+                 elf_image_section_name (image, section));
+
+  retval = 0;
+  Elf64_Addr cursor = d->base;
+  for (size_t base = 0; retval == 0 && base < nchunks; base += per_window)
+    {
+      size_t n = nchunks - base;
+      if (n > per_window)
+        n = per_window;
+
+      for (size_t i = 0; i < n; i++)
+        {
+          buffers[i].len = 0;
+          chunks[base + i].out = &buffers[i];
+        }
+
+      d->window = chunks + base;
+      if (pool_run (n, nthreads, disasm_chunk, d) != 0
+          || disasm_handle (d, 0) != 0)
+        {
+          retval = -1;
+          break;
+        }
+
+      // chunks are written in address order whichever worker ran them
+      for (size_t i = 0; i < n; i++)
+        {
+          if (chunks[base + i].failed)
+            {
+              retval = -1;
+              break;
+            }
+          cursor = stitch_chunk (d, &chunks[base + i], cursor, out);
+        }
+    }
+
+clean:
+  if (buffers != NULL)
+    for (size_t i = 0; i < per_window; i++)
+      outbuf_free (&buffers[i]);
+  free (buffers);
+  free (chunks);
+  free (d->labels);
+  d->labels = NULL;
+  d->nlabels = 0;
+  return retval;
+}
+
+int
+disasm_image (ElfImage *image, OutBuf *out, int nthreads)
+{
+  Disassembler *d = malloc (sizeof (Disassembler));
+  if (d == NULL)
+    {
+      fprintf (stderr, "Failed to allocate memory.\n");
+      return -1;
+    }
+
+  int retval = -1;
+  if (disasm_open (d, image) == 0)
+    {
+      retval = 0;
+      for (size_t i = 1; retval == 0 && i < image->shdrs.count; i++)
+        retval = disasm_run (d, image, i, out, nthreads);
+      disasm_close (d);
+    }
+
+  free (d);
+  return retval;
+}
+
+// The menu view decodes only the rows it is asked for.  Rows are named by
+// a position (offset into the concatenated code sections << 2 | kind), so
+// positions order like the rows themselves.  The start of every row shown
+// is remembered in a sparse per-section index, and stepping back or
+// jumping restarts decoding from the closest known start at or before the
+// target, but never more than DISASM_VIEW_RESYNC bytes before it.
+#define ROW_SECTION 0
+#define ROW_LABEL 1
+#define ROW_INSN 2
+#define VIEW_POS(voff, kind) (((uint64_t)(voff) << 2) | (kind))
+#define VIEW_END UINT64_MAX
+#define NO_CHECKPOINT 0xffff
+
+typedef struct
+{
+  size_t index;
+  const uint8_t *code;
+  Elf64_Addr base;
+  Elf64_Addr limit;
+  uint64_t voff; // start in the view, sections follow each other there
+  DisasmLabel *labels;
+  size_t nlabels;
+  uint16_t *checkpoints; // per DISASM_INDEX_STRIDE bytes, first known start
+} ViewSection;
+
+struct _DisasmView
+{
+  Disassembler d;
+  const ElfImage *image;
+  ViewSection *sections;
+  size_t nsections;
+};
+
+static void
+view_enter (DisasmView *view, size_t s)
+{
+  ViewSection *sec = &view->sections[s];
+
+  view->d.code = sec->code;
+  view->d.base = sec->base;
+  view->d.limit = sec->limit;
+  view->d.labels = sec->labels;
+  view->d.nlabels = sec->nlabels;
+}
+
+static long
+view_section_at (const DisasmView *view, uint64_t voff)
+{
+  size_t lo = 0;
+  size_t hi = view->nsections;
+
+  while (lo < hi)
+    {
+      size_t mid = lo + (hi - lo) / 2;
+      const ViewSection *sec = &view->sections[mid];
+      if (voff < sec->voff)
+        hi = mid;
+      else if (voff - sec->voff >= sec->limit - sec->base)
+        lo = mid + 1;
+      else
+        return (long)mid;
+    }
+
+  return -1;
+}
+
+static void
+record_checkpoint (ViewSection *sec, Elf64_Addr addr)
+{
+  size_t bucket = (addr - sec->base) / DISASM_INDEX_STRIDE;
+  uint16_t offset = (addr - sec->base) % DISASM_INDEX_STRIDE;
+
+  if (sec->checkpoints[bucket] == NO_CHECKPOINT
+      || offset < sec->checkpoints[bucket])
+    sec->checkpoints[bucket] = offset;
+}
+
+// Closest address at or before addr known to start an instruction.  With
+// none within DISASM_VIEW_RESYNC bytes, decoding starts that far back at a
+// guess instead, and *known is cleared: variable width code falls back
+// into step within a few instructions, as the chunks of -d do, so the rows
+// around addr come out right without decoding from the top of the section.
+static Elf64_Addr
+view_anchor (const DisasmView *view, const ViewSection *sec, Elf64_Addr addr,
+             int *known)
+{
+  *known = 1;
+  if (view->d.fixed_width)
+    return addr - (addr - sec->base) % view->d.min_insn;
+
+  Elf64_Addr floor = addr - sec->base > DISASM_VIEW_RESYNC
+                         ? addr - DISASM_VIEW_RESYNC
+                         : sec->base;
+  Elf64_Addr best = sec->base;
+  size_t l = label_lower_bound (sec->labels, sec->nlabels, addr + 1);
+  if (l > 0 && sec->labels[l - 1].addr > best)
+    best = sec->labels[l - 1].addr;
+
+  for (size_t b = (addr - sec->base) / DISASM_INDEX_STRIDE;; b--)
+    {
+      Elf64_Addr bucket = sec->base + b * DISASM_INDEX_STRIDE;
+      if (bucket + DISASM_INDEX_STRIDE <= best
+          || bucket + DISASM_INDEX_STRIDE <= floor)
+        break;
+      if (sec->checkpoints[b] != NO_CHECKPOINT
+          && bucket + sec->checkpoints[b] <= addr)
+        {
+          if (bucket + sec->checkpoints[b] > best)
+            best = bucket + sec->checkpoints[b];
+          break;
+        }
+      if (b == 0)
+        break;
+    }
+
+  if (best < floor)
+    {
+      *known = 0;
+      return floor;
+    }
+
+  return best;
+}
+
+// first row of the instruction at addr
+static uint64_t
+view_insn_pos (const ViewSection *sec, Elf64_Addr addr)
+{
+  uint64_t voff = sec->voff + (addr - sec->base);
+  size_t l = label_lower_bound (sec->labels, sec->nlabels, addr);
+
+  if (addr == sec->base)
+    return VIEW_POS (voff, ROW_SECTION);
+  if (l < sec->nlabels && sec->labels[l].addr == addr)
+    return VIEW_POS (voff, ROW_LABEL);
+  return VIEW_POS (voff, ROW_INSN);
+}
+
+static void
+format_row (char *text, const Elf64_Addr addr, const uint8_t *bytes,
+            size_t len, const char *mnemonic, const char *op_str)
+{
+  char hex[3 * DISASM_BYTES_PER_LINE + 2];
+  size_t n = len < DISASM_BYTES_PER_LINE ? len : DISASM_BYTES_PER_LINE;
+  char *p = hex;
+
+  for (size_t i = 0; i < n; i++)
+    {
+      *p++ = hex_digits[bytes[i] >> 4];
+      *p++ = hex_digits[bytes[i] & 0xf];
+      *p++ = ' ';
+    }
+  if (len > n)
+    *p++ = '+';
+  *p = '\0';
+
+  snprintf (text, VIEW_ROW_WIDTH, "%16lx:  %-22s %-7s %s", addr, hex,
+            mnemonic, op_str);
+}
+
+// Produces the row at pos, or only steps over it when row is NULL, and
+// returns the position of the next one.  VIEW_END past the last row.
+static uint64_t
+view_row (DisasmView *view, uint64_t pos, ViewRow *row)
+{
+  long s = view_section_at (view, pos >> 2);
+  if (pos == VIEW_END || s < 0)
+    return VIEW_END;
+
+  ViewSection *sec = &view->sections[s];
+  Elf64_Addr addr = sec->base + ((pos >> 2) - sec->voff);
+  view_enter (view, (size_t)s);
+
+  if (row != NULL)
+    row->pos = pos;
+
+  switch (pos & 3)
+    {
+    case ROW_SECTION:
+      if (row != NULL)
+        snprintf (row->text, VIEW_ROW_WIDTH, "Disassembly of section %s:",
+                  elf_image_section_name (view->image, sec->index));
+      if (sec->nlabels > 0 && sec->labels[0].addr == addr)
+        return VIEW_POS (pos >> 2, ROW_LABEL);
+      return VIEW_POS (pos >> 2, ROW_INSN);
+    case ROW_LABEL:
+      if (row != NULL)
+        {
+          size_t l = label_lower_bound (sec->labels, sec->nlabels, addr);
+          snprintf (row->text, VIEW_ROW_WIDTH, "%016lx <%s>:", addr,
+                    sec->labels[l].name);
+        }
+      return VIEW_POS (pos >> 2, ROW_INSN);
+    default:
+      break;
+    }
+
+  // rows only stepped over may still be falling into step after a guessed
+  // restart; the ones shown are where decoding is trusted to restart
+  if (row != NULL)
+    record_checkpoint (sec, addr);
+
+  size_t l = label_lower_bound (sec->labels, sec->nlabels, addr);
+  Elf64_Addr stop = insn_stop (&view->d, l, addr);
+  size_t len = decode_insn (&view->d, 0, addr, stop);
+  if (row != NULL)
+    {
+      const cs_insn *insn = view->d.insns[0];
+      if (len != 0)
+        format_row (row->text, addr, insn->bytes, len, insn->mnemonic,
+                    insn->op_str);
+    }
+  if (len == 0)
+    {
+      len = bad_length (&view->d, addr, stop);
+      if (row != NULL)
+        format_row (row->text, addr, sec->code + (addr - sec->base), len,
+                    "(bad)", "");
+    }
+
+  addr += len;
+  if (addr < sec->limit)
+    return view_insn_pos (sec, addr);
+  if ((size_t)s + 1 < view->nsections)
+    return VIEW_POS (view->sections[s + 1].voff, ROW_SECTION);
+
+  return VIEW_END;
+}
+
+static int
+view_rows (void *ctx, uint64_t pos, ViewRow *rows, int n)
+{
+  STAT_SCOPE (STAT_PHASE_DISASM);
+  DisasmView *view = ctx;
+  int i = 0;
+
+  while (i < n && pos != VIEW_END)
+    pos = view_row (view, pos, &rows[i++]);
+
+  return i;
+}
+
+// a row position strictly before pos that decoding can start from
+static uint64_t
+view_restart (DisasmView *view, uint64_t pos)
+{
+  const ViewSection *last = &view->sections[view->nsections - 1];
+  uint64_t voff = pos == VIEW_END ? last->voff + (last->limit - last->base)
+                                  : pos >> 2;
+  long s = view_section_at (view, voff);
+
+  // start of a section: back up into the end of the previous one
+  if (s < 0 || voff == view->sections[s].voff)
+    {
+      s = s < 0 ? (long)view->nsections - 1 : s - 1;
+      if (s < 0)
+        return VIEW_POS (0, ROW_SECTION);
+      voff = view->sections[s].voff
+             + (view->sections[s].limit - view->sections[s].base);
+    }
+
+  const ViewSection *sec = &view->sections[s];
+  Elf64_Addr addr = sec->base + (voff - sec->voff);
+  int known;
+  return view_insn_pos (sec, view_anchor (view, sec, addr - 1, &known));
+}
+
+static uint64_t
+view_back (void *ctx, uint64_t pos, int n)
+{
+  DisasmView *view = ctx;
+  uint64_t first = VIEW_POS (0, ROW_SECTION);
+
+  if (n <= 0 || pos == first)
+    return pos;
+
+  uint64_t *ring = malloc ((size_t)n * sizeof (uint64_t));
+  if (ring == NULL)
+    return pos;
+
+  // decode forward from ever earlier restart points until at least n
+  // rows lie between the restart point and pos
+  uint64_t start = pos;
+  uint64_t result = first;
+  for (;;)
+    {
+      start = view_restart (view, start);
+
+      size_t count = 0;
+      for (uint64_t p = start; p < pos; p = view_row (view, p, NULL))
+        ring[count++ % (size_t)n] = p;
+
+      if (count >= (size_t)n)
+        {
+          result = ring[count % (size_t)n];
+          break;
+        }
+      if (start == first)
+        break;
+    }
+
+  free (ring);
+  return result;
+}
+
+static int
+view_seek (void *ctx, uint64_t addr, uint64_t *pos)
+{
+  DisasmView *view = ctx;
+
+  for (size_t s = 0; s < view->nsections; s++)
+    {
+      ViewSection *sec = &view->sections[s];
+      if (addr < sec->base || addr >= sec->limit)
+        continue;
+
+      view_enter (view, s);
+      int known;
+      Elf64_Addr pc = view_anchor (view, sec, addr, &known);
+      for (;;)
+        {
+          size_t l = label_lower_bound (sec->labels, sec->nlabels, pc);
+          Elf64_Addr stop = insn_stop (&view->d, l, pc);
+
+          if (known)
+            record_checkpoint (sec, pc);
+          size_t len = decode_insn (&view->d, 0, pc, stop);
+          if (len == 0)
+            len = bad_length (&view->d, pc, stop);
+          if (addr - pc < len)
+            break;
+          pc += len;
+        }
+
+      *pos = view_insn_pos (sec, pc);
+      return 0;
+    }
+
+  return -1;
+}
+
+static int
+compare_view_sections (const void *a, const void *b)
+{
+  const ViewSection *x = a;
+  const ViewSection *y = b;
+
+  return x->base < y->base ? -1 : x->base > y->base;
+}
+
+DisasmView *
+disasm_view_open (ElfImage *image, PagedView *paged)
+{
+  DisasmView *view = calloc (1, sizeof (DisasmView));
+  if (view == NULL)
+    {
+      fprintf (stderr, "Failed to allocate memory.\n");
+      return NULL;
+    }
+
+  view->image = image;
+  if (disasm_open (&view->d, image) != 0)
+    {
+      free (view);
+      return NULL;
+    }
+
+  view->sections = calloc (image->shdrs.count + 1, sizeof (ViewSection));
+  if (view->sections == NULL || disasm_handle (&view->d, 0) != 0)
+    goto fail;
+
+  for (size_t i = 1; i < image->shdrs.count; i++)
+    {
+      int ret = load_section (&view->d, image, i);
+      if (ret < 0)
+        goto fail;
+      if (ret == 0)
+        continue;
+
+      ViewSection *sec = &view->sections[view->nsections++];
+      sec->index = i;
+      sec->code = view->d.code;
+      sec->base = view->d.base;
+      sec->limit = view->d.limit;
+      sec->labels = view->d.labels;
+      sec->nlabels = view->d.nlabels;
+      view->d.labels = NULL;
+
+      size_t buckets = (sec->limit - sec->base + DISASM_INDEX_STRIDE - 1)
+                       / DISASM_INDEX_STRIDE;
+      sec->checkpoints = robust_malloc (buckets * sizeof (uint16_t));
+      if (sec->checkpoints == NULL)
+        goto fail;
+      memset (sec->checkpoints, 0xff, buckets * sizeof (uint16_t));
+    }
+
+  if (view->nsections == 0)
+    {
+      fprintf (stderr, "No executable sections to disassemble\n");
+      goto fail;
+    }
+
+  qsort (view->sections, view->nsections, sizeof (ViewSection),
+         compare_view_sections);
+
+  // relocatable objects put every section at 0, so the view lays them
+  // out back to back instead of by address
+  uint64_t voff = 0;
+  for (size_t s = 0; s < view->nsections; s++)
+    {
+      view->sections[s].voff = voff;
+      voff += view->sections[s].limit - view->sections[s].base;
+    }
+
+  paged->ctx = view;
+  paged->first = VIEW_POS (0, ROW_SECTION);
+  paged->rows = view_rows;
+  paged->back = view_back;
+  paged->seek = view_seek;
+
+  return view;
+
+fail:
+  disasm_view_close (view);
+  return NULL;
+}
+
+void
+disasm_view_close (DisasmView *view)
+{
+  if (view == NULL)
+    return;
+
+  for (size_t s = 0; view->sections != NULL && s < view->nsections; s++)
+    {
+      free (view->sections[s].labels);
+      free (view->sections[s].checkpoints);
+    }
+
+  free (view->sections);
+  disasm_close (&view->d);
+  free (view);
+}
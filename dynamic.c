@@ -0,0 +1,340 @@
+#ifdef __APPLE__
+#include <libelf/libelf.h>
+#elif __linux__
+#include <libelf.h>
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./include/dynamic.h"
+#include "./include/elf_image.h"
+#include "./include/fileio.h"
+#include "./include/my_elf.h"
+#include "./include/stats.h"
+#include "./include/strtab.h"
+
+static const char *d_tag_id[] = {
+#include "./include/d_tag_strings.h"
+};
+
+#define ARRAY_SIZE(arr) (sizeof (arr) / sizeof ((arr)[0]))
+
+// Finds the file bytes behind an address through the PT_LOAD segments;
+// avail is how many of them the segment and the file still hold.
+int
+elf_image_vaddr_offset (const ElfImage *image, Elf64_Addr vaddr,
+                        Elf64_Off *offset, size_t *avail)
+{
+  for (size_t i = 0; i < image->phdrs.count; i++)
+    {
+      Elf64_Phdr scratch;
+      const Elf64_Phdr *ph = elf_image_phdr (image, i, &scratch);
+      if (ph->p_type != PT_LOAD || vaddr < ph->p_vaddr
+          || vaddr - ph->p_vaddr >= ph->p_filesz)
+        continue;
+
+      Elf64_Off delta = vaddr - ph->p_vaddr;
+      if (ph->p_offset > image->file->length
+          || delta >= image->file->length - ph->p_offset)
+        return -1;
+
+      *offset = ph->p_offset + delta;
+      *avail = ph->p_filesz - delta;
+      if (*avail > image->file->length - *offset)
+        *avail = image->file->length - *offset;
+      return 0;
+    }
+
+  return -1;
+}
+
+// where the table is: the SHT_DYNAMIC section, else the PT_DYNAMIC segment
+static int
+find_dynamic_table (const ElfImage *image, DynamicInfo *dyn, size_t *size,
+                    size_t *strtab_section)
+{
+  for (size_t i = 1; i < image->shdrs.count; i++)
+    {
+      Elf64_Shdr scratch;
+      const Elf64_Shdr *sh = elf_image_shdr (image, i, &scratch);
+      if (sh->sh_type != SHT_DYNAMIC)
+        continue;
+      dyn->section = i;
+      dyn->offset = sh->sh_offset;
+      *size = sh->sh_size;
+      *strtab_section = sh->sh_link;
+      return 0;
+    }
+
+  for (size_t i = 0; i < image->phdrs.count; i++)
+    {
+      Elf64_Phdr scratch;
+      const Elf64_Phdr *ph = elf_image_phdr (image, i, &scratch);
+      if (ph->p_type != PT_DYNAMIC)
+        continue;
+      dyn->offset = ph->p_offset;
+      *size = ph->p_filesz;
+      *strtab_section = 0;
+      return 0;
+    }
+
+  return -1;
+}
+
+// the linked string table section when it is one, else DT_STRTAB/DT_STRSZ
+// as the loader sees them
+static void
+find_dynamic_strings (const ElfImage *image, DynamicInfo *dyn,
+                      size_t strtab_section)
+{
+  const FileContents *file = image->file;
+
+  if (strtab_section != 0 && strtab_section < image->shdrs.count)
+    {
+      Elf64_Shdr scratch;
+      const Elf64_Shdr *sh = elf_image_shdr (image, strtab_section, &scratch);
+      if (sh->sh_type == SHT_STRTAB && sh->sh_offset <= file->length
+          && sh->sh_size <= file->length - sh->sh_offset)
+        {
+          dyn->strtab = (const char *)file->buffer + sh->sh_offset;
+          dyn->strtab_size = strtab_terminated (dyn->strtab, sh->sh_size);
+          return;
+        }
+    }
+
+  Elf64_Addr addr = 0;
+  Elf64_Xword size = 0;
+  int have_addr = 0;
+  for (size_t i = 0; i < dyn->count; i++)
+    if (dyn->tag[i] == DT_STRTAB)
+      {
+        addr = dyn->val[i];
+        have_addr = 1;
+      }
+    else if (dyn->tag[i] == DT_STRSZ)
+      size = dyn->val[i];
+
+  Elf64_Off offset;
+  size_t avail;
+  if (!have_addr || elf_image_vaddr_offset (image, addr, &offset, &avail) != 0)
+    return;
+
+  if (size > avail)
+    size = avail;
+  dyn->strtab = (const char *)file->buffer + offset;
+  dyn->strtab_size = strtab_terminated (dyn->strtab, size);
+}
+
+// Decoded on first use and kept with the image.  A table that does not fit
+// in the file is cut at the file's end.
+DynamicInfo *
+elf_image_dynamic (ElfImage *image)
+{
+  if (image->dynamic != NULL)
+    return image->dynamic;
+
+  STAT_SCOPE (STAT_PHASE_PARSE);
+  const FileContents *file = image->file;
+  const ElfLayout *layout = image->layout;
+
+  DynamicInfo *dyn = arena_alloc (image->arena, sizeof (DynamicInfo));
+  if (dyn == NULL)
+    return NULL;
+  memset (dyn, 0, sizeof (DynamicInfo));
+
+  size_t size;
+  size_t strtab_section;
+  if (find_dynamic_table (image, dyn, &size, &strtab_section) != 0
+      || dyn->offset > file->length)
+    {
+      image->dynamic = dyn;
+      return dyn;
+    }
+
+  if (size > file->length - dyn->offset)
+    size = file->length - dyn->offset;
+  size_t n = size / layout->dyn_size;
+
+  dyn->tag = arena_alloc (image->arena, n * sizeof (Elf64_Sxword));
+  dyn->val = arena_alloc (image->arena, n * sizeof (Elf64_Xword));
+  if (dyn->tag == NULL || dyn->val == NULL)
+    return NULL;
+
+  ElfDynColumns columns = { dyn->tag, dyn->val };
+  layout->dyns ((const char *)file->buffer + dyn->offset, n, &columns);
+  STAT_ADD (STAT_ENTRIES_DECODED, n);
+
+  dyn->count = n;
+  for (size_t i = 0; i < n; i++)
+    if (dyn->tag[i] == DT_NULL)
+      {
+        dyn->count = i + 1;
+        break;
+      }
+
+  find_dynamic_strings (image, dyn, strtab_section);
+
+  size_t nneeded = 0;
+  for (size_t i = 0; i < dyn->count; i++)
+    nneeded += dyn->tag[i] == DT_NEEDED;
+
+  dyn->needed = arena_alloc (image->arena, nneeded * sizeof (char *));
+  if (dyn->needed == NULL)
+    return NULL;
+
+  for (size_t i = 0; i < dyn->count; i++)
+    {
+      switch (dyn->tag[i])
+        {
+        case DT_NEEDED:
+          {
+            const char *name = dynamic_string (dyn, dyn->val[i]);
+            if (name != NULL)
+              dyn->needed[dyn->nneeded++] = name;
+          }
+          break;
+        case DT_SONAME:
+          dyn->soname = dynamic_string (dyn, dyn->val[i]);
+          break;
+        case DT_RPATH:
+          dyn->rpath = dynamic_string (dyn, dyn->val[i]);
+          break;
+        case DT_RUNPATH:
+          dyn->runpath = dynamic_string (dyn, dyn->val[i]);
+          break;
+        case DT_FLAGS:
+          dyn->flags = dyn->val[i];
+          break;
+        case DT_FLAGS_1:
+          dyn->flags_1 = dyn->val[i];
+          break;
+        }
+    }
+
+  image->dynamic = dyn;
+  return dyn;
+}
+
+// a string of the dynamic string table, NULL unless it ends inside it
+const char *
+dynamic_string (const DynamicInfo *dyn, Elf64_Xword offset)
+{
+  if (dyn->strtab == NULL || offset >= dyn->strtab_size)
+    return NULL;
+
+  return dyn->strtab + offset;
+}
+
+int
+dynamic_tag_is_string (Elf64_Sxword tag)
+{
+  switch (tag)
+    {
+    case DT_NEEDED:
+    case DT_SONAME:
+    case DT_RPATH:
+    case DT_RUNPATH:
+    case DT_AUXILIARY:
+    case DT_FILTER:
+    case DT_CONFIG:
+    case DT_DEPAUDIT:
+    case DT_AUDIT:
+      return 1;
+    default:
+      return 0;
+    }
+}
+
+const char *
+dynamic_tag_name (Elf64_Sxword tag, char *buf, size_t size)
+{
+  if (tag >= 0 && (size_t)tag < ARRAY_SIZE (d_tag_id)
+      && d_tag_id[tag] != NULL)
+    return d_tag_id[tag];
+
+  switch (tag)
+    {
+    case DT_GNU_PRELINKED:
+      return "GNU_PRELINKED";
+    case DT_GNU_CONFLICTSZ:
+      return "GNU_CONFLICTSZ";
+    case DT_GNU_LIBLISTSZ:
+      return "GNU_LIBLISTSZ";
+    case DT_CHECKSUM:
+      return "CHECKSUM";
+    case DT_PLTPADSZ:
+      return "PLTPADSZ";
+    case DT_MOVEENT:
+      return "MOVEENT";
+    case DT_MOVESZ:
+      return "MOVESZ";
+    case DT_POSFLAG_1:
+      return "POSFLAG_1";
+    case DT_SYMINSZ:
+      return "SYMINSZ";
+    case DT_SYMINENT:
+      return "SYMINENT";
+    case DT_GNU_HASH:
+      return "GNU_HASH";
+    case DT_TLSDESC_PLT:
+      return "TLSDESC_PLT";
+    case DT_TLSDESC_GOT:
+      return "TLSDESC_GOT";
+    case DT_GNU_CONFLICT:
+      return "GNU_CONFLICT";
+    case DT_GNU_LIBLIST:
+      return "GNU_LIBLIST";
+    case DT_CONFIG:
+      return "CONFIG";
+    case DT_DEPAUDIT:
+      return "DEPAUDIT";
+    case DT_AUDIT:
+      return "AUDIT";
+    case DT_PLTPAD:
+      return "PLTPAD";
+    case DT_MOVETAB:
+      return "MOVETAB";
+    case DT_SYMINFO:
+      return "SYMINFO";
+    case DT_VERSYM:
+      return "VERSYM";
+    case DT_RELACOUNT:
+      return "RELACOUNT";
+    case DT_RELCOUNT:
+      return "RELCOUNT";
+    case DT_FLAGS_1:
+      return "FLAGS_1";
+    case DT_VERDEF:
+      return "VERDEF";
+    case DT_VERDEFNUM:
+      return "VERDEFNUM";
+    case DT_VERNEED:
+      return "VERNEED";
+    case DT_VERNEEDNUM:
+      return "VERNEEDNUM";
+    case DT_AUXILIARY:
+      return "AUXILIARY";
+    case DT_FILTER:
+      return "FILTER";
+    case DT_ANDROID_REL:
+      return "ANDROID_REL";
+    case DT_ANDROID_RELSZ:
+      return "ANDROID_RELSZ";
+    case DT_ANDROID_RELA:
+      return "ANDROID_RELA";
+    case DT_ANDROID_RELASZ:
+      return "ANDROID_RELASZ";
+    case DT_ANDROID_RELR:
+      return "ANDROID_RELR";
+    case DT_ANDROID_RELRSZ:
+      return "ANDROID_RELRSZ";
+    case DT_ANDROID_RELRENT:
+      return "ANDROID_RELRENT";
+    default:
+      snprintf (buf, size, "0x%lx", (unsigned long)tag);
+      return buf;
+    }
+}
@@ -0,0 +1,373 @@
+#define _DEFAULT_SOURCE
+
+#ifdef __APPLE__
+#include <libelf/libelf.h>
+#elif __linux__
+#include <libelf.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "./include/elf_cache.h"
+#include "./include/elf_image.h"
+#include "./include/fileio.h"
+#include "./include/my_elf.h"
+#include "./include/stats.h"
+#include "./include/strtab.h"
+#include "./include/symtab.h"
+
+#define CACHE_MAGIC "ELFRDC\0"
+#define CACHE_BYTE_ORDER 0x01020304u
+#define CACHE_ALIGN 16
+#define CACHE_NONE UINT64_MAX
+
+// Offsets into the ELF file are kept instead of pointers so a cache file
+// does not depend on where either file ends up mapped.  Arrays follow the
+// header at CACHE_ALIGN boundaries, each addressed by its offset into the
+// cache file.
+typedef struct
+{
+  uint64_t present;
+  uint64_t section;
+  uint64_t count;
+  uint64_t strtab_offset; // into the ELF file, CACHE_NONE without one
+  uint64_t strtab_size;
+  uint64_t columns; // laid out as by symstore_columns_size
+} CachedSymbols;
+
+typedef struct
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t header_size;
+  uint64_t total_size;
+  FileIdentity key;
+  Elf64_Ehdr ehdr;
+  uint64_t shstrndx;
+  uint64_t shstrtab_offset; // into the ELF file, CACHE_NONE without one
+  uint64_t shstrtab_size;
+  uint64_t name_offsets;
+  CachedSymbols symbols[2];
+} CacheHeader;
+
+// set once before any file is opened; NULL leaves caching off
+static const char *cache_dir = NULL;
+
+int
+elf_cache_set_dir (const char *dir)
+{
+  if (mkdir (dir, 0777) != 0 && errno != EEXIST)
+    {
+      fprintf (stderr, "Failed to create cache directory %s.\n", dir);
+      return -1;
+    }
+
+  cache_dir = dir;
+  return 0;
+}
+
+static int
+cache_path (const FileIdentity *key, char *path, size_t size)
+{
+  int n = snprintf (path, size, "%s/%016" PRIx64 "-%016" PRIx64 ".elfcache",
+                    cache_dir, key->dev, key->inode);
+
+  return n < 0 || (size_t)n >= size ? -1 : 0;
+}
+
+static size_t
+cache_align (size_t offset)
+{
+  return (offset + CACHE_ALIGN - 1) & ~(size_t)(CACHE_ALIGN - 1);
+}
+
+static int
+in_bounds (uint64_t offset, uint64_t length, uint64_t size)
+{
+  return offset <= size && length <= size - offset;
+}
+
+static int
+restore_symbols (ElfImage *image, int slot, const CachedSymbols *cached)
+{
+  const FileContents *file = image->file;
+
+  if (!cached->present)
+    return 0;
+
+  if (cached->count > image->cache_size
+      || !in_bounds (cached->columns, symstore_columns_size (cached->count),
+                     image->cache_size)
+      || (cached->strtab_offset != CACHE_NONE
+          && !in_bounds (cached->strtab_offset, cached->strtab_size,
+                         file->length)))
+    return -1;
+
+  SymbolStore *store = arena_alloc (image->arena, sizeof (SymbolStore));
+  if (store == NULL)
+    return -1;
+
+  memset (store, 0, sizeof (SymbolStore));
+  symstore_bind_columns (store, (char *)image->cache + cached->columns,
+                         cached->count);
+  store->count = cached->count;
+  store->section = cached->section;
+  if (cached->strtab_offset != CACHE_NONE)
+    {
+      store->strtab = file->buffer + cached->strtab_offset;
+      store->strtab_size
+          = strtab_terminated (store->strtab, cached->strtab_size);
+    }
+
+  image->symbols[slot] = store;
+  return 0;
+}
+
+// Everything read back is bounds checked against the two files, so a
+// damaged cache can make a lookup fail but never read outside a mapping.
+static int
+restore_image (ElfImage *image, const CacheHeader *header)
+{
+  const FileContents *file = image->file;
+
+  if (memcmp (header->magic, CACHE_MAGIC, sizeof (header->magic)) != 0
+      || header->version != ELF_CACHE_VERSION
+      || header->byte_order != CACHE_BYTE_ORDER
+      || header->header_size != sizeof (CacheHeader)
+      || header->total_size != image->cache_size
+      || memcmp (&header->key, &file->identity, sizeof (FileIdentity)) != 0)
+    return -1;
+
+  image->ehdr = header->ehdr;
+  image->layout = elf_layout_of (&image->ehdr);
+  if (image->layout == NULL)
+    return -1;
+
+  if (get_elf_phdr_view (file->buffer, file->length, &image->ehdr,
+                         &image->phdrs)
+      != 0
+      || get_elf_shdr_view (file->buffer, file->length, &image->ehdr,
+                            &image->shdrs)
+             != 0)
+    return -1;
+
+  image->shstrndx = header->shstrndx;
+
+  size_t count = image->shdrs.count;
+  if (!in_bounds (header->name_offsets, count * sizeof (uint32_t),
+                  image->cache_size))
+    return -1;
+
+  if (header->shstrtab_offset != CACHE_NONE)
+    {
+      if (!in_bounds (header->shstrtab_offset, header->shstrtab_size,
+                      file->length))
+        return -1;
+      image->shstrtab = file->buffer + header->shstrtab_offset;
+      image->shstrtab_size
+          = strtab_terminated (image->shstrtab, header->shstrtab_size);
+    }
+
+  image->name_offsets
+      = (uint32_t *)((char *)image->cache + header->name_offsets);
+
+  for (int i = 0; i < 2; i++)
+    {
+      if (restore_symbols (image, i, &header->symbols[i]) != 0)
+        return -1;
+    }
+
+  return 0;
+}
+
+int
+elf_cache_load (ElfImage *image, FileContents *file, Arena *arena)
+{
+  memset (image, 0, sizeof (ElfImage));
+  image->file = file;
+  image->arena = arena;
+
+  if (cache_dir == NULL || !file->mapped)
+    return -1;
+
+  STAT_SCOPE (STAT_PHASE_PARSE);
+
+  char path[PATH_MAX];
+  if (cache_path (&file->identity, path, sizeof (path)) != 0)
+    return -1;
+
+  int fd = open (path, O_RDONLY);
+  if (fd == -1)
+    return -1;
+
+  struct stat sb;
+  if (fstat (fd, &sb) != 0 || (size_t)sb.st_size < sizeof (CacheHeader))
+    {
+      close (fd);
+      return -1;
+    }
+
+  void *map = mmap (NULL, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (map == MAP_FAILED)
+    return -1;
+
+  image->cache = map;
+  image->cache_size = (size_t)sb.st_size;
+
+  if (restore_image (image, map) != 0)
+    {
+      munmap (map, (size_t)sb.st_size);
+      memset (image, 0, sizeof (ElfImage));
+      image->file = file;
+      image->arena = arena;
+      return -1;
+    }
+
+  return 0;
+}
+
+static void
+save_symbols (char *blob, size_t offset, const ElfImage *image, int slot,
+              CachedSymbols *cached)
+{
+  const SymbolStore *store = image->symbols[slot];
+
+  cached->present = 1;
+  cached->section = store->section;
+  cached->count = store->count;
+  cached->strtab_offset = CACHE_NONE;
+  if (store->strtab != NULL)
+    {
+      cached->strtab_offset = (uint64_t)(store->strtab - image->file->buffer);
+      cached->strtab_size = store->strtab_size;
+    }
+  cached->columns = offset;
+
+  if (store->count != 0)
+    memcpy (blob + offset, store->value, symstore_columns_size (store->count));
+}
+
+static int
+write_all (int fd, const char *buf, size_t len)
+{
+  while (len > 0)
+    {
+      ssize_t n = write (fd, buf, len);
+      if (n < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          return -1;
+        }
+      buf += n;
+      len -= (size_t)n;
+    }
+
+  return 0;
+}
+
+// Writes the image's parsed tables for the next open.  Symbol tables are
+// decoded here if nothing asked for them yet, so a warm open never has to.
+// The file is written under a temporary name and renamed into place, so
+// concurrent writers and readers only ever see complete files.
+int
+elf_cache_store (ElfImage *image)
+{
+  const FileContents *file = image->file;
+
+  if (cache_dir == NULL || !file->mapped)
+    return 0;
+
+  Elf64_Word types[2] = { SHT_SYMTAB, SHT_DYNSYM };
+  for (int i = 0; i < 2; i++)
+    {
+      if (find_symbol_section (image, types[i]) >= 0
+          && elf_image_symbols (image, types[i]) == NULL)
+        return -1;
+    }
+
+  size_t count = image->shdrs.count;
+  size_t names = cache_align (sizeof (CacheHeader));
+  size_t total = cache_align (names + count * sizeof (uint32_t));
+  size_t columns[2] = { 0, 0 };
+  for (int i = 0; i < 2; i++)
+    {
+      if (image->symbols[i] == NULL)
+        continue;
+      columns[i] = total;
+      total = cache_align (total
+                           + symstore_columns_size (image->symbols[i]->count));
+    }
+
+  char path[PATH_MAX];
+  char tmp[PATH_MAX];
+  if (cache_path (&file->identity, path, sizeof (path)) != 0
+      || snprintf (tmp, sizeof (tmp), "%s/.elfcache-XXXXXX", cache_dir)
+             >= (int)sizeof (tmp))
+    return -1;
+
+  char *blob = robust_malloc (total);
+  if (blob == NULL)
+    return -1;
+  memset (blob, 0, total);
+
+  CacheHeader *header = (CacheHeader *)blob;
+  memcpy (header->magic, CACHE_MAGIC, sizeof (header->magic));
+  header->version = ELF_CACHE_VERSION;
+  header->byte_order = CACHE_BYTE_ORDER;
+  header->header_size = sizeof (CacheHeader);
+  header->total_size = total;
+  header->key = file->identity;
+  header->ehdr = image->ehdr;
+  header->shstrndx = image->shstrndx;
+  header->shstrtab_offset = CACHE_NONE;
+  if (image->shstrtab != NULL)
+    {
+      header->shstrtab_offset = (uint64_t)(image->shstrtab - file->buffer);
+      header->shstrtab_size = image->shstrtab_size;
+    }
+  header->name_offsets = names;
+  if (count != 0)
+    memcpy (blob + names, image->name_offsets, count * sizeof (uint32_t));
+
+  for (int i = 0; i < 2; i++)
+    {
+      if (image->symbols[i] != NULL)
+        save_symbols (blob, columns[i], image, i, &header->symbols[i]);
+    }
+
+  int retval = -1;
+  int fd = mkstemp (tmp);
+  if (fd == -1)
+    goto clean;
+
+  if (write_all (fd, blob, total) != 0)
+    {
+      close (fd);
+      unlink (tmp);
+      goto clean;
+    }
+
+  if (close (fd) != 0 || rename (tmp, path) != 0)
+    {
+      unlink (tmp);
+      goto clean;
+    }
+
+  retval = 0;
+
+clean:
+  free (blob);
+  return retval;
+}
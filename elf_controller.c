@@ -1,3 +1,5 @@
+#define _DEFAULT_SOURCE
+
 #if __APPLE__
 #include <libelf/libelf.h>
 #elif __linux__
@@ -12,10 +14,25 @@
 #include <string.h>
 #include <unistd.h>
 
+#include "./include/bindings.h"
+#include "./include/deps.h"
+#include "./include/disasm.h"
+#include "./include/dynamic.h"
 #include "./include/elf_controller.h"
+#include "./include/elf_hash.h"
+#include "./include/elf_image.h"
 #include "./include/elf_menu.h"
 #include "./include/fileio.h"
+#include "./include/json_writer.h"
 #include "./include/my_elf.h"
+#include "./include/osabi_perfect.h"
+#include "./include/outbuf.h"
+#include "./include/reloc.h"
+#include "./include/s_type_perfect.h"
+#include "./include/stats.h"
+#include "./include/strtab.h"
+#include "./include/symtab.h"
+#include "./include/threadpool.h"
 
 #define err_exit(msg)                                                         \
   do                                                                          \
@@ -51,11 +68,13 @@ const char *elf_s_type_id[] = {
 #include "./include/s_type_strings.h"
 };
 
-static void clean_controller (FileContents **filecontents);
+static void clean_controller (ElfImage **image);
+static void controller_print (const char *str);
+static int get_disasm_threads (void);
 
 // elf header
 static int display_elf_header (void *);
-static void print_elf_header (const Elf64_Ehdr *ehdr);
+static void print_elf_header (const ElfImage *image);
 static Elf64_Half emit_e_type (const Elf64_Ehdr *ehdr);
 static Elf64_Half emit_ei_class (const Elf64_Ehdr *ehdr);
 static Elf64_Half emit_ei_data (const Elf64_Ehdr *ehdr);
@@ -65,11 +84,114 @@ static Elf64_Half emit_e_type (const Elf64_Ehdr *ehdr);
 // program header
 static int display_program_header_table (void *);
 static void print_phdr_main_header_titles (void);
+static void print_program_header_table (const ElfImage *image);
 
 // section header
 static int display_section_header_table (void *);
+static void print_section_header (const ElfImage *image);
 static int get_s_type_index (Elf64_Word type);
 
+// symbol tables
+static void print_symbol_table (ElfImage *image, Elf64_Word sh_type,
+                                int flags);
+static int get_symbol_order (const SymbolStore *store, int flags,
+                             uint32_t **order, size_t *count);
+static void print_symbol_lookup (ElfImage *image, const char *filename);
+
+// symbols printed between checks for a cancelled menu action
+#define SYMBOL_PROGRESS_STEP 4096
+
+// rows of a symbol table view: its title, the column titles, the symbols
+#define SYMBOL_VIEW_HEADER_ROWS 2
+
+typedef struct
+{
+  const ElfImage *image;
+  const SymbolStore *store;
+} SymbolView;
+
+// The relocation tables of an image and their summary as one sequence of
+// rows: each table's title, column titles, entries and a blank line, then
+// the counts per type and per target section.  Rows are formatted on
+// demand, by the batch printer and the paged view alike.
+typedef struct
+{
+  ElfImage *image;
+  RelocSummary summary;
+  const RelocTable **tables; // the tables shown
+  const PackedTable **packed; // what each was expanded from, or NULL
+  const SymbolStore **stores; // symbols of each table shown, or NULL
+  uint64_t *starts; // first row of each table, then of the summary
+  size_t ntables;
+  size_t *types; // type buckets in use
+  size_t ntypes;
+  size_t *sections; // target sections in use, summary.nsections for none
+  size_t nsections;
+} RelocListing;
+
+// relocation rows printed between checks for a cancelled menu action
+#define RELOC_PROGRESS_STEP 4096
+
+// rows of a table besides its entries: title, column titles, blank line
+#define RELOC_TABLE_EXTRA_ROWS 3
+
+// rows of the summary besides its counts: the totals, two column titles
+// and the blank line between the lists
+#define RELOC_SUMMARY_EXTRA_ROWS 4
+
+// rows of the packed relocation savings, shown when there are any: a blank
+// line and five counts
+#define RELOC_PACKED_ROWS 6
+
+static int open_reloc_listing (RelocListing *listing, ElfImage *image,
+                               int dynamic_only);
+static void close_reloc_listing (RelocListing *listing);
+static uint64_t reloc_listing_rows (const RelocListing *listing);
+static void format_reloc_listing_row (const RelocListing *listing,
+                                      uint64_t row, char *buf, size_t size);
+static const char *reloc_symbol_name (const ElfImage *image,
+                                      const SymbolStore *store,
+                                      Elf64_Word sym);
+static void print_relocations (ElfImage *image, int dynamic_only);
+
+static void format_dynamic_value (const DynamicInfo *dyn, size_t i,
+                                  char *buf, size_t size);
+static void print_dynamic_section (ElfImage *image);
+static void print_dependencies (ElfImage *image, const char *filename);
+static void print_bindings (ElfImage *image, const char *filename);
+
+// The string sections of an image as one sequence of rows: each section's
+// title, its non-empty strings and a blank line.  Strings are found through
+// the tables' indexes, so rows anywhere in a .debug_str of hundreds of
+// megabytes are formatted as cheaply as the first ones.
+typedef struct
+{
+  ElfImage *image;
+  StringTable *tables;
+  uint64_t *starts; // first row of each table, then the total
+  size_t ntables;
+} StringListing;
+
+// string rows printed between checks for a cancelled menu action
+#define STRING_PROGRESS_STEP 4096
+
+// rows of a table besides its strings: title and blank line
+#define STRING_TABLE_EXTRA_ROWS 2
+
+static const char *string_dump_range (ElfImage *image, size_t *first,
+                                      size_t *end);
+static int open_string_listing (StringListing *listing, ElfImage *image,
+                                size_t first, size_t end);
+static void close_string_listing (StringListing *listing);
+static size_t format_string_listing_row (const StringListing *listing,
+                                         uint64_t row, char *buf,
+                                         size_t size);
+static int print_string_tables (ElfImage *image);
+
+// machine readable records
+static int emit_json_records (OutBuf *out, ElfImage *image,
+                               const char *filename, int flags);
+
 static int disassemble_code_section (void *);
 static int display_symbol_table (void *);
 static int display_relocation_table (void *);
@@ -96,13 +218,33 @@ MenuItem menu_items[] = {
 };
 int num_menu_items = sizeof (menu_items) / sizeof (MenuItem);
 
+// set while running headless; all output then bypasses curses.  Per thread
+// so several files can be printed concurrently into their own buffers.
+static __thread OutBuf *batch_out = NULL;
+
+// name queried by --lookup; set once before any file is opened
+static const char *lookup_name = NULL;
+
+// symbols -s and --dyn-syms keep besides any --defined-only; set once
+// before any file is opened.  A type below 0 and a size of 0 keep all.
+static int symbol_type_filter = -1;
+static uint64_t symbol_min_size = 0;
+
+// section named by --string-dump=<name>; NULL dumps every string section
+static const char *string_dump_name = NULL;
+
+// threads decoding one file's code; 0 means one per CPU
+static int disasm_threads = 0;
+
+// resolves --deps and --bindings; set once before any file is opened,
+// shared by all threads of a scan
+static Resolver *dep_resolver = NULL;
+
 static void
-clean_controller (FileContents **filecontents)
+clean_controller (ElfImage **image)
 {
-  robust_free ((*filecontents)->buffer);
-  (*filecontents)->buffer = NULL;
-  robust_free (*filecontents);
-  *filecontents = NULL;
+  elf_image_close (*image);
+  *image = NULL;
 }
 
 int
@@ -110,11 +252,11 @@ do_run_controller (const char *const filename)
 {
   int retval = 1;
 
-  FileContents *filecontents = robust_read_file (filename);
-  if (filecontents == NULL)
+  ElfImage *image = elf_image_open (filename);
+  if (image == NULL)
     goto ret;
 
-  MenuConfig config = { "ELF Menu", menu_items, filecontents, num_menu_items };
+  MenuConfig config = { "ELF Menu", menu_items, image, num_menu_items };
   if (init_elf_menu (&config) != 0)
     goto clean;
 
@@ -123,12 +265,172 @@ do_run_controller (const char *const filename)
   retval = 0;
 
 clean:
-  clean_controller (&filecontents);
+  clean_controller (&image);
 
 ret:
   return retval;
 }
 
+// with an arena the image is parsed into it and the caller resets it
+int
+do_batch_to (OutBuf *out, const char *const filename, int flags,
+             int show_name, Arena *arena)
+{
+  STAT_SCOPE (STAT_PHASE_FORMAT);
+  ElfImage *image = elf_image_open_in (filename, arena);
+  if (image == NULL)
+    {
+      fprintf (stderr, "%s: not a readable ELF file\n", filename);
+      if (flags & BATCH_FORMAT_MASK)
+        {
+          JsonWriter jw;
+          json_writer_init (&jw, out, flags & BATCH_FORMAT_NDJSON);
+          json_record_begin (&jw, "error");
+          json_field_str (&jw, "file", filename);
+          json_field_str (&jw, "message", "not a readable ELF file");
+          json_record_end (&jw);
+        }
+      return 1;
+    }
+
+  if (flags & BATCH_FORMAT_MASK)
+    {
+      int retval = emit_json_records (out, image, filename, flags);
+      clean_controller (&image);
+      return retval;
+    }
+
+  batch_out = out;
+
+  if (show_name)
+    format_and_print ("\nFile: ", "%s\n", filename);
+
+  if (flags & BATCH_FILE_HEADER)
+    print_elf_header (image);
+
+  if (flags & BATCH_PROGRAM_HEADERS)
+    {
+      print_program_header_table (image);
+      controller_print ("\n");
+    }
+
+  if (flags & BATCH_SECTION_HEADERS)
+    print_section_header (image);
+
+  if (flags & BATCH_SYMBOLS)
+    print_symbol_table (image, SHT_SYMTAB, flags);
+
+  if (flags & BATCH_DYN_SYMBOLS)
+    print_symbol_table (image, SHT_DYNSYM, flags);
+
+  if (flags & BATCH_RELOCS)
+    print_relocations (image, 0);
+
+  if (flags & BATCH_DYN_RELOCS)
+    print_relocations (image, 1);
+
+  if (flags & BATCH_DYNAMIC)
+    print_dynamic_section (image);
+
+  int retval = 0;
+  if (flags & BATCH_STRINGS)
+    retval |= print_string_tables (image);
+
+  if (flags & BATCH_DEPS)
+    print_dependencies (image, filename);
+
+  if (flags & BATCH_BINDINGS)
+    print_bindings (image, filename);
+
+  if (flags & BATCH_LOOKUP)
+    print_symbol_lookup (image, filename);
+
+  if (flags & BATCH_DISASSEMBLE)
+    retval |= disasm_image (image, out, get_disasm_threads ()) != 0;
+
+  batch_out = NULL;
+  clean_controller (&image);
+
+  return retval;
+}
+
+int
+do_run_batch (int nfiles, char *const files[], int flags)
+{
+  OutBuf out;
+  if (outbuf_init (&out, STDOUT_FILENO, OUTBUF_DEFAULT_SIZE) != 0)
+    return 1;
+
+  int retval = 0;
+  if (flags & BATCH_FORMAT_JSON)
+    json_array_open (&out);
+
+  for (int i = 0; i < nfiles; i++)
+    {
+      // every file yields at least one record, even if only an error
+      if ((flags & BATCH_FORMAT_JSON) && i > 0)
+        json_array_separator (&out);
+      retval |= do_batch_to (&out, files[i], flags, nfiles > 1, NULL);
+    }
+
+  if (flags & BATCH_FORMAT_JSON)
+    json_array_close (&out);
+
+  if (outbuf_flush (&out) != 0)
+    retval = 1;
+
+  outbuf_free (&out);
+
+  return retval;
+}
+
+void
+set_lookup_symbol (const char *name)
+{
+  lookup_name = name;
+}
+
+void
+set_symbol_filter (int type, uint64_t min_size)
+{
+  symbol_type_filter = type;
+  symbol_min_size = min_size;
+}
+
+void
+set_string_dump_section (const char *name)
+{
+  string_dump_name = name;
+}
+
+void
+set_dependency_resolver (Resolver *resolver)
+{
+  dep_resolver = resolver;
+}
+
+void
+set_disasm_threads (int nthreads)
+{
+  disasm_threads = nthreads;
+}
+
+static int
+get_disasm_threads (void)
+{
+  return disasm_threads > 0 ? disasm_threads : pool_default_threads ();
+}
+
+static void
+controller_print (const char *str)
+{
+  STAT_ADD (STAT_FORMAT_CALLS, 1);
+  if (batch_out != NULL)
+    outbuf_puts (batch_out, str);
+  else
+    elfprint (str);
+}
+
 int
 format_and_print (const char *label, const char *format, ...)
 {
@@ -137,6 +439,20 @@ format_and_print (const char *label, const char *format, ...)
       return 1;
     }
 
+  STAT_ADD (STAT_FORMAT_CALLS, 1);
+
+  if (batch_out != NULL)
+    {
+      va_list args;
+
+      outbuf_puts (batch_out, label);
+      va_start (args, format);
+      outbuf_vprintf (batch_out, format, args);
+      va_end (args);
+
+      return 0;
+    }
+
   if (strlen (label) + strlen (format) + 1 > SIZE_TEMPBUF)
     {
       return 1;
@@ -179,13 +495,7 @@ emit_ei_data (const Elf64_Ehdr *ehdr)
 static Elf64_Half
 emit_ei_osabi (const Elf64_Ehdr *ehdr)
 {
-  Elf64_Half elf_ei_osabi = ehdr->e_ident[EI_OSABI];
-  if (elf_ei_osabi >= ELFOSABI_SOLARIS && elf_ei_osabi <= ELFOSABI_OPENBSD)
-    elf_ei_osabi -= 2;
-  else if (elf_ei_osabi >= ELFOSABI_ARM_AEABI)
-    elf_ei_osabi = (ARRAY_SIZE (elf_osabi_id) - 1);
-
-  return elf_ei_osabi;
+  return osabi_lookup (ehdr->e_ident[EI_OSABI]);
 }
 
 static Elf64_Half
@@ -202,9 +512,23 @@ emit_e_type (const Elf64_Ehdr *ehdr)
   return elf_e_type;
 }
 
+// counts that overflowed into section 0 are shown as readelf does, the
+// header field followed by the real value
+static const char *
+format_count (char *buf, size_t size, unsigned int field, size_t value)
+{
+  if (field == value)
+    snprintf (buf, size, "%u", field);
+  else
+    snprintf (buf, size, "%u (%zu)", field, value);
+
+  return buf;
+}
+
 static void
-print_elf_header (const Elf64_Ehdr *ehdr)
+print_elf_header (const ElfImage *image)
 {
+  const Elf64_Ehdr *ehdr = image != NULL ? &image->ehdr : NULL;
   if (!ehdr)
     {
       fprintf (stderr, "Null pointer passed to print_elf_header\n");
@@ -218,6 +542,9 @@ print_elf_header (const Elf64_Ehdr *ehdr)
 
   char buffer[1024];
   char *buf_ptr = buffer;
+  char phnum[32];
+  char shnum[32];
+  char shstrndx[32];
 
   buf_ptr += snprintf (buf_ptr, sizeof (buffer) - (buf_ptr - buffer),
                        "ELF Header:\n  Magic:   ");
@@ -243,10 +570,10 @@ print_elf_header (const Elf64_Ehdr *ehdr)
       "  Flags:                               0x%x\n"
       "  Size of this header:                 %d (bytes)\n"
       "  Size of program headers:             %d (bytes)\n"
-      "  Number of program headers:           %d\n"
+      "  Number of program headers:           %s\n"
       "  Size of section headers:             %d (bytes)\n"
-      "  Number of section headers:           %d\n"
-      "  Section header string table index:   %d\n",
+      "  Number of section headers:           %s\n"
+      "  Section header string table index:   %s\n",
       elf_class_id[elf_ei_class], elf_data_id[elf_ei_data],
       (int)ehdr->e_ident[EI_VERSION], elf_osabi_id[elf_ei_osabi],
       (int)ehdr->e_ident[EI_ABIVERSION], elf_e_type_id[elf_e_type],
@@ -254,25 +581,22 @@ print_elf_header (const Elf64_Ehdr *ehdr)
                                 : elf_e_machine_id[ehdr->e_machine],
       ehdr->e_version, elf_e_version_id[ehdr->e_version], (int)ehdr->e_entry,
       (int)ehdr->e_phoff, (int)ehdr->e_shoff, (int)ehdr->e_flags,
-      (int)ehdr->e_ehsize, (int)ehdr->e_phentsize, (int)ehdr->e_phnum,
-      (int)ehdr->e_shentsize, (int)ehdr->e_shnum, (int)ehdr->e_shstrndx);
-
-  elfprint (buffer);
+      (int)ehdr->e_ehsize, (int)ehdr->e_phentsize,
+      format_count (phnum, sizeof (phnum), ehdr->e_phnum, image->phdrs.count),
+      (int)ehdr->e_shentsize,
+      format_count (shnum, sizeof (shnum), ehdr->e_shnum, image->shdrs.count),
+      format_count (shstrndx, sizeof (shstrndx), ehdr->e_shstrndx,
+                    image->shstrndx));
+
+  controller_print (buffer);
 }
 
 static int
 display_elf_header (void *v)
 {
-  FileContents *filecontents = (FileContents *)v;
-
-  Elf64_Ehdr ehdr = { 0 };
-  if (get_elf_header (filecontents->buffer, filecontents->length, &ehdr) != 0)
-    {
-      print_and_wait ("Failed to get ELF header\n");
-      return 1;
-    }
+  ElfImage *image = (ElfImage *)v;
 
-  print_elf_header (&ehdr);
+  print_elf_header (image);
   print_and_wait ("\n");
 
   return 0;
@@ -288,180 +612,74 @@ print_phdr_main_header_titles (void)
   snprintf (header + strlen (header), sizeof (header) - strlen (header),
             PHDR_SUBHEADER_TITLES_FORMAT, "FileSiz", "MemSiz", "Flags",
             "Align");
-  elfprint (header);
+  controller_print (header);
 }
 
-static int
-display_program_header_table (void *v)
+static void
+print_program_header_table (const ElfImage *image)
 {
-  FileContents *filecontents = (FileContents *)v;
-
-  Elf64_Ehdr ehdr = { 0 };
-  if (get_elf_header (filecontents->buffer, filecontents->length, &ehdr) != 0)
-    {
-      print_and_wait ("Failed to get ELF header\n");
-      return 1;
-    }
+  const FileContents *filecontents = image->file;
+  const Elf64_Ehdr *ehdr = &image->ehdr;
 
-  Elf64_Half elf_e_type = emit_e_type (&ehdr);
-  Elf64_Phdr phdr[ehdr.e_phnum];
+  Elf64_Half elf_e_type = emit_e_type (ehdr);
   format_and_print ("",
                     "\nElf file type is %s\nEntry point 0x%x\nThere are %d "
                     "program headers, starting at offset %d\n\n",
-                    elf_e_type_id[elf_e_type], (int)ehdr.e_entry,
-                    (int)ehdr.e_phnum, (int)ehdr.e_phentsize);
+                    elf_e_type_id[elf_e_type], (int)ehdr->e_entry,
+                    (int)image->phdrs.count, (int)ehdr->e_phentsize);
 
   print_phdr_main_header_titles ();
 
-  memset (phdr, 0, sizeof (phdr));
-
-  for (int i = 0; i < ehdr.e_phnum; i++)
+  for (size_t i = 0; i < image->phdrs.count; i++)
     {
-      get_elf_phdr (filecontents->buffer, i * ehdr.e_phentsize, &ehdr,
-                    &(phdr[i]));
+      Elf64_Phdr scratch;
+      const Elf64_Phdr *phdr = elf_image_phdr (image, i, &scratch);
 
-      format_and_print ("", "[%3d] %-14s 0x%016lx 0x%016lx 0x%016lx\n", i,
-                        get_p_type (phdr[i].p_type), phdr[i].p_offset,
-                        phdr[i].p_vaddr, phdr[i].p_paddr);
+      format_and_print ("", "[%3d] %-14s 0x%016lx 0x%016lx 0x%016lx\n",
+                        (int)i, get_p_type (phdr->p_type), phdr->p_offset,
+                        phdr->p_vaddr, phdr->p_paddr);
 
-      if (phdr[i].p_type == PT_INTERP)
+      if (phdr->p_type == PT_INTERP && phdr->p_filesz > 0
+          && phdr->p_offset < filecontents->length
+          && phdr->p_filesz <= filecontents->length - phdr->p_offset)
         {
-          char interp_path[phdr[i].p_filesz];
-          memcpy (interp_path, filecontents->buffer + phdr[i].p_offset,
-                  phdr[i].p_filesz);
-          interp_path[phdr[i].p_filesz - 1] = '\0';
-          char interp_display_buffer[strlen (interp_path) + 100];
-          strcpy (interp_display_buffer,
-                  "      [Requesting program interpreter: ");
-          strcat (interp_display_buffer, interp_path);
-          strcat (interp_display_buffer, "]\n");
-          elfprint (interp_display_buffer);
+          const char *interp_path = filecontents->buffer + phdr->p_offset;
+          format_and_print ("      [Requesting program interpreter: ",
+                            "%.*s]\n",
+                            (int)strnlen (interp_path, phdr->p_filesz),
+                            interp_path);
         }
       char flags_buf[4] = { 0 };
       format_and_print ("", "%-20s 0x%016lx 0x%016lx %-6s 0x%06lx\n", " ",
-                        phdr[i].p_filesz, phdr[i].p_memsz,
-                        get_p_flags (phdr[i].p_flags, flags_buf),
-                        phdr[i].p_align);
+                        phdr->p_filesz, phdr->p_memsz,
+                        get_p_flags (phdr->p_flags, flags_buf),
+                        phdr->p_align);
     }
+}
+
+static int
+display_program_header_table (void *v)
+{
+  ElfImage *image = (ElfImage *)v;
 
+  print_program_header_table (image);
   print_and_wait ("\n");
+
   return 0;
 }
 
 static int
 get_s_type_index (Elf64_Word type)
 {
-  int offs;
-  switch (type)
-    {
-    case SHT_PROGBITS:
-      offs = 1;
-      break;
-    case SHT_SYMTAB:
-      offs = 2;
-      break;
-    case SHT_STRTAB:
-      offs = 3;
-      break;
-    case SHT_RELA:
-      offs = 4;
-      break;
-    case SHT_HASH:
-      offs = 5;
-      break;
-    case SHT_DYNAMIC:
-      offs = 6;
-      break;
-    case SHT_NOTE:
-      offs = 7;
-      break;
-    case SHT_NOBITS:
-      offs = 8;
-      break;
-    case SHT_REL:
-      offs = 9;
-      break;
-    case SHT_SHLIB:
-      offs = 10;
-      break;
-    case SHT_DYNSYM:
-      offs = 11;
-      break;
-    case SHT_INIT_ARRAY:
-      offs = 12;
-      break;
-    case SHT_FINI_ARRAY:
-      offs = 13;
-      break;
-    case SHT_PREINIT_ARRAY:
-      offs = 14;
-      break;
-    case SHT_GROUP:
-      offs = 15;
-      break;
-    case SHT_SYMTAB_SHNDX:
-      offs = 16;
-      break;
-    case SHT_NUM:
-      offs = 17;
-      break;
-    case SHT_LOOS:
-      offs = 18;
-      break;
-    case SHT_GNU_ATTRIBUTES:
-      offs = 19;
-      break;
-    case SHT_GNU_HASH:
-      offs = 20;
-      break;
-    case SHT_GNU_LIBLIST:
-      offs = 21;
-      break;
-    case SHT_CHECKSUM:
-      offs = 22;
-      break;
-    case SHT_LOSUNW:
-      offs = 23;
-      break;
-    case SHT_SUNW_COMDAT:
-      offs = 24;
-      break;
-    case SHT_SUNW_syminfo:
-      offs = 25;
-      break;
-    case SHT_GNU_verdef:
-      offs = 26;
-      break;
-    case SHT_GNU_verneed:
-      offs = 27;
-      break;
-    case SHT_GNU_versym:
-      offs = 28;
-      break;
-    case SHT_LOPROC:
-      offs = 29;
-      break;
-    case SHT_HIPROC:
-      offs = 30;
-      break;
-    case SHT_LOUSER:
-      offs = 31;
-      break;
-    case SHT_HIUSER:
-      offs = 32;
-      break;
-    default:
-      offs = 0;
-    }
-  return offs;
+  return s_type_lookup (type);
 }
 
 static void
-print_section_header (const Elf64_Shdr *section, const Elf64_Ehdr *ehdr,
-                      const char *data)
+print_section_header (const ElfImage *image)
 {
-  Elf64_Off stroff = section[ehdr->e_shstrndx].sh_offset;
-  int nrsz = (int)log10 ((double)ehdr->e_shnum) + 1;
+  const Elf64_Ehdr *ehdr = &image->ehdr;
+  size_t count = image->shdrs.count;
+  int nrsz = count > 0 ? (int)log10 ((double)count) + 1 : 1;
   char *nr = "Nr";
   char *spc = " ";
 
@@ -473,36 +691,40 @@ print_section_header (const Elf64_Shdr *section, const Elf64_Ehdr *ehdr,
       "[%*s] Name                 Type             Address          Offset\n"
       " %*s  Size                 EntSize          Flags            Link  "
       "Info  Align\n",
-      (int)ehdr->e_shnum, ehdr->e_shoff, nrsz, nr, nrsz, spc);
+      (int)count, ehdr->e_shoff, nrsz, nr, nrsz, spc);
 
-  for (int i = 0; i < ehdr->e_shnum; i++)
+  for (size_t i = 0; i < image->shdrs.count; i++)
     {
+      Elf64_Shdr scratch;
+      const Elf64_Shdr *sh = elf_image_shdr (image, i, &scratch);
+      const char *name = elf_image_section_name (image, i);
+
       format_and_print (
           "",
           "[%*d] %-*s %-*s %-.*x %-.*x\n"
           " %*s  %-.*x     %-.*x %c%c%c%c%c%c%c%c%c%c%c%c%c%c%c%c %4d  "
           "%4d  %5d\n",
-          nrsz, i, 20, (data + stroff + section[i].sh_name), 16,
-          elf_s_type_id[get_s_type_index (section[i].sh_type)], 16,
-          section[i].sh_addr, 16, section[i].sh_offset, nrsz, spc, 16,
-          section[i].sh_size, 16, section[i].sh_entsize,
-          (section[i].sh_flags & SHF_WRITE ? 'W' : ' '),
-          (section[i].sh_flags & SHF_ALLOC ? 'A' : ' '),
-          (section[i].sh_flags & SHF_EXECINSTR ? 'X' : ' '),
-          (section[i].sh_flags & SHF_MERGE ? 'M' : ' '),
-          (section[i].sh_flags & SHF_STRINGS ? 'S' : ' '),
-          (section[i].sh_flags & SHF_INFO_LINK ? 'I' : ' '),
-          (section[i].sh_flags & SHF_LINK_ORDER ? 'L' : ' '),
-          (section[i].sh_flags & SHF_OS_NONCONFORMING ? 'O' : ' '),
-          (section[i].sh_flags & SHF_GROUP ? 'G' : ' '),
-          (section[i].sh_flags & SHF_TLS ? 'T' : ' '),
-          (section[i].sh_flags & SHF_COMPRESSED ? 'C' : ' '),
-          (section[i].sh_flags & (1 << 12) ? 'x' : ' '),
-          (section[i].sh_flags & SHF_MASKOS ? 'o' : ' '),
-          (section[i].sh_flags & SHF_EXCLUDE ? 'E' : ' '),
-          (section[i].sh_flags & SHF_ORDERED ? 'l' : ' '),
-          (section[i].sh_flags & SHF_MASKPROC ? 'p' : ' '), section[i].sh_link,
-          section[i].sh_info, section[i].sh_addralign);
+          nrsz, (int)i, 20, name, 16,
+          elf_s_type_id[get_s_type_index (sh->sh_type)], 16,
+          sh->sh_addr, 16, sh->sh_offset, nrsz, spc, 16,
+          sh->sh_size, 16, sh->sh_entsize,
+          (sh->sh_flags & SHF_WRITE ? 'W' : ' '),
+          (sh->sh_flags & SHF_ALLOC ? 'A' : ' '),
+          (sh->sh_flags & SHF_EXECINSTR ? 'X' : ' '),
+          (sh->sh_flags & SHF_MERGE ? 'M' : ' '),
+          (sh->sh_flags & SHF_STRINGS ? 'S' : ' '),
+          (sh->sh_flags & SHF_INFO_LINK ? 'I' : ' '),
+          (sh->sh_flags & SHF_LINK_ORDER ? 'L' : ' '),
+          (sh->sh_flags & SHF_OS_NONCONFORMING ? 'O' : ' '),
+          (sh->sh_flags & SHF_GROUP ? 'G' : ' '),
+          (sh->sh_flags & SHF_TLS ? 'T' : ' '),
+          (sh->sh_flags & SHF_COMPRESSED ? 'C' : ' '),
+          (sh->sh_flags & (1 << 12) ? 'x' : ' '),
+          (sh->sh_flags & SHF_MASKOS ? 'o' : ' '),
+          (sh->sh_flags & SHF_EXCLUDE ? 'E' : ' '),
+          (sh->sh_flags & SHF_ORDERED ? 'l' : ' '),
+          (sh->sh_flags & SHF_MASKPROC ? 'p' : ' '), sh->sh_link,
+          sh->sh_info, sh->sh_addralign);
     }
 
   format_and_print (
@@ -519,82 +741,1813 @@ print_section_header (const Elf64_Shdr *section, const Elf64_Ehdr *ehdr,
 static int
 display_section_header_table (void *v)
 {
-  FileContents *filecontents = (FileContents *)v;
+  ElfImage *image = (ElfImage *)v;
+
+  print_section_header (image);
+  print_and_wait ("\n");
+
+  return 0;
+}
+
+static void
+emit_json_elf_header (JsonWriter *jw, const ElfImage *image,
+                      const char *filename)
+{
+  const Elf64_Ehdr *ehdr = &image->ehdr;
+
+  json_record_begin (jw, "elf_header");
+  json_field_str (jw, "file", filename);
+  json_field_str (jw, "class", elf_class_id[emit_ei_class (ehdr)]);
+  json_field_str (jw, "data", elf_data_id[emit_ei_data (ehdr)]);
+  json_field_u64 (jw, "ident_version", ehdr->e_ident[EI_VERSION]);
+  json_field_u64 (jw, "osabi", ehdr->e_ident[EI_OSABI]);
+  json_field_str (jw, "osabi_name", elf_osabi_id[emit_ei_osabi (ehdr)]);
+  json_field_u64 (jw, "abi_version", ehdr->e_ident[EI_ABIVERSION]);
+  json_field_u64 (jw, "type", ehdr->e_type);
+  json_field_str (jw, "type_name", elf_e_type_id[emit_e_type (ehdr)]);
+  json_field_u64 (jw, "machine", ehdr->e_machine);
+  json_field_str (jw, "machine_name", ehdr->e_machine >= EM_NUM
+                                          ? "special"
+                                          : elf_e_machine_id[ehdr->e_machine]);
+  json_field_u64 (jw, "version", ehdr->e_version);
+  json_field_u64 (jw, "entry", ehdr->e_entry);
+  json_field_u64 (jw, "phoff", ehdr->e_phoff);
+  json_field_u64 (jw, "shoff", ehdr->e_shoff);
+  json_field_u64 (jw, "flags", ehdr->e_flags);
+  json_field_u64 (jw, "ehsize", ehdr->e_ehsize);
+  json_field_u64 (jw, "phentsize", ehdr->e_phentsize);
+  json_field_u64 (jw, "phnum", ehdr->e_phnum);
+  json_field_u64 (jw, "shentsize", ehdr->e_shentsize);
+  json_field_u64 (jw, "shnum", ehdr->e_shnum);
+  json_field_u64 (jw, "shstrndx", ehdr->e_shstrndx);
+  json_field_u64 (jw, "segment_count", image->phdrs.count);
+  json_field_u64 (jw, "section_count", image->shdrs.count);
+  json_field_u64 (jw, "shstrtab_index", image->shstrndx);
+  json_record_end (jw);
+}
+
+static void
+emit_json_segments (JsonWriter *jw, const ElfImage *image,
+                    const char *filename)
+{
+  const FileContents *filecontents = image->file;
 
-  Elf64_Ehdr ehdr = { 0 };
-  if (get_elf_header (filecontents->buffer, filecontents->length, &ehdr) != 0)
+  for (size_t i = 0; i < image->phdrs.count; i++)
     {
-      print_and_wait ("Failed to get ELF header\n");
-      return 1;
+      Elf64_Phdr scratch;
+      const Elf64_Phdr *phdr = elf_image_phdr (image, i, &scratch);
+      char flags_buf[4] = { 0 };
+
+      json_record_begin (jw, "segment");
+      json_field_str (jw, "file", filename);
+      json_field_u64 (jw, "index", i);
+      json_field_u64 (jw, "type", phdr->p_type);
+      json_field_str (jw, "type_name", get_p_type (phdr->p_type));
+      json_field_u64 (jw, "offset", phdr->p_offset);
+      json_field_u64 (jw, "vaddr", phdr->p_vaddr);
+      json_field_u64 (jw, "paddr", phdr->p_paddr);
+      json_field_u64 (jw, "filesz", phdr->p_filesz);
+      json_field_u64 (jw, "memsz", phdr->p_memsz);
+      json_field_str (jw, "flags", get_p_flags (phdr->p_flags, flags_buf));
+      json_field_u64 (jw, "align", phdr->p_align);
+      if (phdr->p_type == PT_INTERP && phdr->p_filesz > 0
+          && phdr->p_offset < filecontents->length
+          && phdr->p_filesz <= filecontents->length - phdr->p_offset)
+        {
+          const char *interp_path = filecontents->buffer + phdr->p_offset;
+          json_field_strn (jw, "interpreter", interp_path,
+                           strnlen (interp_path, phdr->p_filesz));
+        }
+      json_record_end (jw);
     }
+}
 
-  Elf64_Shdr shdr[ehdr.e_shnum];
-  if (get_elf_shdr (filecontents->buffer, 0, &ehdr, shdr) != 0)
+static void
+emit_json_sections (JsonWriter *jw, const ElfImage *image,
+                    const char *filename)
+{
+  for (size_t i = 0; i < image->shdrs.count; i++)
     {
-      print_and_wait ("Failed to get section header\n");
-      return 1;
+      Elf64_Shdr scratch;
+      const Elf64_Shdr *sh = elf_image_shdr (image, i, &scratch);
+
+      json_record_begin (jw, "section");
+      json_field_str (jw, "file", filename);
+      json_field_u64 (jw, "index", i);
+      json_field_str (jw, "name", elf_image_section_name (image, i));
+      json_field_u64 (jw, "type", sh->sh_type);
+      json_field_str (jw, "type_name",
+                      elf_s_type_id[get_s_type_index (sh->sh_type)]);
+      json_field_u64 (jw, "addr", sh->sh_addr);
+      json_field_u64 (jw, "offset", sh->sh_offset);
+      json_field_u64 (jw, "size", sh->sh_size);
+      json_field_u64 (jw, "entsize", sh->sh_entsize);
+      json_field_u64 (jw, "flags", sh->sh_flags);
+      json_field_u64 (jw, "link", sh->sh_link);
+      json_field_u64 (jw, "info", sh->sh_info);
+      json_field_u64 (jw, "addralign", sh->sh_addralign);
+      json_record_end (jw);
     }
+}
 
-  print_section_header (shdr, &ehdr, filecontents->buffer);
+static void
+emit_json_symbols (JsonWriter *jw, ElfImage *image, Elf64_Word sh_type,
+                   const char *filename, int flags)
+{
+  SymbolStore *store = elf_image_symbols (image, sh_type);
+  if (store == NULL)
+    return;
+
+  const char *table = elf_image_section_name (image, store->section);
+  uint32_t *order;
+  size_t count;
+  if (get_symbol_order (store, flags, &order, &count) != 0)
+    {
+      json_record_begin (jw, "error");
+      json_field_str (jw, "file", filename);
+      json_field_str (jw, "table", table);
+      json_field_str (jw, "message", "failed to select the symbols");
+      json_record_end (jw);
+      return;
+    }
 
-  print_and_wait ("\n");
+  for (size_t n = 0; n < count; n++)
+    {
+      size_t i = order != NULL ? order[n] : n;
+
+      json_record_begin (jw, "symbol");
+      json_field_str (jw, "file", filename);
+      json_field_str (jw, "table", table);
+      json_field_u64 (jw, "index", i);
+      json_field_str (jw, "name", symstore_name (store, i));
+      json_field_u64 (jw, "value", store->value[i]);
+      json_field_u64 (jw, "size", store->size[i]);
+      json_field_str (jw, "type", symbol_type_name (store->info[i]));
+      json_field_str (jw, "bind", symbol_bind_name (store->info[i]));
+      json_field_str (jw, "visibility",
+                      symbol_visibility_name (store->other[i]));
+      json_field_u64 (jw, "shndx", store->shndx[i] >= ELF_SHN_RESERVED
+                                       ? store->shndx[i] & ~ELF_SHN_RESERVED
+                                       : store->shndx[i]);
+      json_record_end (jw);
+    }
 
-  return 0;
+  free (order);
 }
 
-static int
-disassemble_code_section (void *v)
+static void
+emit_json_lookup (JsonWriter *jw, ElfImage *image, const char *filename)
 {
-  print_and_wait ("Disassemble code section\n");
-  return 0;
-}
+  DynsymHash hash;
+  long index = -1;
 
-static int
-display_symbol_table (void *v)
-{
-  print_and_wait ("Display symbol table\n");
-  return 0;
+  if (dynhash_init (&hash, image) == 0)
+    index = dynhash_lookup (&hash, lookup_name);
+
+  json_record_begin (jw, "lookup");
+  json_field_str (jw, "file", filename);
+  json_field_str (jw, "name", lookup_name);
+  json_field_bool (jw, "found", index >= 0);
+  if (index >= 0)
+    {
+      json_field_u64 (jw, "index", (uint64_t)index);
+      json_field_u64 (jw, "value", hash.dynsym->value[index]);
+      json_field_u64 (jw, "size", hash.dynsym->size[index]);
+      json_field_str (jw, "type", symbol_type_name (hash.dynsym->info[index]));
+      json_field_str (jw, "bind", symbol_bind_name (hash.dynsym->info[index]));
+      json_field_str (jw, "hash", dynhash_kind_name (&hash));
+    }
+  json_record_end (jw);
 }
 
-static int
-display_relocation_table (void *v)
+static void
+emit_json_relocations (JsonWriter *jw, ElfImage *image, int dynamic_only,
+                       const char *filename)
 {
-  print_and_wait ("Display relocation table\n");
-  return 0;
+  RelocListing listing;
+
+  if (open_reloc_listing (&listing, image, dynamic_only) != 0)
+    return;
+
+  const RelocSummary *summary = &listing.summary;
+  char type_buf[24];
+
+  for (size_t t = 0; t < listing.ntables; t++)
+    {
+      const RelocTable *table = listing.tables[t];
+      const SymbolStore *store = listing.stores[t];
+      const PackedTable *packed = listing.packed[t];
+      const char *name = elf_image_section_name (image, table->section);
+
+      for (size_t i = 0; i < table->count; i++)
+        {
+          json_record_begin (jw, "relocation");
+          json_field_str (jw, "file", filename);
+          json_field_str (jw, "table", name);
+          if (packed != NULL)
+            json_field_str (jw, "packing",
+                            packed->kind == PACKED_RELR ? "relr" : "aps2");
+          json_field_u64 (jw, "index", i);
+          json_field_u64 (jw, "offset", table->offset[i]);
+          json_field_u64 (jw, "type", table->type[i]);
+          json_field_str (jw, "type_name",
+                          reloc_type_name (image, table->type[i], type_buf,
+                                           sizeof (type_buf)));
+          json_field_u64 (jw, "sym", table->sym[i]);
+          if (store != NULL && table->sym[i] != 0)
+            json_field_str (jw, "symbol",
+                            reloc_symbol_name (image, store, table->sym[i]));
+          if (table->addend != NULL)
+            json_field_i64 (jw, "addend", table->addend[i]);
+          json_record_end (jw);
+        }
+    }
+
+  json_record_begin (jw, "relocation_summary");
+  json_field_str (jw, "file", filename);
+  json_field_bool (jw, "dynamic", dynamic_only);
+  json_field_u64 (jw, "tables", summary->tables);
+  json_field_u64 (jw, "entries", summary->entries);
+  json_field_u64 (jw, "packed_tables", summary->packed_tables);
+  json_field_u64 (jw, "packed_entries", summary->packed_entries);
+  json_field_u64 (jw, "packed_bytes", summary->packed_bytes);
+  json_field_u64 (jw, "unpacked_bytes", summary->unpacked_bytes);
+  json_record_end (jw);
+
+  for (size_t k = 0; k < listing.ntypes; k++)
+    {
+      size_t type = listing.types[k];
+      json_record_begin (jw, "relocation_type");
+      json_field_str (jw, "file", filename);
+      json_field_u64 (jw, "type", type);
+      if (type < RELOC_TYPE_MAX)
+        json_field_str (jw, "type_name",
+                        reloc_type_name (image, (Elf64_Word)type, type_buf,
+                                         sizeof (type_buf)));
+      json_field_u64 (jw, "count", summary->type_counts[type]);
+      json_record_end (jw);
+    }
+
+  for (size_t k = 0; k < listing.nsections; k++)
+    {
+      size_t section = listing.sections[k];
+      json_record_begin (jw, "relocation_target");
+      json_field_str (jw, "file", filename);
+      if (section < summary->nsections)
+        {
+          json_field_u64 (jw, "section", section);
+          json_field_str (jw, "name", elf_image_section_name (image, section));
+        }
+      json_field_u64 (jw, "count", summary->section_counts[section]);
+      json_record_end (jw);
+    }
+
+  close_reloc_listing (&listing);
 }
 
-static int
-display_dynamic_symbol_table (void *v)
+static void
+emit_json_dynamic (JsonWriter *jw, ElfImage *image, const char *filename)
 {
-  print_and_wait ("Display dynamic symbol table\n");
-  return 0;
+  const DynamicInfo *dyn = elf_image_dynamic (image);
+  if (dyn == NULL)
+    return;
+
+  char name_buf[24];
+  char value[SIZE_TEMPBUF];
+
+  for (size_t i = 0; i < dyn->count; i++)
+    {
+      json_record_begin (jw, "dynamic");
+      json_field_str (jw, "file", filename);
+      json_field_u64 (jw, "index", i);
+      json_field_u64 (jw, "tag", (uint64_t)dyn->tag[i]);
+      json_field_str (jw, "tag_name", dynamic_tag_name (dyn->tag[i], name_buf,
+                                                        sizeof (name_buf)));
+      json_field_u64 (jw, "value", dyn->val[i]);
+      if (dynamic_tag_is_string (dyn->tag[i]))
+        {
+          const char *str = dynamic_string (dyn, dyn->val[i]);
+          if (str != NULL)
+            json_field_str (jw, "string", str);
+        }
+      else
+        {
+          format_dynamic_value (dyn, i, value, sizeof (value));
+          json_field_str (jw, "text", value);
+        }
+      json_record_end (jw);
+    }
 }
 
-static int
-display_dynamic_relocation_table (void *v)
+static void
+emit_json_string_error (JsonWriter *jw, const char *filename,
+                        const char *message)
 {
-  print_and_wait ("Display dynamic relocation table\n");
-  return 0;
+  json_record_begin (jw, "error");
+  json_field_str (jw, "file", filename);
+  json_field_str (jw, "section", string_dump_name);
+  json_field_str (jw, "message", message);
+  json_record_end (jw);
 }
 
 static int
-display_dynamic_section (void *v)
+emit_json_strings (JsonWriter *jw, ElfImage *image, const char *filename)
 {
-  print_and_wait ("Display dynamic section\n");
+  size_t first, end;
+  const char *why = string_dump_range (image, &first, &end);
+  if (why != NULL)
+    {
+      emit_json_string_error (jw, filename, why);
+      return 1;
+    }
+
+  size_t emitted = 0;
+  for (size_t s = first; s < end; s++)
+    {
+      StringTable table;
+      if (!strtab_is_strings (image, s) || strtab_load (&table, image, s) != 0)
+        continue;
+
+      emitted += table.count;
+      const char *name = elf_image_section_name (image, s);
+      for (size_t i = 0; i < table.count; i++)
+        {
+          json_record_begin (jw, "string");
+          json_field_str (jw, "file", filename);
+          json_field_u64 (jw, "section", s);
+          json_field_str (jw, "name", name);
+          json_field_u64 (jw, "offset", table.starts[i]);
+          json_field_strn (jw, "string", table.data + table.starts[i],
+                           strtab_length (&table, i));
+          json_record_end (jw);
+        }
+      strtab_free (&table);
+    }
+
+  if (string_dump_name != NULL && emitted == 0)
+    {
+      emit_json_string_error (jw, filename, "has no strings");
+      return 1;
+    }
+
   return 0;
 }
 
-static int
-display_string_table (void *v)
+static void
+emit_json_dependencies (JsonWriter *jw, ElfImage *image, const char *filename)
 {
-  print_and_wait ("Display string table\n");
-  return 0;
+  DepClosure closure;
+
+  if (resolver_closure (dep_resolver, filename, image, &closure) != 0)
+    {
+      json_record_begin (jw, "error");
+      json_field_str (jw, "file", filename);
+      json_field_str (jw, "message", "failed to resolve the dependencies");
+      json_record_end (jw);
+      dep_closure_free (&closure);
+      return;
+    }
+
+  for (size_t i = 1; i < closure.count; i++)
+    {
+      const DepEntry *entry = &closure.entries[i];
+      const DepEntry *parent = &closure.entries[entry->parent];
+
+      json_record_begin (jw, "dependency");
+      json_field_str (jw, "file", filename);
+      json_field_str (jw, "name", entry->name);
+      json_field_bool (jw, "found", entry->object != NULL);
+      if (entry->object != NULL)
+        json_field_str (jw, "path",
+                        resolver_path (dep_resolver,
+                                       entry->path != NULL
+                                           ? entry->path
+                                           : entry->object->path));
+      json_field_u64 (jw, "depth", entry->depth);
+      json_field_str (jw, "needed_by", parent->name);
+      json_record_end (jw);
+    }
+
+  dep_closure_free (&closure);
+}
+
+static void
+emit_json_bindings (JsonWriter *jw, ElfImage *image, const char *filename)
+{
+  DepClosure closure;
+  BindReport report;
+
+  if (resolver_closure (dep_resolver, filename, image, &closure) != 0
+      || bind_closure (dep_resolver, &closure, &report) != 0)
+    {
+      json_record_begin (jw, "error");
+      json_field_str (jw, "file", filename);
+      json_field_str (jw, "message", "failed to bind the symbols");
+      json_record_end (jw);
+      dep_closure_free (&closure);
+      return;
+    }
+
+  for (size_t i = 0; i < closure.count; i++)
+    {
+      const BindCounts *counts = &report.counts[i];
+
+      json_record_begin (jw, "binding_object");
+      json_field_str (jw, "file", filename);
+      json_field_str (jw, "name", closure.entries[i].name);
+      json_field_bool (jw, "found", report.scopes[i] != NULL);
+      if (report.scopes[i] != NULL)
+        json_field_str (jw, "hash",
+                        dynhash_kind_name (&report.scopes[i]->hash));
+      json_field_u64 (jw, "lookups", counts->lookups);
+      json_field_u64 (jw, "probes", counts->probes);
+      json_field_u64 (jw, "bound", counts->bound);
+      json_field_u64 (jw, "unresolved", counts->unresolved);
+      json_record_end (jw);
+    }
+
+  for (size_t i = 0; i < report.nunresolved; i++)
+    {
+      const UnresolvedRef *ref = &report.unresolved[i];
+
+      json_record_begin (jw, "unresolved_symbol");
+      json_field_str (jw, "file", filename);
+      json_field_str (jw, "symbol", ref->ref->name);
+      if (ref->ref->version != NULL)
+        json_field_str (jw, "version", ref->ref->version->name);
+      json_field_str (jw, "needed_by", closure.entries[ref->entry].name);
+      json_field_bool (jw, "weak", ref->ref->weak);
+      json_record_end (jw);
+    }
+
+  // one record per definition, the first of each symbol the one bound to
+  for (size_t i = 0; i < report.nsymbols; i++)
+    {
+      const SymbolBinding *symbol = &report.symbols[i];
+      if (symbol->ndefs < 2)
+        continue;
+
+      for (size_t k = 0; k < symbol->ndefs; k++)
+        {
+          const BindDef *def = &report.defs[symbol->first_def + k];
+
+          json_record_begin (jw, "interposition");
+          json_field_str (jw, "file", filename);
+          json_field_str (jw, "symbol", symbol->name);
+          if (symbol->version != NULL)
+            json_field_str (jw, "version", symbol->version->name);
+          json_field_str (jw, "object", closure.entries[def->entry].name);
+          json_field_u64 (jw, "rank", k);
+          json_field_bool (jw, "canonical_plt", def->canonical);
+          json_field_u64 (jw, "lookups", symbol->count);
+          json_record_end (jw);
+        }
+    }
+
+  json_record_begin (jw, "binding_summary");
+  json_field_str (jw, "file", filename);
+  json_field_u64 (jw, "lookups", report.lookups);
+  json_field_u64 (jw, "symbols", report.nsymbols);
+  json_field_u64 (jw, "probes", report.probes);
+  json_field_u64 (jw, "unresolved", report.nunresolved);
+  json_field_u64 (jw, "weak_unresolved", report.nweak);
+  json_field_u64 (jw, "interposed", report.interposed);
+  json_record_end (jw);
+
+  bind_report_free (&report);
+  dep_closure_free (&closure);
+}
+
+// non-zero when a part that was asked for could not be emitted
+static int
+emit_json_records (OutBuf *out, ElfImage *image, const char *filename,
+                   int flags)
+{
+  int retval = 0;
+  JsonWriter jw;
+  json_writer_init (&jw, out, flags & BATCH_FORMAT_NDJSON);
+
+  json_record_begin (&jw, "file");
+  json_field_str (&jw, "file", filename);
+  json_field_u64 (&jw, "size", image->file->length);
+  json_record_end (&jw);
+
+  if (flags & BATCH_FILE_HEADER)
+    emit_json_elf_header (&jw, image, filename);
+
+  if (flags & BATCH_PROGRAM_HEADERS)
+    emit_json_segments (&jw, image, filename);
+
+  if (flags & BATCH_SECTION_HEADERS)
+    emit_json_sections (&jw, image, filename);
+
+  if (flags & BATCH_SYMBOLS)
+    emit_json_symbols (&jw, image, SHT_SYMTAB, filename, flags);
+
+  if (flags & BATCH_DYN_SYMBOLS)
+    emit_json_symbols (&jw, image, SHT_DYNSYM, filename, flags);
+
+  if (flags & BATCH_RELOCS)
+    emit_json_relocations (&jw, image, 0, filename);
+
+  if (flags & BATCH_DYN_RELOCS)
+    emit_json_relocations (&jw, image, 1, filename);
+
+  if (flags & BATCH_DYNAMIC)
+    emit_json_dynamic (&jw, image, filename);
+
+  if (flags & BATCH_STRINGS)
+    retval |= emit_json_strings (&jw, image, filename);
+
+  if (flags & BATCH_DEPS)
+    emit_json_dependencies (&jw, image, filename);
+
+  if (flags & BATCH_BINDINGS)
+    emit_json_bindings (&jw, image, filename);
+
+  if (flags & BATCH_LOOKUP)
+    emit_json_lookup (&jw, image, filename);
+
+  return retval;
+}
+
+static int
+disassemble_code_section (void *v)
+{
+  ElfImage *image = (ElfImage *)v;
+  PagedView paged;
+
+  DisasmView *view = disasm_view_open (image, &paged);
+  if (view == NULL)
+    {
+      print_and_wait ("Nothing to disassemble\n");
+      return 0;
+    }
+
+  do_paged_view ("Disassembly", &paged);
+  disasm_view_close (view);
+
+  return 0;
+}
+
+// The symbols to list in *order and how many there are in *count.  A
+// NULL order means all of them in file order.  -1 when the selection could
+// not be made.
+static int
+get_symbol_order (const SymbolStore *store, int flags, uint32_t **order,
+                  size_t *count)
+{
+  *order = NULL;
+  *count = store->count;
+  if (!(flags & (BATCH_DEFINED_ONLY | BATCH_SYM_FILTER | BATCH_SORT_ADDRESS
+                 | BATCH_SORT_SIZE))
+      || store->count == 0)
+    return 0;
+
+  uint32_t *sel = robust_malloc (store->count * sizeof (uint32_t));
+  if (sel == NULL)
+    return -1;
+
+  size_t n = store->count;
+  for (size_t i = 0; i < n; i++)
+    sel[i] = (uint32_t)i;
+
+  if (flags & BATCH_DEFINED_ONLY)
+    n = symstore_select_defined (store, sel, n);
+  if ((flags & BATCH_SYM_FILTER) && symbol_type_filter >= 0)
+    n = symstore_select_type (store, (unsigned char)symbol_type_filter, sel,
+                              n);
+  if ((flags & BATCH_SYM_FILTER) && symbol_min_size > 0)
+    n = symstore_select_min_size (store, symbol_min_size, sel, n);
+
+  int ret = 0;
+  if (flags & BATCH_SORT_SIZE)
+    ret = symstore_sort_by_size (store, sel, n);
+  else if (flags & BATCH_SORT_ADDRESS)
+    ret = symstore_sort_by_address (store, sel, n);
+  if (ret != 0)
+    {
+      free (sel);
+      return -1;
+    }
+
+  *order = sel;
+  *count = n;
+  return 0;
+}
+
+static void
+print_symbol_table (ElfImage *image, Elf64_Word sh_type, int flags)
+{
+  SymbolStore *store = elf_image_symbols (image, sh_type);
+  if (store == NULL)
+    {
+      format_and_print ("", "\nNo %s symbol table in this file.\n",
+                        sh_type == SHT_DYNSYM ? "dynamic" : "static");
+      return;
+    }
+
+  const char *table = elf_image_section_name (image, store->section);
+  uint32_t *order;
+  size_t count;
+  if (get_symbol_order (store, flags, &order, &count) != 0)
+    {
+      format_and_print ("", "\nFailed to select the symbols of '%s'.\n",
+                        table);
+      return;
+    }
+
+  if (count != store->count)
+    format_and_print ("\n", SYMBOL_TABLE_SELECTED_TITLE_FORMAT "\n", table,
+                      count, store->count);
+  else
+    format_and_print ("\n", SYMBOL_TABLE_TITLE_FORMAT "\n", table,
+                      store->count);
+  controller_print (SYMBOL_TITLES "\n");
+
+  for (size_t n = 0; n < count; n++)
+    {
+      size_t i = order != NULL ? order[n] : n;
+      char ndx_buf[8];
+
+      if (n % SYMBOL_PROGRESS_STEP == 0)
+        {
+          if (menu_cancelled ())
+            break;
+          menu_progress (n, count);
+        }
+
+      format_and_print ("", SYMBOL_ROW_FORMAT "\n", i,
+                        store->value[i], store->size[i],
+                        symbol_type_name (store->info[i]),
+                        symbol_bind_name (store->info[i]),
+                        symbol_visibility_name (store->other[i]),
+                        symbol_shndx_name (store->shndx[i], ndx_buf,
+                                           sizeof (ndx_buf)),
+                        symstore_name (store, i));
+    }
+
+  menu_progress (0, 0);
+  free (order);
+}
+
+static void
+print_symbol_lookup (ElfImage *image, const char *filename)
+{
+  DynsymHash hash;
+
+  if (dynhash_init (&hash, image) != 0)
+    {
+      format_and_print ("", "%s: %s: no dynamic symbol table\n", filename,
+                        lookup_name);
+      return;
+    }
+
+  long index = dynhash_lookup (&hash, lookup_name);
+  if (index < 0)
+    {
+      format_and_print ("", "%s: %s: not exported\n", filename, lookup_name);
+      return;
+    }
+
+  const SymbolStore *dynsym = hash.dynsym;
+  format_and_print ("",
+                    "%s: %s: exported as .dynsym[%ld] value 0x%016lx size "
+                    "%lu %s %s (%s hash)\n",
+                    filename, lookup_name, index, dynsym->value[index],
+                    dynsym->size[index], symbol_type_name (dynsym->info[index]),
+                    symbol_bind_name (dynsym->info[index]),
+                    dynhash_kind_name (&hash));
+}
+
+static int
+symbol_view_rows (void *ctx, uint64_t pos, ViewRow *rows, int n)
+{
+  const SymbolView *sv = ctx;
+  const SymbolStore *store = sv->store;
+  int k = 0;
+
+  for (; k < n && pos + k < store->count + SYMBOL_VIEW_HEADER_ROWS; k++)
+    {
+      uint64_t row = pos + k;
+      rows[k].pos = row;
+
+      if (row == 0)
+        {
+          snprintf (rows[k].text, VIEW_ROW_WIDTH, SYMBOL_TABLE_TITLE_FORMAT,
+                    elf_image_section_name (sv->image, store->section),
+                    store->count);
+          continue;
+        }
+      if (row == 1)
+        {
+          snprintf (rows[k].text, VIEW_ROW_WIDTH, "%s", SYMBOL_TITLES);
+          continue;
+        }
+
+      size_t i = row - SYMBOL_VIEW_HEADER_ROWS;
+      char ndx_buf[8];
+      snprintf (rows[k].text, VIEW_ROW_WIDTH, SYMBOL_ROW_FORMAT, i,
+                store->value[i], store->size[i],
+                symbol_type_name (store->info[i]),
+                symbol_bind_name (store->info[i]),
+                symbol_visibility_name (store->other[i]),
+                symbol_shndx_name (store->shndx[i], ndx_buf, sizeof (ndx_buf)),
+                symstore_name (store, i));
+    }
+
+  return k;
+}
+
+static uint64_t
+symbol_view_back (void *ctx, uint64_t pos, int n)
+{
+  return pos > (uint64_t)n ? pos - (uint64_t)n : 0;
+}
+
+// first symbol whose value covers addr
+static int
+symbol_view_seek (void *ctx, uint64_t addr, uint64_t *pos)
+{
+  const SymbolStore *store = ((const SymbolView *)ctx)->store;
+
+  for (size_t i = 0; i < store->count; i++)
+    if (addr >= store->value[i]
+        && (addr == store->value[i] || addr - store->value[i] < store->size[i]))
+      {
+        *pos = i + SYMBOL_VIEW_HEADER_ROWS;
+        return 0;
+      }
+
+  return -1;
+}
+
+// symbols are formatted only as they scroll into view
+static void
+show_symbol_view (ElfImage *image, Elf64_Word sh_type, const char *heading)
+{
+  SymbolStore *store = elf_image_symbols (image, sh_type);
+  if (store == NULL)
+    {
+      print_symbol_table (image, sh_type, 0);
+      print_and_wait ("\n");
+      return;
+    }
+
+  SymbolView sv = { image, store };
+  PagedView view = { &sv, 0, symbol_view_rows, symbol_view_back,
+                     symbol_view_seek };
+  do_paged_view (heading, &view);
+}
+
+// the symbol table a relocation table refers to, if it is one we load
+static const SymbolStore *
+reloc_symbols (ElfImage *image, const RelocTable *table)
+{
+  if (table->symtab == 0)
+    return NULL;
+
+  SymbolStore *store = elf_image_symbols (image, SHT_DYNSYM);
+  if (store != NULL && store->section == table->symtab)
+    return store;
+
+  store = elf_image_symbols (image, SHT_SYMTAB);
+  if (store != NULL && store->section == table->symtab)
+    return store;
+
+  return NULL;
+}
+
+// 0 with the listing filled, 1 when there is nothing to list
+static int
+open_reloc_listing (RelocListing *listing, ElfImage *image, int dynamic_only)
+{
+  memset (listing, 0, sizeof (RelocListing));
+  listing->image = image;
+
+  RelocSet *set = elf_image_relocs (image);
+  if (set == NULL)
+    return -1;
+
+  if (reloc_summarize (image, set, dynamic_only, &listing->summary) != 0)
+    return -1;
+
+  const RelocSummary *summary = &listing->summary;
+  if (summary->tables == 0)
+    {
+      close_reloc_listing (listing);
+      return 1;
+    }
+
+  listing->tables
+      = robust_malloc (summary->tables * sizeof (const RelocTable *));
+  listing->packed
+      = robust_malloc (summary->tables * sizeof (const PackedTable *));
+  listing->stores
+      = robust_malloc (summary->tables * sizeof (const SymbolStore *));
+  listing->starts = robust_malloc ((summary->tables + 1) * sizeof (uint64_t));
+  listing->types = robust_malloc (summary->ntypes * sizeof (size_t));
+  listing->sections
+      = robust_malloc ((summary->nsections + 1) * sizeof (size_t));
+  if (listing->tables == NULL || listing->packed == NULL
+      || listing->stores == NULL || listing->starts == NULL
+      || listing->types == NULL || listing->sections == NULL)
+    {
+      close_reloc_listing (listing);
+      return -1;
+    }
+
+  for (size_t t = 0; t < set->ntables; t++)
+    if (!dynamic_only || set->tables[t].dynamic)
+      {
+        listing->packed[listing->ntables] = NULL;
+        listing->tables[listing->ntables++] = &set->tables[t];
+      }
+
+  // listing a packed table is the one place it is expanded in full
+  for (size_t t = 0; t < set->npacked; t++)
+    {
+      PackedTable *packed = &set->packed[t];
+      if (dynamic_only && !packed->dynamic)
+        continue;
+
+      const RelocTable *table = packed_reloc_table (image, packed);
+      if (table == NULL)
+        {
+          close_reloc_listing (listing);
+          return -1;
+        }
+      listing->packed[listing->ntables] = packed;
+      listing->tables[listing->ntables++] = table;
+    }
+
+  uint64_t row = 0;
+  for (size_t t = 0; t < listing->ntables; t++)
+    {
+      listing->stores[t] = reloc_symbols (image, listing->tables[t]);
+      listing->starts[t] = row;
+      row += listing->tables[t]->count + RELOC_TABLE_EXTRA_ROWS;
+    }
+  listing->starts[listing->ntables] = row;
+
+  for (size_t k = 0; k < summary->ntypes; k++)
+    if (summary->type_counts[k] != 0)
+      listing->types[listing->ntypes++] = k;
+  for (size_t k = 0; k <= summary->nsections; k++)
+    if (summary->section_counts[k] != 0)
+      listing->sections[listing->nsections++] = k;
+
+  return 0;
+}
+
+static void
+close_reloc_listing (RelocListing *listing)
+{
+  reloc_summary_free (&listing->summary);
+  free (listing->tables);
+  free (listing->packed);
+  free (listing->stores);
+  free (listing->starts);
+  free (listing->types);
+  free (listing->sections);
+  memset (listing, 0, sizeof (RelocListing));
+}
+
+static uint64_t
+reloc_listing_rows (const RelocListing *listing)
+{
+  return listing->starts[listing->ntables] + RELOC_SUMMARY_EXTRA_ROWS
+         + listing->ntypes + listing->nsections
+         + (listing->summary.packed_tables != 0 ? RELOC_PACKED_ROWS : 0);
+}
+
+// section symbols have no name of their own and go by their section's
+static const char *
+reloc_symbol_name (const ElfImage *image, const SymbolStore *store,
+                   Elf64_Word sym)
+{
+  if (store == NULL || sym == 0 || sym >= store->count)
+    return "";
+
+  if (ELF64_ST_TYPE (store->info[sym]) == STT_SECTION
+      && store->shndx[sym] < image->shdrs.count)
+    return elf_image_section_name (image, store->shndx[sym]);
+
+  return symstore_name (store, sym);
+}
+
+// the symbol of an entry followed by its addend, as readelf shows them
+static void
+format_reloc_target (const RelocListing *listing, const SymbolStore *store,
+                     const RelocTable *table, size_t i, char *buf,
+                     size_t size)
+{
+  const char *name = reloc_symbol_name (listing->image, store, table->sym[i]);
+
+  if (table->addend == NULL)
+    snprintf (buf, size, "%s", name);
+  else if (*name == '\0')
+    snprintf (buf, size, "%lx", table->addend[i]);
+  else if (table->addend[i] < 0)
+    snprintf (buf, size, "%s - %lx", name,
+              -(Elf64_Xword)table->addend[i]);
+  else
+    snprintf (buf, size, "%s + %lx", name, table->addend[i]);
+}
+
+static void
+format_reloc_entry (const RelocListing *listing, size_t t, size_t i,
+                    char *buf, size_t size)
+{
+  const RelocTable *table = listing->tables[t];
+  const SymbolStore *store = listing->stores[t];
+  Elf64_Word sym = table->sym[i];
+  char type_buf[24];
+  char value_buf[24] = "";
+  char target[SIZE_TEMPBUF / 2];
+
+  if (store != NULL && sym != 0 && sym < store->count)
+    snprintf (value_buf, sizeof (value_buf), "%016lx", store->value[sym]);
+  format_reloc_target (listing, store, table, i, target, sizeof (target));
+
+  snprintf (buf, size, RELOC_ROW_FORMAT, table->offset[i],
+            reloc_type_name (listing->image, table->type[i], type_buf,
+                             sizeof (type_buf)),
+            value_buf, target);
+}
+
+static void
+format_summary_row (const RelocListing *listing, uint64_t row, char *buf,
+                    size_t size)
+{
+  const RelocSummary *summary = &listing->summary;
+
+  if (row == 0)
+    {
+      snprintf (buf, size,
+                "Relocation summary: %lu entries in %zu table%s",
+                summary->entries, summary->tables,
+                summary->tables == 1 ? "" : "s");
+      return;
+    }
+  row--;
+
+  if (row == 0)
+    {
+      snprintf (buf, size, "  %-30s %12s", "Type", "Count");
+      return;
+    }
+  row--;
+
+  if (row < listing->ntypes)
+    {
+      size_t type = listing->types[row];
+      char type_buf[24];
+      snprintf (buf, size, "  %-30s %12lu",
+                type < RELOC_TYPE_MAX
+                    ? reloc_type_name (listing->image, (Elf64_Word)type,
+                                       type_buf, sizeof (type_buf))
+                    : "(larger types)",
+                summary->type_counts[type]);
+      return;
+    }
+  row -= listing->ntypes;
+
+  if (row == 0)
+    {
+      buf[0] = '\0';
+      return;
+    }
+  row--;
+
+  if (row == 0)
+    {
+      snprintf (buf, size, "  %-30s %12s", "Target section", "Count");
+      return;
+    }
+  row--;
+
+  if (row < listing->nsections)
+    {
+      size_t section = listing->sections[row];
+      snprintf (buf, size, "  %-30s %12lu",
+                section < summary->nsections
+                    ? elf_image_section_name (listing->image, section)
+                    : "(none)",
+                summary->section_counts[section]);
+      return;
+    }
+  row -= listing->nsections;
+
+  // what the packed tables save the loader from reading at startup
+  uint64_t saved = summary->unpacked_bytes > summary->packed_bytes
+                       ? summary->unpacked_bytes - summary->packed_bytes
+                       : 0;
+  switch (row)
+    {
+    case 0:
+      buf[0] = '\0';
+      break;
+    case 1:
+      snprintf (buf, size, "  %-30s %12zu", "Packed tables",
+                summary->packed_tables);
+      break;
+    case 2:
+      snprintf (buf, size, "  %-30s %12lu", "Packed entries",
+                summary->packed_entries);
+      break;
+    case 3:
+      snprintf (buf, size, "  %-30s %12lu", "Packed size (bytes)",
+                summary->packed_bytes);
+      break;
+    case 4:
+      snprintf (buf, size, "  %-30s %12lu", "As REL/RELA (bytes)",
+                summary->unpacked_bytes);
+      break;
+    default:
+      snprintf (buf, size, "  %-30s %12lu (%.1f%%)", "Saved (bytes)", saved,
+                summary->unpacked_bytes
+                    ? 100.0 * saved / summary->unpacked_bytes
+                    : 0.0);
+      break;
+    }
+}
+
+static void
+format_reloc_listing_row (const RelocListing *listing, uint64_t row,
+                          char *buf, size_t size)
+{
+  if (row >= listing->starts[listing->ntables])
+    {
+      format_summary_row (listing, row - listing->starts[listing->ntables],
+                          buf, size);
+      return;
+    }
+
+  // last table starting at or before row
+  size_t lo = 0;
+  size_t hi = listing->ntables;
+  while (hi - lo > 1)
+    {
+      size_t mid = lo + (hi - lo) / 2;
+      if (listing->starts[mid] <= row)
+        lo = mid;
+      else
+        hi = mid;
+    }
+
+  const RelocTable *table = listing->tables[lo];
+  uint64_t k = row - listing->starts[lo];
+
+  if (k == 0)
+    {
+      const PackedTable *packed = listing->packed[lo];
+      Elf64_Shdr scratch;
+      const Elf64_Shdr *sh
+          = elf_image_shdr (listing->image, table->section, &scratch);
+      if (packed != NULL)
+        snprintf (buf, size, PACKED_TABLE_TITLE_FORMAT,
+                  elf_image_section_name (listing->image, table->section),
+                  sh->sh_offset, table->count, packed->size,
+                  packed->kind == PACKED_RELR ? "RELR" : "APS2");
+      else
+        snprintf (buf, size, RELOC_TABLE_TITLE_FORMAT,
+                  elf_image_section_name (listing->image, table->section),
+                  sh->sh_offset, table->count);
+    }
+  else if (k == 1)
+    snprintf (buf, size, "%s", RELOC_TITLES);
+  else if (k - 2 < table->count)
+    format_reloc_entry (listing, lo, k - 2, buf, size);
+  else
+    buf[0] = '\0';
+}
+
+static void
+print_relocations (ElfImage *image, int dynamic_only)
+{
+  RelocListing listing;
+
+  int ret = open_reloc_listing (&listing, image, dynamic_only);
+  if (ret != 0)
+    {
+      if (ret > 0)
+        format_and_print ("", "\nThere are no %srelocations in this file.\n",
+                          dynamic_only ? "dynamic " : "");
+      return;
+    }
+
+  uint64_t rows = reloc_listing_rows (&listing);
+  char buf[SIZE_TEMPBUF];
+
+  controller_print ("\n");
+  for (uint64_t row = 0; row < rows; row++)
+    {
+      if (row % RELOC_PROGRESS_STEP == 0)
+        {
+          if (menu_cancelled ())
+            break;
+          menu_progress (row, rows);
+        }
+
+      format_reloc_listing_row (&listing, row, buf, sizeof (buf));
+      format_and_print ("", "%s\n", buf);
+    }
+
+  menu_progress (0, 0);
+  close_reloc_listing (&listing);
+}
+
+static int
+reloc_view_rows (void *ctx, uint64_t pos, ViewRow *rows, int n)
+{
+  const RelocListing *listing = ctx;
+  uint64_t total = reloc_listing_rows (listing);
+  int k = 0;
+
+  for (; k < n && pos + k < total; k++)
+    {
+      rows[k].pos = pos + k;
+      format_reloc_listing_row (listing, pos + k, rows[k].text,
+                                VIEW_ROW_WIDTH);
+    }
+
+  return k;
+}
+
+static uint64_t
+reloc_view_back (void *ctx, uint64_t pos, int n)
+{
+  return pos > (uint64_t)n ? pos - (uint64_t)n : 0;
+}
+
+// first entry patching addr
+static int
+reloc_view_seek (void *ctx, uint64_t addr, uint64_t *pos)
+{
+  const RelocListing *listing = ctx;
+
+  for (size_t t = 0; t < listing->ntables; t++)
+    {
+      const RelocTable *table = listing->tables[t];
+      for (size_t i = 0; i < table->count; i++)
+        if (table->offset[i] == addr)
+          {
+            *pos = listing->starts[t] + 2 + i;
+            return 0;
+          }
+    }
+
+  return -1;
+}
+
+// entries are formatted only as they scroll into view
+static void
+show_reloc_view (ElfImage *image, int dynamic_only, const char *heading)
+{
+  RelocListing listing;
+
+  int ret = open_reloc_listing (&listing, image, dynamic_only);
+  if (ret != 0)
+    {
+      print_and_wait (ret > 0 ? "No relocations in this file\n"
+                              : "Failed to read the relocations\n");
+      return;
+    }
+
+  PagedView view = { &listing, 0, reloc_view_rows, reloc_view_back,
+                     reloc_view_seek };
+  do_paged_view (heading, &view);
+  close_reloc_listing (&listing);
+}
+
+typedef struct
+{
+  Elf64_Xword bit;
+  const char *name;
+} FlagName;
+
+static const FlagName dt_flag_names[]
+    = { { DF_ORIGIN, "ORIGIN" },     { DF_SYMBOLIC, "SYMBOLIC" },
+        { DF_TEXTREL, "TEXTREL" },   { DF_BIND_NOW, "BIND_NOW" },
+        { DF_STATIC_TLS, "STATIC_TLS" } };
+
+static const FlagName dt_flag_1_names[]
+    = { { DF_1_NOW, "NOW" },           { DF_1_GLOBAL, "GLOBAL" },
+        { DF_1_GROUP, "GROUP" },       { DF_1_NODELETE, "NODELETE" },
+        { DF_1_LOADFLTR, "LOADFLTR" }, { DF_1_INITFIRST, "INITFIRST" },
+        { DF_1_NOOPEN, "NOOPEN" },     { DF_1_ORIGIN, "ORIGIN" },
+        { DF_1_DIRECT, "DIRECT" },     { DF_1_INTERPOSE, "INTERPOSE" },
+        { DF_1_NODEFLIB, "NODEFLIB" }, { DF_1_NODUMP, "NODUMP" },
+        { DF_1_CONFALT, "CONFALT" },   { DF_1_ENDFILTEE, "ENDFILTEE" },
+        { DF_1_NODIRECT, "NODIRECT" }, { DF_1_IGNMULDEF, "IGNMULDEF" },
+        { DF_1_NOKSYMS, "NOKSYMS" },   { DF_1_NOHDR, "NOHDR" },
+        { DF_1_EDITED, "EDITED" },     { DF_1_NORELOC, "NORELOC" },
+        { DF_1_PIE, "PIE" } };
+
+// names of the bits set, and what is left of them in hex
+static void
+format_flag_names (const FlagName *names, size_t count, Elf64_Xword value,
+                   char *buf, size_t size)
+{
+  size_t len = strlen (buf);
+
+  for (size_t i = 0; i < count && len < size; i++)
+    if (value & names[i].bit)
+      {
+        len += snprintf (buf + len, size - len, "%s%s", len ? " " : "",
+                         names[i].name);
+        value &= ~names[i].bit;
+      }
+
+  if (value != 0 && len < size)
+    snprintf (buf + len, size - len, "%s0x%lx", len ? " " : "", value);
+}
+
+// the Name/Value column, worded as readelf words it
+static void
+format_dynamic_value (const DynamicInfo *dyn, size_t i, char *buf,
+                      size_t size)
+{
+  Elf64_Sxword tag = dyn->tag[i];
+  Elf64_Xword val = dyn->val[i];
+  char name_buf[24];
+
+  if (dynamic_tag_is_string (tag))
+    {
+      const char *str = dynamic_string (dyn, val);
+      const char *label;
+      switch (tag)
+        {
+        case DT_NEEDED:
+          label = "Shared library";
+          break;
+        case DT_SONAME:
+          label = "Library soname";
+          break;
+        case DT_RPATH:
+          label = "Library rpath";
+          break;
+        case DT_RUNPATH:
+          label = "Library runpath";
+          break;
+        case DT_AUXILIARY:
+          label = "Auxiliary library";
+          break;
+        case DT_FILTER:
+          label = "Filter library";
+          break;
+        case DT_CONFIG:
+          label = "Configuration file";
+          break;
+        case DT_DEPAUDIT:
+          label = "Dependency audit library";
+          break;
+        default:
+          label = "Audit library";
+          break;
+        }
+      if (str != NULL)
+        snprintf (buf, size, "%s: [%s]", label, str);
+      else
+        snprintf (buf, size, "%s: <invalid offset 0x%lx>", label, val);
+      return;
+    }
+
+  switch (tag)
+    {
+    case DT_PLTRELSZ:
+    case DT_RELASZ:
+    case DT_RELAENT:
+    case DT_STRSZ:
+    case DT_SYMENT:
+    case DT_RELSZ:
+    case DT_RELENT:
+    case DT_INIT_ARRAYSZ:
+    case DT_FINI_ARRAYSZ:
+    case DT_PREINIT_ARRAYSZ:
+    case DT_RELRSZ:
+    case DT_RELRENT:
+    case DT_GNU_CONFLICTSZ:
+    case DT_GNU_LIBLISTSZ:
+    case DT_PLTPADSZ:
+    case DT_MOVEENT:
+    case DT_MOVESZ:
+    case DT_SYMINSZ:
+    case DT_SYMINENT:
+    case DT_ANDROID_RELSZ:
+    case DT_ANDROID_RELASZ:
+    case DT_ANDROID_RELRSZ:
+    case DT_ANDROID_RELRENT:
+      snprintf (buf, size, "%lu (bytes)", val);
+      break;
+    case DT_RELACOUNT:
+    case DT_RELCOUNT:
+    case DT_VERDEFNUM:
+    case DT_VERNEEDNUM:
+      snprintf (buf, size, "%lu", val);
+      break;
+    case DT_PLTREL:
+      snprintf (buf, size, "%s",
+                dynamic_tag_name ((Elf64_Sxword)val, name_buf,
+                                  sizeof (name_buf)));
+      break;
+    case DT_FLAGS:
+      buf[0] = '\0';
+      format_flag_names (dt_flag_names, ARRAY_SIZE (dt_flag_names), val, buf,
+                         size);
+      break;
+    case DT_FLAGS_1:
+      snprintf (buf, size, "Flags:%s", val ? " " : " None");
+      format_flag_names (dt_flag_1_names, ARRAY_SIZE (dt_flag_1_names), val,
+                         buf + strlen (buf), size - strlen (buf));
+      break;
+    default:
+      snprintf (buf, size, "0x%lx", val);
+      break;
+    }
+}
+
+static void
+print_dynamic_section (ElfImage *image)
+{
+  const DynamicInfo *dyn = elf_image_dynamic (image);
+  if (dyn == NULL || dyn->count == 0)
+    {
+      format_and_print ("", "\nThere is no dynamic section in this file.\n");
+      return;
+    }
+
+  int wide = image->layout->addr_bits == 64;
+  char name_buf[24];
+  char value[SIZE_TEMPBUF];
+
+  format_and_print ("", "\n" DYNAMIC_TITLE_FORMAT "\n" DYNAMIC_TITLES "\n",
+                    (unsigned long)dyn->offset, dyn->count);
+
+  for (size_t i = 0; i < dyn->count; i++)
+    {
+      const char *name = dynamic_tag_name (dyn->tag[i], name_buf,
+                                           sizeof (name_buf));
+      int pad = (wide ? 19 : 27) - (int)strlen (name);
+
+      // ELF32 tags are 32 bits wide, however they were sign extended
+      unsigned long tag = wide ? (unsigned long)dyn->tag[i]
+                               : (uint32_t)dyn->tag[i];
+
+      format_dynamic_value (dyn, i, value, sizeof (value));
+      format_and_print ("", " 0x%0*lx (%s)%*s%s\n", wide ? 16 : 8, tag, name,
+                        pad > 1 ? pad : 1, "", value);
+    }
+}
+
+// the objects the loader would map for the file, in the order it maps
+// them, the way ldd lists them
+static void
+print_dependencies (ElfImage *image, const char *filename)
+{
+  DepClosure closure;
+
+  if (resolver_closure (dep_resolver, filename, image, &closure) != 0)
+    {
+      format_and_print ("", "\nFailed to resolve the dependencies.\n");
+      dep_closure_free (&closure);
+      return;
+    }
+
+  size_t missing = 0;
+  controller_print ("\nDependencies:\n");
+  if (closure.count == 1)
+    controller_print ("\tstatically linked\n");
+
+  for (size_t i = 1; i < closure.count; i++)
+    {
+      const DepEntry *entry = &closure.entries[i];
+      if (entry->object == NULL)
+        {
+          format_and_print ("", "\t%s => not found\n", entry->name);
+          missing++;
+          continue;
+        }
+      const char *path = entry->path != NULL ? entry->path
+                                             : entry->object->path;
+      format_and_print ("", "\t%s => %s\n", entry->name,
+                        resolver_path (dep_resolver, path));
+    }
+
+  if (closure.count > 1)
+    format_and_print ("", "%zu objects, %zu unresolved\n", closure.count - 1,
+                      missing);
+  dep_closure_free (&closure);
+}
+
+// Global symbol resolution over the closure as the loader would do it
+// at startup: what each object looks up and how many hash tables that
+// searches, then the references nothing defines and the definitions
+// that hide others of the same name.
+static void
+print_bindings (ElfImage *image, const char *filename)
+{
+  DepClosure closure;
+  BindReport report;
+
+  if (resolver_closure (dep_resolver, filename, image, &closure) != 0
+      || bind_closure (dep_resolver, &closure, &report) != 0)
+    {
+      format_and_print ("", "\nFailed to bind the symbols.\n");
+      dep_closure_free (&closure);
+      return;
+    }
+
+  controller_print ("\nSymbol bindings:\n" BINDING_TITLES "\n");
+  for (size_t i = 0; i < closure.count; i++)
+    {
+      const BindCounts *counts = &report.counts[i];
+      const BindScope *scope = report.scopes[i];
+
+      format_and_print ("", BINDING_ROW_FORMAT, counts->lookups,
+                        counts->probes, counts->bound,
+                        scope != NULL ? dynhash_kind_name (&scope->hash)
+                                      : "-",
+                        closure.entries[i].name);
+    }
+
+  if (report.nunresolved > 0)
+    controller_print ("\nUnresolved symbols:\n");
+  for (size_t i = 0; i < report.nunresolved; i++)
+    {
+      const UnresolvedRef *ref = &report.unresolved[i];
+      const BindVersion *version = ref->ref->version;
+      format_and_print ("", "\t%s%s%s%s, needed by %s\n", ref->ref->name,
+                        version != NULL ? "@" : "",
+                        version != NULL ? version->name : "",
+                        ref->ref->weak ? " (weak)" : "",
+                        closure.entries[ref->entry].name);
+    }
+
+  if (report.interposed > 0)
+    controller_print ("\nInterposed symbols:\n");
+  for (size_t i = 0; i < report.nsymbols; i++)
+    {
+      const SymbolBinding *symbol = &report.symbols[i];
+      if (symbol->ndefs < 2)
+        continue;
+
+      format_and_print ("", "\t%s%s%s:", symbol->name,
+                        symbol->version != NULL ? "@" : "",
+                        symbol->version != NULL ? symbol->version->name : "");
+      for (size_t k = 0; k < symbol->ndefs; k++)
+        {
+          const BindDef *def = &report.defs[symbol->first_def + k];
+          format_and_print ("", "%s %s%s", k > 0 ? " over" : "",
+                            closure.entries[def->entry].name,
+                            def->canonical ? " (PLT)" : "");
+        }
+      controller_print ("\n");
+    }
+
+  format_and_print ("",
+                    "%lu lookups of %zu symbols, %lu probes, %zu unresolved "
+                    "(%zu weak), %zu interposed\n",
+                    report.lookups, report.nsymbols, report.probes,
+                    report.nunresolved, report.nweak, report.interposed);
+
+  bind_report_free (&report);
+  dep_closure_free (&closure);
+}
+
+static int
+display_symbol_table (void *v)
+{
+  show_symbol_view ((ElfImage *)v, SHT_SYMTAB, "Symbol table");
+  return 0;
+}
+
+static int
+display_relocation_table (void *v)
+{
+  show_reloc_view ((ElfImage *)v, 0, "Relocation tables");
+  return 0;
+}
+
+static int
+display_dynamic_symbol_table (void *v)
+{
+  show_symbol_view ((ElfImage *)v, SHT_DYNSYM, "Dynamic symbol table");
+  return 0;
+}
+
+static int
+display_dynamic_relocation_table (void *v)
+{
+  show_reloc_view ((ElfImage *)v, 1, "Dynamic relocation tables");
+  return 0;
+}
+
+static int
+display_dynamic_section (void *v)
+{
+  print_dynamic_section ((ElfImage *)v);
+  print_and_wait ("\n");
+  return 0;
+}
+
+// Control characters as readelf shows them, a caret and the letter, but
+// for newlines, which stay on the row as \n.  Returns how many bytes of s
+// fit into buf.
+static size_t
+escape_string (const char *s, size_t len, char *buf, size_t size)
+{
+  size_t in = 0;
+  size_t out = 0;
+
+  for (; in < len; in++)
+    {
+      unsigned char c = (unsigned char)s[in];
+      int control = c < 0x20 || c == 0x7f;
+      if (out + 1 + control >= size)
+        break;
+      if (control)
+        {
+          buf[out++] = c == '\n' ? '\\' : '^';
+          buf[out++] = c == '\n' ? 'n' : (char)(c ^ 0x40);
+        }
+      else
+        buf[out++] = (char)c;
+    }
+
+  buf[out] = '\0';
+  return in;
+}
+
+// The sections --string-dump covers: with a name, the one section of that
+// name, found through the image's name index.  NULL, or why that section
+// cannot be dumped.
+static const char *
+string_dump_range (ElfImage *image, size_t *first, size_t *end)
+{
+  *first = 1;
+  *end = image->shdrs.count;
+  if (string_dump_name == NULL)
+    return NULL;
+
+  long s = elf_image_find_section (image, string_dump_name);
+  if (s < 0)
+    return "was not dumped because it does not exist";
+  if (!strtab_is_strings (image, (size_t)s))
+    return "has no strings";
+
+  *first = (size_t)s;
+  *end = (size_t)s + 1;
+  return NULL;
+}
+
+// 0 with the listing of the string sections from first up to end filled,
+// 1 when there is nothing to list.  A section that does not lie in the
+// file is reported and left out.
+static int
+open_string_listing (StringListing *listing, ElfImage *image, size_t first,
+                     size_t end)
+{
+  memset (listing, 0, sizeof (StringListing));
+  listing->image = image;
+
+  size_t count = 0;
+  for (size_t s = first; s < end; s++)
+    count += strtab_is_strings (image, s);
+  if (count == 0)
+    return 1;
+
+  listing->tables = robust_malloc (count * sizeof (StringTable));
+  listing->starts = robust_malloc ((count + 1) * sizeof (uint64_t));
+  if (listing->tables == NULL || listing->starts == NULL)
+    {
+      close_string_listing (listing);
+      return -1;
+    }
+
+  uint64_t row = 0;
+  for (size_t s = first; s < end; s++)
+    {
+      StringTable *table = &listing->tables[listing->ntables];
+      if (!strtab_is_strings (image, s) || strtab_load (table, image, s) != 0)
+        continue;
+      listing->starts[listing->ntables++] = row;
+      row += table->count + STRING_TABLE_EXTRA_ROWS;
+    }
+  listing->starts[listing->ntables] = row;
+
+  if (listing->ntables == 0)
+    {
+      close_string_listing (listing);
+      return 1;
+    }
+
+  return 0;
+}
+
+static void
+close_string_listing (StringListing *listing)
+{
+  for (size_t t = 0; t < listing->ntables; t++)
+    strtab_free (&listing->tables[t]);
+  free (listing->tables);
+  free (listing->starts);
+  memset (listing, 0, sizeof (StringListing));
+}
+
+// the table a row belongs to, with the row's place in it in k: 0 for the
+// title, then the strings
+static const StringTable *
+string_listing_table (const StringListing *listing, uint64_t row,
+                      uint64_t *k)
+{
+  size_t lo = 0;
+  size_t hi = listing->ntables;
+  while (hi - lo > 1)
+    {
+      size_t mid = lo + (hi - lo) / 2;
+      if (listing->starts[mid] <= row)
+        lo = mid;
+      else
+        hi = mid;
+    }
+
+  *k = row - listing->starts[lo];
+  return &listing->tables[lo];
+}
+
+// returns how many bytes of the row's string it holds, 0 for other rows
+static size_t
+format_string_listing_row (const StringListing *listing, uint64_t row,
+                           char *buf, size_t size)
+{
+  uint64_t k;
+  const StringTable *table = string_listing_table (listing, row, &k);
+
+  buf[0] = '\0';
+  if (k == 0)
+    snprintf (buf, size, STRING_DUMP_TITLE_FORMAT,
+              elf_image_section_name (listing->image, table->section),
+              table->count);
+  if (k == 0 || k > table->count)
+    return 0;
+
+  size_t i = k - 1;
+  int n = snprintf (buf, size, STRING_ROW_FORMAT,
+                    (unsigned long)table->starts[i]);
+  if (n < 0 || (size_t)n >= size)
+    return 0;
+
+  return escape_string (table->data + table->starts[i],
+                        strtab_length (table, i), buf + n, size - n);
+}
+
+// The rows of the view, except that a string too long for a row goes out
+// whole.  Non-zero when the section --string-dump named was not dumped.
+static int
+print_string_tables (ElfImage *image)
+{
+  StringListing listing;
+
+  size_t first, end;
+  const char *why = string_dump_range (image, &first, &end);
+  if (why != NULL)
+    {
+      format_and_print ("", "\nSection '%s' %s.\n", string_dump_name, why);
+      return 1;
+    }
+
+  int ret = open_string_listing (&listing, image, first, end);
+  if (ret != 0)
+    {
+      if (ret > 0 && string_dump_name != NULL)
+        format_and_print ("", "\nSection '%s' has no strings.\n",
+                          string_dump_name);
+      else if (ret > 0)
+        format_and_print ("", "\nThere are no string sections in this "
+                              "file.\n");
+      return string_dump_name != NULL || ret < 0;
+    }
+
+  uint64_t rows = listing.starts[listing.ntables];
+  char buf[SIZE_TEMPBUF];
+
+  controller_print ("\n");
+  for (uint64_t row = 0; row < rows; row++)
+    {
+      if (row % STRING_PROGRESS_STEP == 0)
+        {
+          if (menu_cancelled ())
+            break;
+          menu_progress (row, rows);
+        }
+
+      size_t done
+          = format_string_listing_row (&listing, row, buf, sizeof (buf));
+      controller_print (buf);
+
+      uint64_t k;
+      const StringTable *table = string_listing_table (&listing, row, &k);
+      if (k != 0 && k <= table->count)
+        {
+          const char *s = table->data + table->starts[k - 1];
+          size_t len = strtab_length (table, k - 1);
+          while (done < len)
+            {
+              done += escape_string (s + done, len - done, buf, sizeof (buf));
+              controller_print (buf);
+            }
+        }
+      controller_print ("\n");
+    }
+
+  menu_progress (0, 0);
+  close_string_listing (&listing);
+  return 0;
+}
+
+static int
+string_view_rows (void *ctx, uint64_t pos, ViewRow *rows, int n)
+{
+  const StringListing *listing = ctx;
+  uint64_t total = listing->starts[listing->ntables];
+  int k = 0;
+
+  for (; k < n && pos + k < total; k++)
+    {
+      rows[k].pos = pos + k;
+      format_string_listing_row (listing, pos + k, rows[k].text,
+                                 VIEW_ROW_WIDTH);
+    }
+
+  return k;
+}
+
+static uint64_t
+string_view_back (void *ctx, uint64_t pos, int n)
+{
+  return pos > (uint64_t)n ? pos - (uint64_t)n : 0;
+}
+
+// the string a name offset points into, in the first section that has one
+// there
+static int
+string_view_seek (void *ctx, uint64_t addr, uint64_t *pos)
+{
+  const StringListing *listing = ctx;
+
+  for (size_t t = 0; t < listing->ntables; t++)
+    {
+      long i = strtab_find (&listing->tables[t], addr);
+      if (i >= 0)
+        {
+          *pos = listing->starts[t] + 1 + (uint64_t)i;
+          return 0;
+        }
+    }
+
+  return -1;
+}
+
+// strings are formatted only as they scroll into view
+static int
+display_string_table (void *v)
+{
+  StringListing listing;
+
+  ElfImage *image = (ElfImage *)v;
+  int ret = open_string_listing (&listing, image, 1, image->shdrs.count);
+  if (ret != 0)
+    {
+      print_and_wait (ret > 0 ? "No string sections in this file\n"
+                              : "Failed to read the string sections\n");
+      return 0;
+    }
+
+  PagedView view = { &listing, 0, string_view_rows, string_view_back,
+                     string_view_seek };
+  do_paged_view ("String tables", &view);
+  close_string_listing (&listing);
+
+  return 0;
 }
 
 static int
 display_all (void *v)
 {
-  print_and_wait ("Display all\n");
+  ElfImage *image = (ElfImage *)v;
+
+  print_elf_header (image);
+  print_program_header_table (image);
+  controller_print ("\n");
+  print_section_header (image);
+  print_symbol_table (image, SHT_DYNSYM, 0);
+  print_symbol_table (image, SHT_SYMTAB, 0);
+  print_relocations (image, 0);
+  print_dynamic_section (image);
+  print_and_wait ("\n");
+
   return 0;
 }
 
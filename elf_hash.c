@@ -0,0 +1,345 @@
+#ifdef __APPLE__
+#include <libelf/libelf.h>
+#elif __linux__
+#include <libelf.h>
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "./include/elf_hash.h"
+#include "./include/elf_image.h"
+#include "./include/symtab.h"
+
+#define GNU_HASH_HEADER_SIZE 16
+
+uint32_t
+dynhash_gnu (const char *name)
+{
+  uint32_t h = 5381;
+
+  for (const unsigned char *p = (const unsigned char *)name; *p; p++)
+    h = (h << 5) + h + *p;
+
+  return h;
+}
+
+uint32_t
+dynhash_sysv (const char *name)
+{
+  uint32_t h = 0;
+
+  for (const unsigned char *p = (const unsigned char *)name; *p; p++)
+    {
+      h = (h << 4) + *p;
+      uint32_t g = h & 0xf0000000;
+      if (g)
+        h ^= g >> 24;
+      h &= ~g;
+    }
+
+  return h;
+}
+
+// hash section linked to the dynamic symbol table, bounds checked
+static const unsigned char *
+find_hash_section (ElfImage *image, Elf64_Word sh_type, size_t dynsym,
+                   size_t *size)
+{
+  for (size_t i = 0; i < image->shdrs.count; i++)
+    {
+      Elf64_Shdr scratch;
+      const Elf64_Shdr *sh = elf_image_shdr (image, i, &scratch);
+
+      if (sh->sh_type != sh_type || sh->sh_link != dynsym)
+        continue;
+
+      if (sh->sh_offset > image->file->length
+          || sh->sh_size > image->file->length - sh->sh_offset)
+        return NULL;
+
+      *size = sh->sh_size;
+      return (const unsigned char *)image->file->buffer + sh->sh_offset;
+    }
+
+  return NULL;
+}
+
+// bloom words are Elf_Addr sized, everything else 32-bit; all of it in
+// the file's byte order and at arbitrary offsets in the file image
+static int
+init_gnu_hash (DynsymHash *hash, const unsigned char *p, size_t size)
+{
+  const ElfLayout *layout = hash->layout;
+
+  if (size < GNU_HASH_HEADER_SIZE)
+    return -1;
+
+  uint32_t nbuckets = layout->read_word (p);
+  uint32_t symoffset = layout->read_word (p + 4);
+  uint32_t bloom_size = layout->read_word (p + 8);
+  uint32_t bloom_shift = layout->read_word (p + 12);
+  size_t bloom_word = layout->addr_bits / 8;
+  size_t fixed = GNU_HASH_HEADER_SIZE + (size_t)bloom_size * bloom_word
+                 + (size_t)nbuckets * 4;
+
+  if (nbuckets == 0 || bloom_size == 0 || (bloom_size & (bloom_size - 1))
+      || fixed > size)
+    return -1;
+
+  hash->kind = DYNHASH_GNU;
+  hash->gnu_nbuckets = nbuckets;
+  hash->symoffset = symoffset;
+  hash->bloom_size = bloom_size;
+  hash->bloom_shift = bloom_shift;
+  hash->bloom = p + GNU_HASH_HEADER_SIZE;
+  hash->gnu_buckets = hash->bloom + (size_t)bloom_size * bloom_word;
+  hash->gnu_chain = hash->gnu_buckets + (size_t)nbuckets * 4;
+  hash->gnu_nchain = (size - fixed) / 4;
+
+  return 0;
+}
+
+static int
+init_sysv_hash (DynsymHash *hash, const unsigned char *p, size_t size)
+{
+  if (size < 8)
+    return -1;
+
+  uint32_t nbuckets = hash->layout->read_word (p);
+  uint32_t nchain = hash->layout->read_word (p + 4);
+
+  if (nbuckets == 0 || 8 + ((size_t)nbuckets + nchain) * 4 > size)
+    return -1;
+
+  hash->kind = DYNHASH_SYSV;
+  hash->sysv_nbuckets = nbuckets;
+  hash->sysv_nchain = nchain;
+  hash->sysv_buckets = p + 8;
+  hash->sysv_chain = hash->sysv_buckets + (size_t)nbuckets * 4;
+
+  return 0;
+}
+
+int
+dynhash_init (DynsymHash *hash, ElfImage *image)
+{
+  memset (hash, 0, sizeof (DynsymHash));
+
+  SymbolStore *dynsym = elf_image_symbols (image, SHT_DYNSYM);
+  if (dynsym == NULL)
+    return -1;
+
+  hash->dynsym = dynsym;
+  hash->layout = image->layout;
+  hash->kind = DYNHASH_NONE;
+
+  const unsigned char *p;
+  size_t size;
+
+  p = find_hash_section (image, SHT_GNU_HASH, dynsym->section, &size);
+  if (p != NULL && init_gnu_hash (hash, p, size) == 0)
+    return 0;
+
+  p = find_hash_section (image, SHT_HASH, dynsym->section, &size);
+  if (p != NULL && init_sysv_hash (hash, p, size) == 0)
+    return 0;
+
+  return 0;
+}
+
+typedef int (*SymbolMatch) (const SymbolStore *dynsym, size_t index,
+                            const char *name);
+
+// what a lookup accepts: the name's own test, then the caller's if any
+typedef struct
+{
+  SymbolMatch match;
+  DynsymFilter filter;
+  void *arg;
+} Matcher;
+
+static int
+is_exported (const SymbolStore *dynsym, size_t index, const char *name)
+{
+  return dynsym->shndx[index] != SHN_UNDEF
+         && ELF64_ST_BIND (dynsym->info[index]) != STB_LOCAL
+         && strcmp (symstore_name (dynsym, index), name) == 0;
+}
+
+// what the loader's lookups accept, which includes the address of an
+// executable's canonical PLT entry left on an undefined symbol
+static int
+is_binding (const SymbolStore *dynsym, size_t index, const char *name)
+{
+  unsigned char type = ELF64_ST_TYPE (dynsym->info[index]);
+
+  if (ELF64_ST_BIND (dynsym->info[index]) == STB_LOCAL)
+    return 0;
+
+  switch (type)
+    {
+    case STT_NOTYPE:
+    case STT_OBJECT:
+    case STT_FUNC:
+    case STT_COMMON:
+    case STT_TLS:
+    case STT_GNU_IFUNC:
+      break;
+    default:
+      return 0;
+    }
+
+  if (dynsym->value[index] == 0 && type != STT_TLS
+      && dynsym->shndx[index] != ELF_SHN (SHN_ABS))
+    return 0;
+
+  return strcmp (symstore_name (dynsym, index), name) == 0;
+}
+
+static int
+accepts (const Matcher *m, const SymbolStore *dynsym, size_t index,
+         const char *name)
+{
+  return m->match (dynsym, index, name)
+         && (m->filter == NULL || m->filter (dynsym, index, m->arg));
+}
+
+static long
+lookup_gnu (const DynsymHash *hash, const char *name, uint32_t h,
+            const Matcher *m)
+{
+  const SymbolStore *dynsym = hash->dynsym;
+  const ElfLayout *layout = hash->layout;
+  unsigned int bits = layout->addr_bits;
+
+  // one bloom word rejects most absent names without touching buckets
+  uint64_t word = layout->read_addr (
+      hash->bloom + (size_t)((h / bits) & (hash->bloom_size - 1)) * (bits / 8));
+  uint64_t mask = ((uint64_t)1 << (h % bits))
+                  | ((uint64_t)1 << ((h >> hash->bloom_shift) % bits));
+  if ((word & mask) != mask)
+    return -1;
+
+  uint32_t index = layout->read_word (hash->gnu_buckets
+                                      + (size_t)(h % hash->gnu_nbuckets) * 4);
+  if (index < hash->symoffset)
+    return -1;
+
+  for (;; index++)
+    {
+      size_t slot = index - hash->symoffset;
+      if (slot >= hash->gnu_nchain || index >= dynsym->count)
+        return -1;
+
+      uint32_t chain = layout->read_word (hash->gnu_chain + slot * 4);
+      if ((chain | 1) == (h | 1) && accepts (m, dynsym, index, name))
+        return index;
+
+      if (chain & 1)
+        return -1;
+    }
+}
+
+static long
+lookup_sysv (const DynsymHash *hash, const char *name, uint32_t h,
+             const Matcher *m)
+{
+  const SymbolStore *dynsym = hash->dynsym;
+  const ElfLayout *layout = hash->layout;
+  uint32_t index = layout->read_word (hash->sysv_buckets
+                                      + (size_t)(h % hash->sysv_nbuckets) * 4);
+
+  // a corrupt chain could loop; it can't be longer than the table
+  for (uint32_t steps = 0; index != STN_UNDEF && steps < hash->sysv_nchain;
+       steps++)
+    {
+      if (index >= hash->sysv_nchain || index >= dynsym->count)
+        return -1;
+
+      if (accepts (m, dynsym, index, name))
+        return index;
+
+      index = layout->read_word (hash->sysv_chain + (size_t)index * 4);
+    }
+
+  return -1;
+}
+
+static long
+lookup_linear (const DynsymHash *hash, const char *name, const Matcher *m)
+{
+  for (size_t i = 0; i < hash->dynsym->count; i++)
+    if (accepts (m, hash->dynsym, i, name))
+      return (long)i;
+
+  return -1;
+}
+
+static long
+lookup (const DynsymHash *hash, const char *name, uint32_t gnu, uint32_t sysv,
+        const Matcher *m)
+{
+  if (hash == NULL || hash->dynsym == NULL)
+    return -1;
+
+  switch (hash->kind)
+    {
+    case DYNHASH_GNU:
+      return lookup_gnu (hash, name, gnu, m);
+    case DYNHASH_SYSV:
+      return lookup_sysv (hash, name, sysv, m);
+    default:
+      return lookup_linear (hash, name, m);
+    }
+}
+
+// callers resolving one name against many objects hash it only once
+long
+dynhash_lookup_hashed (const DynsymHash *hash, const char *name,
+                       uint32_t gnu, uint32_t sysv)
+{
+  Matcher m = { is_exported, NULL, NULL };
+  return lookup (hash, name, gnu, sysv, &m);
+}
+
+long
+dynhash_lookup (const DynsymHash *hash, const char *name)
+{
+  if (hash == NULL)
+    return -1;
+
+  uint32_t gnu = hash->kind == DYNHASH_GNU ? dynhash_gnu (name) : 0;
+  uint32_t sysv = hash->kind == DYNHASH_SYSV ? dynhash_sysv (name) : 0;
+
+  return dynhash_lookup_hashed (hash, name, gnu, sysv);
+}
+
+// The symbol a loader lookup for name stops at in this object, with
+// filter, when given, judging each candidate of the name in chain order
+// (its symbol version, say).  The symbol may be undefined, with the
+// address of the canonical PLT entry of a non-PIE executable, which only
+// lookups for PLT slots pass over.
+long
+dynhash_lookup_binding (const DynsymHash *hash, const char *name,
+                        uint32_t gnu, uint32_t sysv, DynsymFilter filter,
+                        void *arg)
+{
+  Matcher m = { is_binding, filter, arg };
+  return lookup (hash, name, gnu, sysv, &m);
+}
+
+const char *
+dynhash_kind_name (const DynsymHash *hash)
+{
+  switch (hash->kind)
+    {
+    case DYNHASH_GNU:
+      return "gnu";
+    case DYNHASH_SYSV:
+      return "sysv";
+    default:
+      return "linear";
+    }
+}
@@ -0,0 +1,302 @@
+#ifdef __APPLE__
+#include <libelf/libelf.h>
+#elif __linux__
+#include <libelf.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "./include/elf_cache.h"
+#include "./include/elf_image.h"
+#include "./include/fileio.h"
+#include "./include/my_elf.h"
+#include "./include/stats.h"
+#include "./include/strtab.h"
+#include "./include/symtab.h"
+
+// arena limit for images opened without an arena of the caller's; 0 for none
+static size_t memory_budget = 0;
+
+// qsort has no context argument; per thread so images can be opened
+// concurrently
+static __thread const ElfImage *sort_image = NULL;
+
+static int
+compare_section_names (const void *a, const void *b)
+{
+  uint32_t ia = *(const uint32_t *)a;
+  uint32_t ib = *(const uint32_t *)b;
+  int cmp = strcmp (elf_image_section_name (sort_image, ia),
+                    elf_image_section_name (sort_image, ib));
+  if (cmp != 0)
+    return cmp;
+
+  return ia < ib ? -1 : ia > ib;
+}
+
+static int
+resolve_shstrtab (ElfImage *image)
+{
+  image->shstrtab = NULL;
+  image->shstrtab_size = 0;
+
+  if (image->shstrndx == SHN_UNDEF)
+    return 0;
+
+  Elf64_Shdr scratch;
+  const Elf64_Shdr *strtab = elf_image_shdr (image, image->shstrndx, &scratch);
+  if (strtab == NULL)
+    {
+      fprintf (stderr, "Section name string table index is out of range.\n");
+      return 0;
+    }
+
+  if (strtab->sh_offset > image->file->length
+      || strtab->sh_size > image->file->length - strtab->sh_offset)
+    {
+      fprintf (stderr, "Section name string table is out of bounds.\n");
+      return 0;
+    }
+
+  image->shstrtab = image->file->buffer + strtab->sh_offset;
+  image->shstrtab_size = strtab_terminated (image->shstrtab, strtab->sh_size);
+
+  return 0;
+}
+
+static int
+build_section_name_offsets (ElfImage *image)
+{
+  size_t count = image->shdrs.count;
+
+  image->name_offsets = NULL;
+  image->name_order = NULL;
+  if (count == 0)
+    return 0;
+
+  image->name_offsets = arena_alloc (image->arena, count * sizeof (uint32_t));
+  if (image->name_offsets == NULL)
+    return -1;
+
+  for (size_t i = 0; i < count; i++)
+    {
+      Elf64_Shdr scratch;
+      const Elf64_Shdr *sh = elf_image_shdr (image, i, &scratch);
+      uint32_t name = UINT32_MAX;
+
+      if (image->shstrtab != NULL && sh->sh_name < image->shstrtab_size)
+        name = sh->sh_name;
+
+      image->name_offsets[i] = name;
+    }
+
+  return 0;
+}
+
+// Only lookups by name need the sorted order, so it is built on the first
+// one rather than for every file opened.
+static int
+build_section_name_order (ElfImage *image)
+{
+  size_t count = image->shdrs.count;
+
+  image->name_order = arena_alloc (image->arena, count * sizeof (uint32_t));
+  if (image->name_order == NULL)
+    return -1;
+
+  for (size_t i = 0; i < count; i++)
+    image->name_order[i] = (uint32_t)i;
+
+  sort_image = image;
+  qsort (image->name_order, count, sizeof (uint32_t), compare_section_names);
+  sort_image = NULL;
+
+  return 0;
+}
+
+void
+elf_image_set_memory_budget (size_t budget)
+{
+  memory_budget = budget;
+}
+
+size_t
+elf_image_memory_budget (void)
+{
+  return memory_budget;
+}
+
+int
+elf_image_init (ElfImage *image, FileContents *file, Arena *arena)
+{
+  if (image == NULL || file == NULL || arena == NULL)
+    {
+      fprintf (stderr, "ELF image, file or arena is NULL.\n");
+      return -1;
+    }
+
+  STAT_SCOPE (STAT_PHASE_PARSE);
+  memset (image, 0, sizeof (ElfImage));
+  image->file = file;
+  image->arena = arena;
+
+  if (get_elf_header (file->buffer, file->length, &image->ehdr) != 0)
+    return -1;
+  image->layout = elf_layout_of (&image->ehdr);
+
+  ElfCounts counts;
+  if (get_elf_counts (file->buffer, file->length, &image->ehdr, &counts) != 0)
+    return -1;
+  image->shstrndx = counts.shstrndx;
+
+  if (get_elf_phdr_view (file->buffer, file->length, &image->ehdr,
+                         &image->phdrs)
+      != 0)
+    return -1;
+
+  if (get_elf_shdr_view (file->buffer, file->length, &image->ehdr,
+                         &image->shdrs)
+      != 0)
+    return -1;
+
+  if (resolve_shstrtab (image) != 0)
+    return -1;
+
+  if (build_section_name_offsets (image) != 0)
+    return -1;
+
+  return 0;
+}
+
+ElfImage *
+elf_image_open (const char *filename)
+{
+  return elf_image_open_in (filename, NULL);
+}
+
+// With an arena from the caller, closing the image leaves its memory in
+// the arena for the caller to reset; without one the image gets an arena
+// of its own, limited by the memory budget, and closing releases it.
+ElfImage *
+elf_image_open_in (const char *filename, Arena *arena)
+{
+  Arena *own = NULL;
+  if (arena == NULL)
+    {
+      own = robust_malloc (sizeof (Arena));
+      if (own == NULL)
+        return NULL;
+      arena_init (own, memory_budget);
+      arena = own;
+    }
+
+  FileContents *file = robust_map_file (filename);
+  ElfImage *image = NULL;
+  if (file != NULL)
+    image = arena_alloc (arena, sizeof (ElfImage));
+
+  if (image == NULL)
+    {
+      release_file_contents (file);
+      if (own != NULL)
+        {
+          arena_release (own);
+          free (own);
+        }
+      return NULL;
+    }
+
+  if (elf_cache_load (image, file, arena) == 0)
+    {
+      image->own_arena = own != NULL;
+      return image;
+    }
+
+  int ret = elf_image_init (image, file, arena);
+  image->own_arena = own != NULL;
+  if (ret != 0)
+    {
+      elf_image_close (image);
+      return NULL;
+    }
+
+  elf_cache_store (image);
+
+  return image;
+}
+
+void
+elf_image_close (ElfImage *image)
+{
+  if (image == NULL)
+    return;
+
+  // the image lives in its arena, so read what's needed first
+  Arena *arena = image->own_arena ? image->arena : NULL;
+
+  if (image->cache != NULL)
+    munmap (image->cache, image->cache_size);
+  release_file_contents (image->file);
+
+  if (arena != NULL)
+    {
+      arena_release (arena);
+      free (arena);
+    }
+}
+
+const Elf64_Phdr *
+elf_image_phdr (const ElfImage *image, size_t index, Elf64_Phdr *scratch)
+{
+  return elf_phdr_at (&image->phdrs, index, scratch);
+}
+
+const Elf64_Shdr *
+elf_image_shdr (const ElfImage *image, size_t index, Elf64_Shdr *scratch)
+{
+  return elf_shdr_at (&image->shdrs, index, scratch);
+}
+
+const char *
+elf_image_section_name (const ElfImage *image, size_t index)
+{
+  if (index >= image->shdrs.count
+      || image->name_offsets[index] >= image->shstrtab_size)
+    return "";
+
+  return image->shstrtab + image->name_offsets[index];
+}
+
+long
+elf_image_find_section (ElfImage *image, const char *name)
+{
+  if (image->shdrs.count == 0)
+    return -1;
+
+  if (image->name_order == NULL && build_section_name_order (image) != 0)
+    return -1;
+
+  size_t lo = 0;
+  size_t hi = image->shdrs.count;
+
+  while (lo < hi)
+    {
+      size_t mid = lo + (hi - lo) / 2;
+      if (strcmp (elf_image_section_name (image, image->name_order[mid]),
+                  name)
+          < 0)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  if (lo < image->shdrs.count
+      && strcmp (elf_image_section_name (image, image->name_order[lo]), name)
+             == 0)
+    return (long)image->name_order[lo];
+
+  return -1;
+}
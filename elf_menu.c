@@ -1,16 +1,26 @@
+#define _DEFAULT_SOURCE
+
 #include <curses.h>
+#include <pthread.h>
+#include <semaphore.h>
 #include <stddef.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include "./include/elf_menu.h"
+#include "./include/msgqueue.h"
 #include "./include/my_elf.h"
+#include "./include/outbuf.h"
+#include "./include/stats.h"
 
-#define LARGE_PAD_HEIGHT 100 // Arbitrarily large to accommodate large content
-#define LARGE_PAD_WIDTH 100  // Adjust based on expected width of content
+#define LINE_INDEX_MIN 1024
+#define MENU_POLL_MS 100
+#define MENU_TEXT_CHUNK (1 << 14)
 
 int exit_program (void *);
 
-static int init_menu_pad (void);
 static int init_screen (void);
 static void cleanup_screen (void);
 static void draw_menu (int highlight);
@@ -21,21 +31,56 @@ static int num_menu_items = 0;
 static const char *title = NULL;
 static void *data = NULL;
 
-static int top_line = 0;
-static WINDOW *menu_pad = NULL;
+// Text printed by a menu action, paged once the action waits for the
+// user.  Only the offset of each line is indexed, so any line is found in
+// constant time and only the visible ones are ever drawn.
+typedef struct
+{
+  OutBuf text;
+  size_t *lines; // start of each line in text
+  size_t nlines;
+  size_t cap;
+} LineBuffer;
+
+static LineBuffer printed = { { NULL, 0, 0, -1 }, NULL, 0, 0 };
+static const char *action_title = NULL;
+
+// Menu actions run on their own thread so the terminal stays live.  The
+// action never touches curses: its text, and any view it wants shown, are
+// posted to the curses thread through a lock-free queue.  Showing a view
+// blocks the action until the user leaves it.
+enum
+{
+  MSG_TEXT,      // ptr: malloc'd text, value: its length
+  MSG_PAGE_TEXT, // page everything printed so far
+  MSG_PAGE_VIEW, // ptr: ViewHandoff
+  MSG_DONE,      // value: the action's return value
+};
 
-static int
-init_menu_pad (void)
+typedef struct
 {
-  menu_pad = newpad (LARGE_PAD_HEIGHT, LARGE_PAD_WIDTH);
-  if (menu_pad == NULL)
-    {
-      perror ("Failed to create a reasonably sized pad");
-      return -1;
-    }
+  MsgQueue queue;
+  sem_t resume; // posted once the curses thread is done with a handoff
+  int cancel;   // set by the curses thread, polled by the action
+  size_t progress_done;
+  size_t progress_total;
+  MenuAction action;
+  void *data;
+} ActionRun;
+
+typedef struct
+{
+  const char *heading;
+  const PagedView *view;
+} ViewHandoff;
 
-  return 0;
-}
+// only set while an action runs; worker_text only on the action's thread
+static ActionRun *current_run = NULL;
+static __thread OutBuf *worker_text = NULL;
+
+static int run_action (MenuAction action, void *arg);
+static void page_printed (void);
+static void page_view (const char *heading, const PagedView *view);
 
 static void
 do_init_screen (void)
@@ -53,15 +98,24 @@ init_screen (void)
 {
   do_init_screen ();
 
-  int ret = init_menu_pad ();
+  if (outbuf_init (&printed.text, -1, OUTBUF_DEFAULT_SIZE) != 0)
+    {
+      endwin ();
+      return -1;
+    }
 
-  return ret;
+  return 0;
 }
 
 static void
 cleanup_screen (void)
 {
   endwin ();
+
+  outbuf_free (&printed.text);
+  free (printed.lines);
+  printed.lines = NULL;
+  printed.nlines = printed.cap = 0;
 }
 
 static int
@@ -94,6 +148,7 @@ init_MenuAction (MenuConfig *config)
 static void
 draw_menu (int highlight)
 {
+  STAT_SCOPE (STAT_PHASE_RENDER);
   if (title != NULL)
     {
       mvprintw (0, 0, title);
@@ -209,7 +264,8 @@ do_elf_menu (void)
       if (choice == 10)
         {
           clear ();
-          int option = menu_items[highlight].action (data);
+          action_title = menu_items[highlight].text;
+          int option = run_action (menu_items[highlight].action, data);
           refresh ();
           if (option == 1)
             {
@@ -238,16 +294,420 @@ get_menu_input (void)
   return c;
 }
 
+// rows kept above and below the visible window, in screens
+#define VIEW_PREFETCH_SCREENS 1
+
+// Fetches the rows around top, keeping a prefetch margin on either side.
+// Returns the number of rows fetched; *top becomes top's index among them.
+static int
+fill_view_cache (const PagedView *view, uint64_t pos, ViewRow *cache,
+                 int cap, int margin, int *top)
+{
+  uint64_t start = view->back (view->ctx, pos, margin);
+  int n = view->rows (view->ctx, start, cache, cap);
+
+  *top = 0;
+  for (int i = 0; i < n; i++)
+    if (cache[i].pos == pos)
+      {
+        *top = i;
+        break;
+      }
+
+  return n;
+}
+
+static int
+prompt_address (uint64_t *addr)
+{
+  char buf[32];
+  char *end;
+
+  move (LINES - 1, 0);
+  clrtoeol ();
+  printw ("Go to address: 0x");
+  echo ();
+  int ret = getnstr (buf, sizeof (buf) - 1);
+  noecho ();
+
+  if (ret == ERR || buf[0] == '\0')
+    return -1;
+
+  *addr = strtoull (buf, &end, 16);
+  return *end == '\0' ? 0 : -1;
+}
+
+static void
+page_view (const char *heading, const PagedView *view)
+{
+  int height = LINES > 2 ? LINES - 2 : 1;
+  int margin = height * VIEW_PREFETCH_SCREENS;
+  int cap = margin + height + margin;
+  const char *status = NULL;
+
+  ViewRow *cache = calloc ((size_t)cap, sizeof (ViewRow));
+  if (cache == NULL)
+    {
+      printw ("Failed to allocate memory.\n");
+      (void)getch ();
+      return;
+    }
+
+  int top;
+  int n = fill_view_cache (view, view->first, cache, cap, margin, &top);
+
+  while (n > 0)
+    {
+      {
+        STAT_SCOPE (STAT_PHASE_RENDER);
+        erase ();
+        mvprintw (0, 0, "%s", heading);
+        for (int i = 0; i < height && top + i < n; i++)
+          mvaddnstr (i + 1, 0, cache[top + i].text, COLS);
+        if (status == NULL)
+          status = view->seek != NULL
+                       ? "[Up/Down PgUp/PgDn] scroll  [Home] top  "
+                         "[g] go to address  [q] back"
+                       : "[Up/Down PgUp/PgDn] scroll  [Home] top  [q] back";
+        mvprintw (LINES - 1, 0, "%s", status);
+        refresh ();
+        status = NULL;
+      }
+
+      int choice = getch ();
+      if (choice == 'q' || choice == 27)
+        break;
+
+      switch (choice)
+        {
+        case KEY_DOWN:
+        case 'j':
+          if (top + 1 < n)
+            top++;
+          break;
+        case KEY_UP:
+        case 'k':
+          if (top > 0)
+            top--;
+          break;
+        case KEY_NPAGE:
+        case ' ':
+          top = top + height < n ? top + height : n - 1;
+          break;
+        case KEY_PPAGE:
+          top = top > height ? top - height : 0;
+          break;
+        case KEY_HOME:
+          n = fill_view_cache (view, view->first, cache, cap, margin, &top);
+          continue;
+        case 'g':
+          {
+            uint64_t addr;
+            uint64_t pos;
+            if (view->seek == NULL)
+              continue;
+            if (prompt_address (&addr) != 0
+                || view->seek (view->ctx, addr, &pos) != 0)
+              {
+                status = "No code at that address";
+                continue;
+              }
+            n = fill_view_cache (view, pos, cache, cap, margin, &top);
+            continue;
+          }
+        default:
+          continue;
+        }
+
+      // refetch once the window nears either edge of what is cached
+      int near_top = top < margin / 2 && cache[0].pos != view->first;
+      int near_end = n == cap && top + height + margin / 2 > n;
+      if (near_top || near_end)
+        n = fill_view_cache (view, cache[top].pos, cache, cap, margin, &top);
+    }
+
+  free (cache);
+}
+
+static int
+line_buffer_append (LineBuffer *lb, const char *str, size_t len)
+{
+  size_t start = lb->text.len;
+
+  if (outbuf_write (&lb->text, str, len) != 0)
+    return -1;
+
+  // a line is indexed when its first character arrives
+  for (size_t i = 0; i < len; i++)
+    {
+      size_t at = start + i;
+      if (at != 0 && lb->text.data[at - 1] != '\n')
+        continue;
+
+      if (lb->nlines == lb->cap)
+        {
+          size_t cap = lb->cap ? lb->cap * 2 : LINE_INDEX_MIN;
+          size_t *lines = realloc (lb->lines, cap * sizeof (size_t));
+          if (lines == NULL)
+            return -1;
+          lb->lines = lines;
+          lb->cap = cap;
+        }
+      lb->lines[lb->nlines++] = at;
+    }
+
+  return 0;
+}
+
+static int
+line_buffer_rows (void *ctx, uint64_t pos, ViewRow *rows, int n)
+{
+  const LineBuffer *lb = ctx;
+  int i = 0;
+
+  for (; i < n && pos + i < lb->nlines; i++)
+    {
+      size_t start = lb->lines[pos + i];
+      size_t end = pos + i + 1 < lb->nlines ? lb->lines[pos + i + 1]
+                                            : lb->text.len;
+      if (end > start && lb->text.data[end - 1] == '\n')
+        end--;
+      if (end - start >= VIEW_ROW_WIDTH)
+        end = start + VIEW_ROW_WIDTH - 1;
+
+      rows[i].pos = pos + i;
+      memcpy (rows[i].text, lb->text.data + start, end - start);
+      rows[i].text[end - start] = '\0';
+    }
+
+  return i;
+}
+
+static uint64_t
+line_buffer_back (void *ctx, uint64_t pos, int n)
+{
+  return pos > (uint64_t)n ? pos - (uint64_t)n : 0;
+}
+
+static void
+page_printed (void)
+{
+  PagedView view = { &printed, 0, line_buffer_rows, line_buffer_back, NULL };
+
+  page_view (action_title != NULL ? action_title : "", &view);
+
+  printed.text.len = 0;
+  printed.nlines = 0;
+}
+
+static void
+post_message (int type, void *ptr, uint64_t value)
+{
+  Message msg = { type, ptr, value };
+  struct timespec pause = { 0, 200000 };
+
+  // the curses thread drains the queue at least every MENU_POLL_MS
+  while (msgqueue_push (&current_run->queue, &msg) != 0)
+    nanosleep (&pause, NULL);
+}
+
+static void
+flush_worker_text (void)
+{
+  if (worker_text->len == 0)
+    return;
+
+  // ownership of the text moves to the curses thread
+  post_message (MSG_TEXT, worker_text->data, worker_text->len);
+  worker_text->data = NULL;
+  worker_text->len = 0;
+  worker_text->cap = 0;
+}
+
+static void
+hand_off (int type, void *ptr)
+{
+  flush_worker_text ();
+  post_message (type, ptr, 0);
+  sem_wait (&current_run->resume);
+}
+
+static void *
+action_thread (void *arg)
+{
+  ActionRun *run = arg;
+  OutBuf text = { NULL, 0, 0, -1 };
+
+  worker_text = &text;
+  int option;
+  {
+    STAT_SCOPE (STAT_PHASE_FORMAT);
+    option = run->action (run->data);
+  }
+  flush_worker_text ();
+  worker_text = NULL;
+  outbuf_free (&text);
+
+  post_message (MSG_DONE, NULL, (uint64_t)option);
+
+  return NULL;
+}
+
+static void
+draw_progress (const ActionRun *run, int tick)
+{
+  static const char spinner[] = "|/-\\";
+  size_t done = __atomic_load_n (&run->progress_done, __ATOMIC_RELAXED);
+  size_t total = __atomic_load_n (&run->progress_total, __ATOMIC_RELAXED);
+
+  move (LINES - 1, 0);
+  clrtoeol ();
+  if (__atomic_load_n (&run->cancel, __ATOMIC_RELAXED))
+    printw ("Cancelling...");
+  else if (total > 0)
+    printw ("%c %s: %zu%%  [any key] cancel", spinner[tick % 4],
+            action_title, done * 100 / total);
+  else
+    printw ("%c %s: %zu lines  [any key] cancel", spinner[tick % 4],
+            action_title, printed.nlines);
+  refresh ();
+}
+
+// Runs an action on its own thread while this one keeps drawing progress,
+// and shows whatever the action hands over.  Any key cancels.
+static int
+run_action (MenuAction action, void *arg)
+{
+  ActionRun *run = calloc (1, sizeof (ActionRun));
+  pthread_t thread;
+
+  if (run == NULL)
+    return action (arg);
+
+  msgqueue_init (&run->queue);
+  sem_init (&run->resume, 0, 0);
+  run->action = action;
+  run->data = arg;
+  current_run = run;
+
+  if (pthread_create (&thread, NULL, action_thread, run) != 0)
+    {
+      current_run = NULL;
+      sem_destroy (&run->resume);
+      free (run);
+      return action (arg);
+    }
+
+  int option = 0;
+  int done = 0;
+  timeout (MENU_POLL_MS);
+
+  for (int tick = 0; !done; tick++)
+    {
+      Message msg;
+      while (!done && msgqueue_pop (&run->queue, &msg) == 0)
+        {
+          switch (msg.type)
+            {
+            case MSG_TEXT:
+              line_buffer_append (&printed, msg.ptr, msg.value);
+              free (msg.ptr);
+              break;
+            case MSG_PAGE_TEXT:
+            case MSG_PAGE_VIEW:
+              timeout (-1);
+              if (msg.type == MSG_PAGE_TEXT)
+                page_printed ();
+              else
+                page_view (((const ViewHandoff *)msg.ptr)->heading,
+                           ((const ViewHandoff *)msg.ptr)->view);
+              timeout (MENU_POLL_MS);
+              sem_post (&run->resume);
+              tick = 0;
+              break;
+            case MSG_DONE:
+              option = (int)msg.value;
+              done = 1;
+              break;
+            }
+        }
+
+      if (done)
+        break;
+
+      // quick actions finish before the first poll and never flash this
+      if (tick > 0)
+        draw_progress (run, tick);
+      if (getch () != ERR)
+        __atomic_store_n (&run->cancel, 1, __ATOMIC_RELAXED);
+    }
+
+  timeout (-1);
+  pthread_join (thread, NULL);
+  current_run = NULL;
+  sem_destroy (&run->resume);
+  free (run);
+
+  // whatever a cancelled action printed is dropped
+  printed.text.len = 0;
+  printed.nlines = 0;
+
+  return option;
+}
+
+int
+menu_cancelled (void)
+{
+  return current_run != NULL
+         && __atomic_load_n (&current_run->cancel, __ATOMIC_RELAXED);
+}
+
+void
+menu_progress (size_t done, size_t total)
+{
+  if (worker_text == NULL)
+    return;
+
+  __atomic_store_n (&current_run->progress_done, done, __ATOMIC_RELAXED);
+  __atomic_store_n (&current_run->progress_total, total, __ATOMIC_RELAXED);
+}
+
 void
 elfprint (const char *str)
 {
-  printw (str);
+  if (worker_text == NULL)
+    {
+      line_buffer_append (&printed, str, strlen (str));
+      return;
+    }
+
+  if (menu_cancelled ())
+    return;
+
+  outbuf_puts (worker_text, str);
+  if (worker_text->len >= MENU_TEXT_CHUNK)
+    flush_worker_text ();
 }
 
+// pages everything printed since the last call, then starts afresh
 void
 print_and_wait (const char *str)
 {
-  printw (str);
-  printw ("Press any key to continue: ");
-  (void)getch ();
+  elfprint (str);
+
+  if (worker_text == NULL)
+    page_printed ();
+  else if (!menu_cancelled ())
+    hand_off (MSG_PAGE_TEXT, NULL);
+}
+
+void
+do_paged_view (const char *heading, const PagedView *view)
+{
+  ViewHandoff handoff = { heading, view };
+
+  if (worker_text == NULL)
+    page_view (heading, view);
+  else if (!menu_cancelled ())
+    hand_off (MSG_PAGE_VIEW, &handoff);
 }
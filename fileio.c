@@ -1,9 +1,17 @@
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "./include/fileio.h"
+#include "./include/stats.h"
 
 int
 robust_fseek (FILE *stream, long offset, int whence)
@@ -153,6 +161,10 @@ robust_read_file (const char *filename)
   if (file_contents == NULL)
     goto err;
 
+  file_contents->buffer = NULL;
+  file_contents->mapped = 0;
+  memset (&file_contents->identity, 0, sizeof (FileIdentity));
+
   if (allocate_buffer_for_file (file, file_contents) == NULL)
     {
       fprintf (stderr, "Failed to allocate buffer for file.\n");
@@ -170,7 +182,7 @@ robust_read_file (const char *filename)
   return file_contents;
 
 err:
-  if (file_contents->buffer != NULL)
+  if (file_contents != NULL && file_contents->buffer != NULL)
     free (file_contents->buffer);
 
   if (file_contents != NULL)
@@ -182,6 +194,153 @@ err:
   return NULL;
 }
 
+// Read everything left on an already-open descriptor into a heap buffer.
+// Used for the files that cannot be mapped, which have no usable size.
+static FileContents *
+read_fd_contents (int fd)
+{
+  FileContents *file_contents = robust_malloc (sizeof (FileContents));
+  if (file_contents == NULL)
+    return NULL;
+
+  file_contents->buffer = NULL;
+  file_contents->length = 0;
+  file_contents->mapped = 0;
+  memset (&file_contents->identity, 0, sizeof (FileIdentity));
+
+  size_t capacity = 0;
+  for (;;)
+    {
+      if (file_contents->length == capacity)
+        {
+          size_t grown = capacity == 0 ? 65536 : capacity * 2;
+          char *buffer = realloc (file_contents->buffer, grown + 1);
+          if (buffer == NULL)
+            {
+              fprintf (stderr, "Failed to allocate memory.\n");
+              goto err;
+            }
+          file_contents->buffer = buffer;
+          capacity = grown;
+        }
+
+      ssize_t n = read (fd, file_contents->buffer + file_contents->length,
+                        capacity - file_contents->length);
+      if (n == 0)
+        break;
+      if (n < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          fprintf (stderr, "Failed to read file.\n");
+          goto err;
+        }
+      file_contents->length += (size_t)n;
+    }
+
+  return file_contents;
+
+err:
+  free (file_contents->buffer);
+  free (file_contents);
+  return NULL;
+}
+
+FileContents *
+robust_map_file (const char *filename)
+{
+  if (filename == NULL)
+    {
+      fprintf (stderr, "Filename is NULL.\n");
+      return NULL;
+    }
+
+  if (strlen (filename) > PATH_MAX)
+    {
+      fprintf (stderr, "Filename is too long.\n");
+      return NULL;
+    }
+
+  STAT_SCOPE (STAT_PHASE_MAP);
+  int fd = open (filename, O_RDONLY);
+  if (fd == -1)
+    {
+      fprintf (stderr, "Failed to open file.\n");
+      return NULL;
+    }
+
+  FileContents *file_contents = NULL;
+  struct stat sb;
+  if (fstat (fd, &sb) != 0)
+    {
+      fprintf (stderr, "Failed to stat file.\n");
+      goto err;
+    }
+
+  // pipes, procfs and empty files have nothing to map; read them instead
+  if (!S_ISREG (sb.st_mode) || sb.st_size == 0)
+    {
+      file_contents = read_fd_contents (fd);
+      close (fd);
+      return file_contents;
+    }
+
+  file_contents = robust_malloc (sizeof (FileContents));
+  if (file_contents == NULL)
+    goto err;
+
+  void *map = mmap (NULL, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (map == MAP_FAILED)
+    {
+      fprintf (stderr, "Failed to map file.\n");
+      goto err;
+    }
+
+  // headers and tables are read out of order; don't let the kernel read
+  // ahead the whole file on the first fault
+  (void)madvise (map, (size_t)sb.st_size, MADV_RANDOM);
+
+  file_contents->buffer = map;
+  file_contents->length = (size_t)sb.st_size;
+  file_contents->mapped = 1;
+  file_contents->identity.dev = (uint64_t)sb.st_dev;
+  file_contents->identity.inode = (uint64_t)sb.st_ino;
+  file_contents->identity.mtime_sec = (int64_t)sb.st_mtim.tv_sec;
+  file_contents->identity.mtime_nsec = (int64_t)sb.st_mtim.tv_nsec;
+  file_contents->identity.size = (uint64_t)sb.st_size;
+  STAT_ADD (STAT_FILES_MAPPED, 1);
+  STAT_ADD (STAT_BYTES_MAPPED, sb.st_size);
+
+  close (fd);
+  return file_contents;
+
+err:
+  if (file_contents != NULL)
+    free (file_contents);
+  close (fd);
+  return NULL;
+}
+
+void
+release_file_contents (FileContents *file_contents)
+{
+  if (file_contents == NULL)
+    return;
+
+  if (file_contents->mapped)
+    {
+      if (munmap (file_contents->buffer, file_contents->length) != 0)
+        fprintf (stderr, "Failed to unmap file.\n");
+    }
+  else if (file_contents->buffer != NULL)
+    {
+      free (file_contents->buffer);
+    }
+
+  file_contents->buffer = NULL;
+  free (file_contents);
+}
+
 #ifdef TEST_FILEIO
 int
 main (int argc, char **argv)
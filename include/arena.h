@@ -0,0 +1,30 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_BLOCK_SIZE (1 << 16)
+#define ARENA_ALIGN 16
+
+typedef struct _ArenaBlock ArenaBlock;
+
+// Bump allocator for everything derived from one opened file.  Nothing is
+// freed on its own: the whole arena is reset for the next file or released.
+// A reset folds all blocks into one sized for what the last file needed,
+// so a scan that reuses an arena stops calling malloc once it has seen its
+// largest file.  With a budget, allocations that would take the arena past
+// it fail instead.
+typedef struct
+{
+  ArenaBlock *blocks; // newest first
+  size_t reserved;    // bytes held in blocks
+  size_t used;        // bytes handed out since the last reset
+  size_t budget;      // cap on reserved, 0 for no limit
+} Arena;
+
+void arena_init (Arena *arena, size_t budget);
+void *arena_alloc (Arena *arena, size_t size);
+void arena_reset (Arena *arena);
+void arena_release (Arena *arena);
+
+#endif // ARENA_H
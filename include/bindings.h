@@ -0,0 +1,119 @@
+#ifndef BINDINGS_H
+#define BINDINGS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "deps.h"
+#include "elf_hash.h"
+#include "elf_image.h"
+
+// closure entry of a symbol nothing in the scope defines
+#define BIND_UNRESOLVED ((size_t)-1)
+
+// what a relocation's lookup passes over, as the loader classes them
+enum
+{
+  BIND_NORMAL,
+  BIND_PLT,  // PLT slots and TLS: canonical PLT entries are no definition
+  BIND_COPY, // copy relocations: the object's own definition is skipped
+  BIND_CLASSES
+};
+
+// a version index of an object, named by its verdef or verneed entry;
+// hash is 0 for indices that name no version
+typedef struct
+{
+  const char *name;
+  uint32_t hash;
+  int hidden; // only references asking for the version itself get it
+} BindVersion;
+
+// one .dynsym symbol the object's dynamic relocations look up, with its
+// hashes computed once for every table it is looked up in
+typedef struct
+{
+  const char *name;
+  uint32_t gnu;
+  uint32_t sysv;
+  const BindVersion *version; // NULL for an unversioned reference
+  uint32_t count[BIND_CLASSES]; // relocations against it
+  int weak; // an undefined weak reference may stay unresolved
+} SymbolRef;
+
+// What binding needs of one object: its hash table to be searched and the
+// symbols it searches for.  Made once per file by the resolver and shared
+// read-only; the image stays open as long as the scope.
+typedef struct _BindScope
+{
+  ElfImage *image;
+  DynsymHash hash;
+  const unsigned char *versym; // .gnu.version, NULL without versioning
+  size_t nversym;
+  size_t nversions;
+  BindVersion *versions; // by version index
+  size_t nrefs;
+  SymbolRef *refs;
+  uint64_t lookups; // relocations that look their symbol up
+  int symbolic;     // DT_SYMBOLIC: it searches itself before the rest
+  struct _BindScope *next;
+} BindScope;
+
+typedef struct
+{
+  uint64_t lookups;  // the object's relocations that look a symbol up
+  uint64_t probes;   // lookups that searched its hash table
+  uint64_t bound;    // lookups its definitions answered
+  uint64_t unresolved;
+} BindCounts;
+
+typedef struct
+{
+  size_t entry;
+  int canonical; // an executable's canonical PLT entry, not a definition
+  int unique;    // STB_GNU_UNIQUE: the process keeps one per name
+} BindDef;
+
+// a name looked up in the closure and every object that defines it, in
+// search order; the first one a lookup accepts is what it binds to
+typedef struct
+{
+  const char *name;
+  const BindVersion *version;
+  uint64_t count;
+  size_t first_def; // into BindReport.defs
+  size_t ndefs;
+  size_t unique; // where its unique definitions resolve, once one has
+} SymbolBinding;
+
+typedef struct
+{
+  size_t entry;
+  const SymbolRef *ref;
+} UnresolvedRef;
+
+typedef struct
+{
+  size_t nentries; // one BindCounts per closure entry
+  BindCounts *counts;
+  const BindScope **scopes; // NULL for entries without one
+  size_t nsymbols;
+  SymbolBinding *symbols;
+  size_t ndefs;
+  BindDef *defs;
+  size_t nunresolved;
+  UnresolvedRef *unresolved;
+  size_t nweak; // unresolved references that were weak
+  uint64_t lookups;
+  uint64_t probes;
+  size_t interposed;
+} BindReport;
+
+BindScope *bind_scope_open (const char *path);
+void bind_scope_close (BindScope *scope);
+
+int bind_closure (Resolver *resolver, const DepClosure *closure,
+                  BindReport *report);
+void bind_report_free (BindReport *report);
+
+#endif // BINDINGS_H
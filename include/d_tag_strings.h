@@ -0,0 +1,43 @@
+#ifndef D_TAG_STRINGS
+#define D_TAG_STRINGS
+
+"NULL",
+"NEEDED",
+"PLTRELSZ",
+"PLTGOT",
+"HASH",
+"STRTAB",
+"SYMTAB",
+"RELA",
+"RELASZ",
+"RELAENT",
+"STRSZ",
+"SYMENT",
+"INIT",
+"FINI",
+"SONAME",
+"RPATH",
+"SYMBOLIC",
+"REL",
+"RELSZ",
+"RELENT",
+"PLTREL",
+"DEBUG",
+"TEXTREL",
+"JMPREL",
+"BIND_NOW",
+"INIT_ARRAY",
+"FINI_ARRAY",
+"INIT_ARRAYSZ",
+"FINI_ARRAYSZ",
+"RUNPATH",
+"FLAGS",
+NULL,
+"PREINIT_ARRAY",
+"PREINIT_ARRAYSZ",
+"SYMTAB_SHNDX",
+"RELRSZ",
+"RELR",
+"RELRENT"
+
+#endif // D_TAG_STRINGS
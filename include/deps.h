@@ -0,0 +1,77 @@
+#ifndef DEPS_H
+#define DEPS_H
+
+#include <stddef.h>
+
+#include "elf_image.h"
+
+enum
+{
+  DEP_PENDING, // being parsed by another thread
+  DEP_OK,
+  DEP_MISSING, // no such file
+  DEP_INVALID  // not an ELF file that could be read
+};
+
+enum
+{
+  SCOPE_UNLOADED,
+  SCOPE_LOADING,
+  SCOPE_LOADED
+};
+
+struct _BindScope;
+
+// One file as the resolver saw it.  Each is made once per file, however
+// many paths lead to it, parsed by the first thread that needs it and
+// shared read-only from then on.  Search directories are expanded and
+// carry the sysroot already.
+typedef struct _DepObject
+{
+  const char *path; // the file with its links resolved, NULL if missing
+  int state;
+  unsigned char elf_class;
+  Elf64_Half machine;
+  const char *soname;
+  size_t nneeded;
+  const char **needed;
+  size_t nrpath; // DT_RPATH, ignored by the loader beside a DT_RUNPATH
+  const char **rpath;
+  size_t nrunpath;
+  const char **runpath;
+  int nodeflib; // DF_1_NODEFLIB: the default directories are not searched
+  const char *interp; // PT_INTERP under the sysroot, mapped before the rest
+  // loaded apart by resolver_scope, and only read under the lock before
+  int scope_state;
+  const struct _BindScope *scope;
+} DepObject;
+
+// one object of a closure, in the order the loader maps them
+typedef struct
+{
+  const char *name; // the DT_NEEDED string; the file's path for the root
+  const char *path; // where the search found it, sysroot included
+  const DepObject *object; // NULL when not found
+  size_t parent;           // entry whose DT_NEEDED brought it in
+  unsigned int depth;
+} DepEntry;
+
+typedef struct
+{
+  DepEntry *entries;
+  size_t count;
+  size_t cap;
+} DepClosure;
+
+typedef struct _Resolver Resolver;
+
+Resolver *resolver_new (const char *sysroot);
+void resolver_free (Resolver *resolver);
+int resolver_closure (Resolver *resolver, const char *path, ElfImage *image,
+                      DepClosure *closure);
+const char *resolver_path (const Resolver *resolver, const char *path);
+const struct _BindScope *resolver_scope (Resolver *resolver,
+                                         const DepObject *object);
+void dep_closure_free (DepClosure *closure);
+
+#endif // DEPS_H
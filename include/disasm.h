@@ -0,0 +1,34 @@
+#ifndef DISASM_H
+#define DISASM_H
+
+#include <stddef.h>
+
+#include "elf_image.h"
+#include "elf_menu.h"
+#include "outbuf.h"
+
+// Executable sections are cut at function symbols into chunks of at least
+// DISASM_CHUNK_MIN bytes; stretches without symbols are cut blindly every
+// DISASM_CHUNK_MAX bytes.  Chunks are decoded DISASM_WINDOW_CHUNKS per
+// thread at a time so buffered output stays bounded.
+#define DISASM_CHUNK_MIN (1 << 14)
+#define DISASM_CHUNK_MAX (1 << 18)
+#define DISASM_WINDOW_CHUNKS 8
+
+// instruction starts remembered at the head of each chunk, used to splice
+// it onto the end of the previous one
+#define DISASM_SYNC_WINDOW 32
+
+// the menu view remembers one instruction start per this many bytes
+#define DISASM_INDEX_STRIDE 256
+
+// furthest the menu view decodes back from a row it has to find
+#define DISASM_VIEW_RESYNC 4096
+
+typedef struct _DisasmView DisasmView;
+
+int disasm_image (ElfImage *image, OutBuf *out, int nthreads);
+DisasmView *disasm_view_open (ElfImage *image, PagedView *paged);
+void disasm_view_close (DisasmView *view);
+
+#endif // DISASM_H
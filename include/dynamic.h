@@ -0,0 +1,39 @@
+#ifndef DYNAMIC_H
+#define DYNAMIC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "elf_android.h"
+#include "elf_image.h"
+
+// The dynamic table of an image decoded into columns up to and including
+// its first DT_NULL, with the entries the loader needs to find other
+// objects resolved to strings.  Strings point into the file image and are
+// NULL when absent or out of the string table's bounds.
+typedef struct _DynamicInfo
+{
+  size_t section; // SHT_DYNAMIC section, 0 when found through PT_DYNAMIC
+  Elf64_Off offset;
+  size_t count; // 0 for files without a dynamic table
+  Elf64_Sxword *tag;
+  Elf64_Xword *val;
+  const char *strtab;
+  size_t strtab_size; // up to its last NUL
+  const char *soname;
+  const char *rpath;
+  const char *runpath;
+  size_t nneeded;
+  const char **needed;
+  Elf64_Xword flags;
+  Elf64_Xword flags_1;
+} DynamicInfo;
+
+DynamicInfo *elf_image_dynamic (ElfImage *image);
+const char *dynamic_string (const DynamicInfo *dyn, Elf64_Xword offset);
+int dynamic_tag_is_string (Elf64_Sxword tag);
+const char *dynamic_tag_name (Elf64_Sxword tag, char *buf, size_t size);
+int elf_image_vaddr_offset (const ElfImage *image, Elf64_Addr vaddr,
+                            Elf64_Off *offset, size_t *avail);
+
+#endif // DYNAMIC_H
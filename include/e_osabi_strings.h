@@ -11,5 +11,8 @@
 "Compaq TRU64 UNIX",
 "Novell Modesto",
 "OpenBSD",
-"Standalone (embedded) application"
+"Standalone (embedded) application",
+"ARM EABI",
+"ARM",
+"<unknown>"
 #endif // E_OSABI_STRINGS
\ No newline at end of file
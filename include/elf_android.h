@@ -0,0 +1,29 @@
+#ifndef ELF_ANDROID_H
+#define ELF_ANDROID_H
+
+// Section types and dynamic tags of Android's packed relocations, which
+// elf.h does not carry.  The values are bionic's.
+#ifndef SHT_ANDROID_REL
+#define SHT_ANDROID_REL 0x60000001
+#define SHT_ANDROID_RELA 0x60000002
+#endif
+
+// RELR as emitted before it had a generic section type
+#ifndef SHT_ANDROID_RELR
+#define SHT_ANDROID_RELR 0x6fffff00
+#endif
+
+#ifndef DT_ANDROID_REL
+#define DT_ANDROID_REL 0x6000000f
+#define DT_ANDROID_RELSZ 0x60000010
+#define DT_ANDROID_RELA 0x60000011
+#define DT_ANDROID_RELASZ 0x60000012
+#endif
+
+#ifndef DT_ANDROID_RELR
+#define DT_ANDROID_RELR 0x6fffe000
+#define DT_ANDROID_RELRSZ 0x6fffe001
+#define DT_ANDROID_RELRENT 0x6fffe003
+#endif
+
+#endif // ELF_ANDROID_H
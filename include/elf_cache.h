@@ -0,0 +1,19 @@
+#ifndef ELF_CACHE_H
+#define ELF_CACHE_H
+
+#include "arena.h"
+#include "elf_image.h"
+#include "fileio.h"
+
+// bumped whenever the layout of a cache file changes; older files are
+// then treated as missing and rewritten
+#define ELF_CACHE_VERSION 3
+
+// Parsed image metadata kept on disk between runs, one file per inode under
+// the cache directory.  A file is only trusted while the device, inode,
+// mtime and size of the ELF file still match the ones it was built from.
+int elf_cache_set_dir (const char *dir);
+int elf_cache_load (ElfImage *image, FileContents *file, Arena *arena);
+int elf_cache_store (ElfImage *image);
+
+#endif // ELF_CACHE_H
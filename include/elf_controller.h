@@ -1,13 +1,86 @@
 #ifndef ELF_CONTROLLER_H
 #define ELF_CONTROLLER_H
 
+#include "arena.h"
+#include "deps.h"
+#include "outbuf.h"
+
 #define SIZE_TEMPBUF 1024
 
 #define PHDR_MAIN_HEADER_TITLES_FORMAT "      %-14s %-18s %-18s %-18s\n"
 
 #define PHDR_SUBHEADER_TITLES_FORMAT "  %-18s %-18s %-18s %-6s %-6s\n", " "
 
+#define SYMBOL_TABLE_TITLE_FORMAT "Symbol table '%s' contains %zu entries:"
+
+#define SYMBOL_TABLE_SELECTED_TITLE_FORMAT                                    \
+  "Symbol table '%s' lists %zu of %zu entries:"
+
+#define SYMBOL_TITLES                                                         \
+  "   Num:    Value          Size Type    Bind   Vis      Ndx Name"
+
+#define SYMBOL_ROW_FORMAT "%6zu: %016lx %5lu %-7s %-6s %-8s %3s %s"
+
+#define RELOC_TABLE_TITLE_FORMAT                                              \
+  "Relocation section '%s' at offset 0x%lx contains %zu entries:"
+
+#define PACKED_TABLE_TITLE_FORMAT                                             \
+  "Relocation section '%s' at offset 0x%lx packs %zu entries into %zu "      \
+  "bytes (%s):"
+
+#define RELOC_TITLES                                                          \
+  "    Offset        Type                   Sym. Value       Sym. Name + "   \
+  "Addend"
+
+#define RELOC_ROW_FORMAT "%016lx  %-22s %16s %s"
+
+#define DYNAMIC_TITLE_FORMAT                                                  \
+  "Dynamic section at offset 0x%lx contains %zu entries:"
+
+#define DYNAMIC_TITLES "  Tag        Type                         Name/Value"
+
+#define STRING_DUMP_TITLE_FORMAT "String dump of section '%s' (%zu strings):"
+
+#define STRING_ROW_FORMAT "  [%6lx]  "
+
+#define BINDING_TITLES                                                        \
+  "     Lookups       Probes        Bound Hash   Object"
+
+#define BINDING_ROW_FORMAT "%12lu %12lu %12lu %-6s %s\n"
+
+#define BATCH_FILE_HEADER (1 << 0)
+#define BATCH_PROGRAM_HEADERS (1 << 1)
+#define BATCH_SECTION_HEADERS (1 << 2)
+#define BATCH_SYMBOLS (1 << 3)
+#define BATCH_DYN_SYMBOLS (1 << 4)
+#define BATCH_LOOKUP (1 << 5)
+#define BATCH_DISASSEMBLE (1 << 6)
+#define BATCH_RELOCS (1 << 7)
+#define BATCH_FORMAT_JSON (1 << 8)
+#define BATCH_FORMAT_NDJSON (1 << 9)
+#define BATCH_FORMAT_MASK (BATCH_FORMAT_JSON | BATCH_FORMAT_NDJSON)
+#define BATCH_SORT_ADDRESS (1 << 10)
+#define BATCH_SORT_SIZE (1 << 11)
+#define BATCH_DYN_RELOCS (1 << 12)
+#define BATCH_DYNAMIC (1 << 13)
+#define BATCH_DEPS (1 << 14)
+#define BATCH_BINDINGS (1 << 15)
+#define BATCH_STRINGS (1 << 16)
+#define BATCH_DEFINED_ONLY (1 << 17)
+#define BATCH_SYM_FILTER (1 << 18) // --sym-type or --min-size was given
+#define BATCH_MODIFIER_MASK                                                   \
+  (BATCH_FORMAT_MASK | BATCH_SORT_ADDRESS | BATCH_SORT_SIZE                   \
+   | BATCH_DEFINED_ONLY | BATCH_SYM_FILTER)
+
 int do_run_controller (const char *const filename);
+int do_run_batch (int nfiles, char *const files[], int flags);
+int do_batch_to (OutBuf *out, const char *const filename, int flags,
+                 int show_name, Arena *arena);
+void set_lookup_symbol (const char *name);
+void set_string_dump_section (const char *name);
+void set_symbol_filter (int type, uint64_t min_size);
+void set_dependency_resolver (Resolver *resolver);
+void set_disasm_threads (int nthreads);
 int format_and_print (const char *label, const char *format, ...);
 
 #endif // ELF_CONTROLLER_H
\ No newline at end of file
@@ -0,0 +1,59 @@
+#ifndef ELF_HASH_H
+#define ELF_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "elf_image.h"
+#include "symtab.h"
+
+enum
+{
+  DYNHASH_NONE,
+  DYNHASH_GNU,
+  DYNHASH_SYSV
+};
+
+// Name lookup over .dynsym through the object's own hash table, the same
+// way the dynamic loader does it.  Prefers DT_GNU_HASH, falls back to the
+// SysV DT_HASH table and finally to a linear scan.
+typedef struct
+{
+  const SymbolStore *dynsym;
+  const ElfLayout *layout;
+  int kind;
+
+  // SHT_GNU_HASH
+  const unsigned char *bloom;
+  const unsigned char *gnu_buckets;
+  const unsigned char *gnu_chain;
+  uint32_t gnu_nbuckets;
+  uint32_t symoffset;
+  uint32_t bloom_size;
+  uint32_t bloom_shift;
+  size_t gnu_nchain;
+
+  // SHT_HASH
+  const unsigned char *sysv_buckets;
+  const unsigned char *sysv_chain;
+  uint32_t sysv_nbuckets;
+  uint32_t sysv_nchain;
+} DynsymHash;
+
+// a caller's test on a symbol whose name matched
+typedef int (*DynsymFilter) (const SymbolStore *dynsym, size_t index,
+                             void *arg);
+
+uint32_t dynhash_gnu (const char *name);
+uint32_t dynhash_sysv (const char *name);
+
+int dynhash_init (DynsymHash *hash, ElfImage *image);
+long dynhash_lookup (const DynsymHash *hash, const char *name);
+long dynhash_lookup_hashed (const DynsymHash *hash, const char *name,
+                            uint32_t gnu, uint32_t sysv);
+long dynhash_lookup_binding (const DynsymHash *hash, const char *name,
+                             uint32_t gnu, uint32_t sysv, DynsymFilter filter,
+                             void *arg);
+const char *dynhash_kind_name (const DynsymHash *hash);
+
+#endif // ELF_HASH_H
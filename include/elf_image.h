@@ -0,0 +1,55 @@
+#ifndef ELF_IMAGE_H
+#define ELF_IMAGE_H
+
+#include "arena.h"
+#include "fileio.h"
+#include "my_elf.h"
+#include <stddef.h>
+#include <stdint.h>
+
+struct _SymbolStore;
+struct _RelocSet;
+struct _DynamicInfo;
+
+// Everything the views need about one opened file, parsed and validated
+// once at open time.  ELF32 and big-endian files are presented through the
+// same native Elf64 structs.  All tables point into the file image, or into the
+// metadata cache when the image was restored from one.  The image itself and
+// everything decoded from it live in its arena.
+typedef struct
+{
+  FileContents *file;
+  Arena *arena;
+  int own_arena; // arena was made for this image and goes with it
+  const ElfLayout *layout; // class and byte order the tables are read in
+  Elf64_Ehdr ehdr;
+  ElfTableView phdrs;
+  ElfTableView shdrs;
+  size_t shstrndx; // section name table, resolved through SHN_XINDEX
+  const char *shstrtab;
+  size_t shstrtab_size;   // up to its last NUL
+  uint32_t *name_offsets; // into shstrtab, one per section; out of range
+                          // for sections without a usable name
+  uint32_t *name_order;   // section indices sorted by name, built by the
+                          // first elf_image_find_section
+  struct _SymbolStore *symbols[2]; // .symtab and .dynsym, loaded lazily
+  struct _RelocSet *relocs;        // every REL/RELA table, loaded lazily
+  struct _DynamicInfo *dynamic;    // the dynamic table, loaded lazily
+  void *cache;            // metadata cache mapping the tables live in
+  size_t cache_size;
+} ElfImage;
+
+void elf_image_set_memory_budget (size_t budget);
+size_t elf_image_memory_budget (void);
+ElfImage *elf_image_open (const char *filename);
+ElfImage *elf_image_open_in (const char *filename, Arena *arena);
+int elf_image_init (ElfImage *image, FileContents *file, Arena *arena);
+void elf_image_close (ElfImage *image);
+const Elf64_Phdr *elf_image_phdr (const ElfImage *image, size_t index,
+                                  Elf64_Phdr *scratch);
+const Elf64_Shdr *elf_image_shdr (const ElfImage *image, size_t index,
+                                  Elf64_Shdr *scratch);
+const char *elf_image_section_name (const ElfImage *image, size_t index);
+long elf_image_find_section (ElfImage *image, const char *name);
+
+#endif // ELF_IMAGE_H
@@ -2,8 +2,10 @@
 #define ELF_MENU_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 #define MAX_MENU_ITEMS (0xf)
+#define VIEW_ROW_WIDTH 160
 
 typedef int (*MenuAction) (void *);
 
@@ -21,9 +23,33 @@ typedef struct _MenuConfig
   size_t item_count;
 } MenuConfig;
 
+typedef struct
+{
+  uint64_t pos;
+  char text[VIEW_ROW_WIDTH];
+} ViewRow;
+
+// A view whose rows are produced on demand.  Rows are named by opaque
+// positions that increase down the view; only the rows around the visible
+// window are ever requested, so the view may be arbitrarily long.
+typedef struct
+{
+  void *ctx;
+  uint64_t first;
+  // up to n rows starting at pos, returns how many there were
+  int (*rows) (void *ctx, uint64_t pos, ViewRow *rows, int n);
+  // position n rows above pos, or first
+  uint64_t (*back) (void *ctx, uint64_t pos, int n);
+  // position of the row showing addr, -1 if there is none
+  int (*seek) (void *ctx, uint64_t addr, uint64_t *pos);
+} PagedView;
+
 void elfprint (const char *str);
 void print_and_wait (const char *str);
 void do_elf_menu (void);
 int init_elf_menu (MenuConfig *config);
+void do_paged_view (const char *heading, const PagedView *view);
+int menu_cancelled (void);
+void menu_progress (size_t done, size_t total);
 
 #endif // ELF_MENU_H
@@ -1,16 +1,30 @@
 #ifndef FILEIO_H
 #define FILEIO_H
 
+#include <stdint.h>
 #include <stdio.h>
 
 #ifndef PATH_MAX
 #define PATH_MAX 4096
 #endif // PATH_MAX
 
+// Which file, in which state, a mapping was taken from.  All zero when the
+// contents were read rather than mapped.
+typedef struct
+{
+  uint64_t dev;
+  uint64_t inode;
+  int64_t mtime_sec;
+  int64_t mtime_nsec;
+  uint64_t size;
+} FileIdentity;
+
 typedef struct
 {
   char *buffer;
   size_t length;
+  int mapped; // buffer is a read-only mmap of the file, not a heap copy
+  FileIdentity identity;
 } FileContents;
 
 int robust_fseek (FILE *stream, long offset, int whence);
@@ -25,5 +39,7 @@ FileContents *allocate_buffer_for_file (FILE *file,
                                         FileContents *file_contents);
 FILE *robust_fopen_secure (const char *filename, const char *mode);
 FileContents *robust_read_file (const char *filename);
+FileContents *robust_map_file (const char *filename);
+void release_file_contents (FileContents *file_contents);
 
 #endif // ROBUSTFILEIO_H
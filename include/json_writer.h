@@ -0,0 +1,34 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "outbuf.h"
+
+// Streaming encoder for flat JSON records.  In NDJSON mode every record is
+// a line of its own; otherwise records are comma separated and the caller
+// wraps the whole stream in json_array_open/json_array_close.
+typedef struct
+{
+  OutBuf *out;
+  int ndjson;
+  size_t records; // records started by this writer
+  int fields;     // fields in the current record
+} JsonWriter;
+
+void json_writer_init (JsonWriter *jw, OutBuf *out, int ndjson);
+void json_array_open (OutBuf *out);
+void json_array_separator (OutBuf *out);
+void json_array_close (OutBuf *out);
+
+void json_record_begin (JsonWriter *jw, const char *kind);
+void json_record_end (JsonWriter *jw);
+void json_field_str (JsonWriter *jw, const char *key, const char *value);
+void json_field_strn (JsonWriter *jw, const char *key, const char *value,
+                      size_t len);
+void json_field_u64 (JsonWriter *jw, const char *key, uint64_t value);
+void json_field_i64 (JsonWriter *jw, const char *key, int64_t value);
+void json_field_bool (JsonWriter *jw, const char *key, int value);
+
+#endif // JSON_WRITER_H
@@ -0,0 +1,34 @@
+#ifndef MSGQUEUE_H
+#define MSGQUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MSGQUEUE_SIZE 1024 // power of two
+#define MSGQUEUE_CACHE_LINE 64
+
+typedef struct
+{
+  int type;
+  void *ptr;
+  uint64_t value;
+} Message;
+
+// Bounded single-producer/single-consumer queue.  Each side only ever
+// stores its own index, so push and pop need no lock, just acquire/release
+// ordering.  The indices sit on separate cache lines so the two threads do
+// not keep stealing the line from each other.
+typedef struct
+{
+  size_t head; // next slot to pop, written by the consumer
+  char pad0[MSGQUEUE_CACHE_LINE - sizeof (size_t)];
+  size_t tail; // next slot to fill, written by the producer
+  char pad1[MSGQUEUE_CACHE_LINE - sizeof (size_t)];
+  Message slots[MSGQUEUE_SIZE];
+} MsgQueue;
+
+void msgqueue_init (MsgQueue *queue);
+int msgqueue_push (MsgQueue *queue, const Message *msg);
+int msgqueue_pop (MsgQueue *queue, Message *msg);
+
+#endif // MSGQUEUE_H
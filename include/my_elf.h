@@ -8,15 +8,123 @@
 #endif
 #include "fileio.h"
 #include <stddef.h>
+#include <stdint.h>
 
-int get_elf_phdr (void *buffer, off_t offset, Elf64_Ehdr *ehdr,
-                  Elf64_Phdr *phdr);
+// A table of fixed-size entries read in place from the file image.  Entries
+// are only handed out by pointer when the table is in the host's own layout,
+// suitably aligned and the on-disk stride covers the native struct;
+// otherwise they are copied or decoded into caller-provided scratch space
+// one at a time.
+typedef struct
+{
+  const char *base;
+  size_t count;
+  size_t stride;
+  int aligned;
+  void (*decode) (const void *raw, void *out); // NULL for native entries
+} ElfTableView;
+
+// Symbol section indices are widened to 32 bits so SHT_SYMTAB_SHNDX can
+// supply indices at and past SHN_LORESERVE.  The reserved SHN_* values
+// (other than SHN_UNDEF) move out of their way to ELF_SHN (value).
+#define ELF_SHN_RESERVED 0xffff0000u
+#define ELF_SHN(shn) (ELF_SHN_RESERVED | (Elf64_Word)(shn))
+
+// destination columns for a layout's symbol decoder
+typedef struct
+{
+  Elf64_Addr *value;
+  Elf64_Xword *size;
+  Elf64_Word *name;
+  Elf64_Word *shndx;
+  unsigned char *info;
+  unsigned char *other;
+} ElfSymColumns;
+
+// destination columns for a layout's relocation decoder; addends are only
+// written for SHT_RELA tables
+typedef struct
+{
+  Elf64_Addr *offset;
+  Elf64_Word *sym;
+  Elf64_Word *type;
+  Elf64_Sxword *addend;
+} ElfRelColumns;
+
+// destination columns for a layout's dynamic table decoder
+typedef struct
+{
+  Elf64_Sxword *tag;
+  Elf64_Xword *val;
+} ElfDynColumns;
+
+// How files of one class and byte order are read, chosen once at open
+// from e_ident.  Everything comes out as the native Elf64 structs; the
+// layout matching the host leaves phdr and shdr NULL so its tables are
+// read in place.
+typedef struct
+{
+  unsigned char elf_class;
+  unsigned char data;
+  size_t ehdr_size;
+  size_t phdr_size;
+  size_t shdr_size;
+  size_t sym_size;
+  size_t rel_size;
+  size_t rela_size;
+  size_t dyn_size;
+  unsigned int addr_bits; // width of Elf_Addr and GNU hash bloom words
+  void (*ehdr) (const void *raw, Elf64_Ehdr *out);
+  void (*phdr) (const void *raw, void *out);
+  void (*shdr) (const void *raw, void *out);
+  void (*syms) (const char *base, size_t stride, size_t count,
+                const ElfSymColumns *out);
+  void (*rels) (const char *base, size_t stride, size_t count, int rela,
+                const ElfRelColumns *out);
+  void (*dyns) (const char *base, size_t count, const ElfDynColumns *out);
+  uint16_t (*read_half) (const unsigned char *p);
+  uint32_t (*read_word) (const unsigned char *p);
+  uint64_t (*read_addr) (const unsigned char *p);
+} ElfLayout;
+
+// Segment and section counts and the section name table index.  Files
+// with too many of either keep the real values in section 0, flagged by
+// e_phnum == PN_XNUM, e_shnum == 0 and e_shstrndx == SHN_XINDEX.
+typedef struct
+{
+  size_t phnum;
+  size_t shnum;
+  size_t shstrndx;
+} ElfCounts;
+
+const ElfLayout *elf_layout_of (const Elf64_Ehdr *ehdr);
+int get_elf_counts (const void *buffer, size_t size, const Elf64_Ehdr *ehdr,
+                    ElfCounts *counts);
 int get_elf_header (void *buffer, size_t size, Elf64_Ehdr *ehdr);
 int validate_elf_magic (const Elf64_Ehdr *ehdr);
 int validate_elf_header (const Elf64_Ehdr *ehdr);
 char *get_p_type (unsigned int p_type);
 char *get_p_flags (uint32_t p_flags, char *buf);
-int get_elf_shdr (void *buffer, off_t offset, Elf64_Ehdr *ehdr,
-                  Elf64_Shdr *shdr);
+int get_elf_table_view (const void *buffer, size_t size, Elf64_Off offset,
+                        size_t count, size_t stride, size_t entsize,
+                        size_t align, ElfTableView *view);
+int get_elf_phdr_view (const void *buffer, size_t size,
+                       const Elf64_Ehdr *ehdr, ElfTableView *view);
+int get_elf_shdr_view (const void *buffer, size_t size,
+                       const Elf64_Ehdr *ehdr, ElfTableView *view);
+const void *elf_view_entry (const ElfTableView *view, size_t index,
+                            void *scratch, size_t entsize);
+
+static inline const Elf64_Phdr *
+elf_phdr_at (const ElfTableView *view, size_t index, Elf64_Phdr *scratch)
+{
+  return elf_view_entry (view, index, scratch, sizeof (Elf64_Phdr));
+}
+
+static inline const Elf64_Shdr *
+elf_shdr_at (const ElfTableView *view, size_t index, Elf64_Shdr *scratch)
+{
+  return elf_view_entry (view, index, scratch, sizeof (Elf64_Shdr));
+}
 
 #endif // MY_ELF_H
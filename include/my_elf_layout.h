@@ -0,0 +1,236 @@
+// Readers for one ELF class and byte order.  my_elf.c includes this once
+// per layout with ELF_BITS (32 or 64), ELF_DATA (ELFDATA2LSB or
+// ELFDATA2MSB) and ELF_SUFFIX naming the copy, so there is deliberately no
+// include guard.  Everything below is resolved at compile time: a copy
+// either swaps every field or none, and never tests which.
+
+#define LAYOUT_PASTE(a, b) a##_##b
+#define LAYOUT_NAME(a, b) LAYOUT_PASTE (a, b)
+#define LAYOUT_FN(name) LAYOUT_NAME (name, ELF_SUFFIX)
+
+#if ELF_BITS == 64
+#define RAW(type) Elf64_##type
+#define LAYOUT_CLASS ELFCLASS64
+#define R_SYM(info) ELF64_R_SYM (info)
+#define R_TYPE(info) ELF64_R_TYPE (info)
+#define ADDEND Elf64_Sxword
+#define DYN_TAG Elf64_Sxword
+#else
+#define RAW(type) Elf32_##type
+#define LAYOUT_CLASS ELFCLASS32
+#define R_SYM(info) ELF32_R_SYM (info)
+#define R_TYPE(info) ELF32_R_TYPE (info)
+#define ADDEND Elf32_Sword
+#define DYN_TAG Elf32_Sword
+#endif
+
+#if (ELF_DATA == ELFDATA2LSB) == (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define LAYOUT_SWAP 0
+#else
+#define LAYOUT_SWAP 1
+#endif
+
+#if LAYOUT_SWAP
+#define GET(v)                                                                \
+  (sizeof (v) == 1   ? (uint64_t)(v)                                          \
+   : sizeof (v) == 2 ? (uint64_t)__builtin_bswap16 ((uint16_t)(v))            \
+   : sizeof (v) == 4 ? (uint64_t)__builtin_bswap32 ((uint32_t)(v))            \
+                     : (uint64_t)__builtin_bswap64 ((uint64_t)(v)))
+#else
+#define GET(v) (v)
+#endif
+
+// the host's own 64-bit layout is read in place
+#define LAYOUT_NATIVE (ELF_BITS == 64 && !LAYOUT_SWAP)
+
+static void
+LAYOUT_FN (decode_ehdr) (const void *raw, Elf64_Ehdr *out)
+{
+  RAW (Ehdr) in;
+  memcpy (&in, raw, sizeof (in));
+
+  memcpy (out->e_ident, in.e_ident, EI_NIDENT);
+  out->e_type = GET (in.e_type);
+  out->e_machine = GET (in.e_machine);
+  out->e_version = GET (in.e_version);
+  out->e_entry = GET (in.e_entry);
+  out->e_phoff = GET (in.e_phoff);
+  out->e_shoff = GET (in.e_shoff);
+  out->e_flags = GET (in.e_flags);
+  out->e_ehsize = GET (in.e_ehsize);
+  out->e_phentsize = GET (in.e_phentsize);
+  out->e_phnum = GET (in.e_phnum);
+  out->e_shentsize = GET (in.e_shentsize);
+  out->e_shnum = GET (in.e_shnum);
+  out->e_shstrndx = GET (in.e_shstrndx);
+}
+
+#if !LAYOUT_NATIVE
+static void
+LAYOUT_FN (decode_phdr) (const void *raw, void *scratch)
+{
+  RAW (Phdr) in;
+  Elf64_Phdr *out = scratch;
+  memcpy (&in, raw, sizeof (in));
+
+  out->p_type = GET (in.p_type);
+  out->p_flags = GET (in.p_flags);
+  out->p_offset = GET (in.p_offset);
+  out->p_vaddr = GET (in.p_vaddr);
+  out->p_paddr = GET (in.p_paddr);
+  out->p_filesz = GET (in.p_filesz);
+  out->p_memsz = GET (in.p_memsz);
+  out->p_align = GET (in.p_align);
+}
+
+static void
+LAYOUT_FN (decode_shdr) (const void *raw, void *scratch)
+{
+  RAW (Shdr) in;
+  Elf64_Shdr *out = scratch;
+  memcpy (&in, raw, sizeof (in));
+
+  out->sh_name = GET (in.sh_name);
+  out->sh_type = GET (in.sh_type);
+  out->sh_flags = GET (in.sh_flags);
+  out->sh_addr = GET (in.sh_addr);
+  out->sh_offset = GET (in.sh_offset);
+  out->sh_size = GET (in.sh_size);
+  out->sh_link = GET (in.sh_link);
+  out->sh_info = GET (in.sh_info);
+  out->sh_addralign = GET (in.sh_addralign);
+  out->sh_entsize = GET (in.sh_entsize);
+}
+#endif
+
+static void
+LAYOUT_FN (decode_syms) (const char *base, size_t stride, size_t count,
+                         const ElfSymColumns *out)
+{
+  for (size_t i = 0; i < count; i++)
+    {
+      RAW (Sym) in;
+      memcpy (&in, base + i * stride, sizeof (in));
+
+      out->value[i] = GET (in.st_value);
+      out->size[i] = GET (in.st_size);
+      out->name[i] = GET (in.st_name);
+      // reserved values move above every real index, see ELF_SHN
+      Elf64_Word shndx = GET (in.st_shndx);
+      out->shndx[i] = shndx | (-(Elf64_Word)(shndx >= SHN_LORESERVE)
+                               & ELF_SHN_RESERVED);
+      out->info[i] = in.st_info;
+      out->other[i] = in.st_other;
+    }
+}
+
+// one loop per entry kind, so neither tests which it is per entry
+static void
+LAYOUT_FN (decode_rels) (const char *base, size_t stride, size_t count,
+                         int rela, const ElfRelColumns *out)
+{
+  if (rela)
+    for (size_t i = 0; i < count; i++)
+      {
+        RAW (Rela) in;
+        memcpy (&in, base + i * stride, sizeof (in));
+
+        uint64_t info = GET (in.r_info);
+        out->offset[i] = GET (in.r_offset);
+        out->sym[i] = R_SYM (info);
+        out->type[i] = R_TYPE (info);
+        out->addend[i] = (ADDEND)GET (in.r_addend);
+      }
+  else
+    for (size_t i = 0; i < count; i++)
+      {
+        RAW (Rel) in;
+        memcpy (&in, base + i * stride, sizeof (in));
+
+        uint64_t info = GET (in.r_info);
+        out->offset[i] = GET (in.r_offset);
+        out->sym[i] = R_SYM (info);
+        out->type[i] = R_TYPE (info);
+      }
+}
+
+static void
+LAYOUT_FN (decode_dyns) (const char *base, size_t count,
+                         const ElfDynColumns *out)
+{
+  for (size_t i = 0; i < count; i++)
+    {
+      RAW (Dyn) in;
+      memcpy (&in, base + i * sizeof (in), sizeof (in));
+
+      out->tag[i] = (DYN_TAG)GET (in.d_tag);
+      out->val[i] = GET (in.d_un.d_val);
+    }
+}
+
+static uint16_t
+LAYOUT_FN (read_half) (const unsigned char *p)
+{
+  uint16_t v;
+  memcpy (&v, p, sizeof (v));
+  return GET (v);
+}
+
+static uint32_t
+LAYOUT_FN (read_word) (const unsigned char *p)
+{
+  uint32_t v;
+  memcpy (&v, p, sizeof (v));
+  return GET (v);
+}
+
+static uint64_t
+LAYOUT_FN (read_addr) (const unsigned char *p)
+{
+  RAW (Addr) v;
+  memcpy (&v, p, sizeof (v));
+  return GET (v);
+}
+
+static const ElfLayout LAYOUT_FN (layout) = {
+  LAYOUT_CLASS,
+  ELF_DATA,
+  sizeof (RAW (Ehdr)),
+  sizeof (RAW (Phdr)),
+  sizeof (RAW (Shdr)),
+  sizeof (RAW (Sym)),
+  sizeof (RAW (Rel)),
+  sizeof (RAW (Rela)),
+  sizeof (RAW (Dyn)),
+  ELF_BITS,
+  LAYOUT_FN (decode_ehdr),
+#if LAYOUT_NATIVE
+  NULL,
+  NULL,
+#else
+  LAYOUT_FN (decode_phdr),
+  LAYOUT_FN (decode_shdr),
+#endif
+  LAYOUT_FN (decode_syms),
+  LAYOUT_FN (decode_rels),
+  LAYOUT_FN (decode_dyns),
+  LAYOUT_FN (read_half),
+  LAYOUT_FN (read_word),
+  LAYOUT_FN (read_addr),
+};
+
+#undef LAYOUT_PASTE
+#undef LAYOUT_NAME
+#undef LAYOUT_FN
+#undef RAW
+#undef LAYOUT_CLASS
+#undef R_SYM
+#undef R_TYPE
+#undef ADDEND
+#undef DYN_TAG
+#undef LAYOUT_SWAP
+#undef GET
+#undef LAYOUT_NATIVE
+#undef ELF_BITS
+#undef ELF_DATA
+#undef ELF_SUFFIX
@@ -0,0 +1,29 @@
+#ifndef OUTBUF_H
+#define OUTBUF_H
+
+#include <stdarg.h>
+#include <stddef.h>
+
+#define OUTBUF_DEFAULT_SIZE (1 << 16)
+
+// Append-only output buffer.  With a file descriptor it is flushed whenever
+// it fills up; with fd == -1 it grows and keeps everything in memory.
+typedef struct
+{
+  char *data;
+  size_t len;
+  size_t cap;
+  int fd;
+} OutBuf;
+
+int outbuf_init (OutBuf *ob, int fd, size_t cap);
+void outbuf_free (OutBuf *ob);
+int outbuf_flush (OutBuf *ob);
+int outbuf_reserve (OutBuf *ob, size_t len);
+int outbuf_write (OutBuf *ob, const void *data, size_t len);
+int outbuf_puts (OutBuf *ob, const char *str);
+int outbuf_putc (OutBuf *ob, char c);
+int outbuf_vprintf (OutBuf *ob, const char *format, va_list args);
+int outbuf_printf (OutBuf *ob, const char *format, ...);
+
+#endif // OUTBUF_H
@@ -0,0 +1,119 @@
+#ifndef RELOC_H
+#define RELOC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "elf_android.h"
+#include "elf_image.h"
+
+// types past this are counted together in the last summary bucket
+#define RELOC_TYPE_MAX 0xffff
+
+// Entries of one SHT_REL/SHT_RELA section decoded column by column out of
+// the mapped image, in a single block of the image's arena.
+typedef struct
+{
+  size_t section;
+  size_t symtab; // sh_link
+  size_t target; // sh_info, 0 when the table applies to the whole image
+  int rela;
+  int dynamic; // SHF_ALLOC: applied by the dynamic loader at startup
+  size_t count;
+  Elf64_Addr *offset;
+  Elf64_Word *sym;
+  Elf64_Word *type;
+  Elf64_Sxword *addend; // NULL for SHT_REL
+} RelocTable;
+
+typedef enum
+{
+  PACKED_RELR, // SHT_RELR: bitmaps of relative relocations
+  PACKED_APS2  // SHT_ANDROID_REL/RELA: SLEB128 deltas grouped by Android
+} PackedKind;
+
+// A compressed relocation section, kept as the bytes in the image and
+// expanded only by iterating over it.
+typedef struct
+{
+  size_t section;
+  size_t symtab;
+  PackedKind kind;
+  int rela;
+  int dynamic;
+  const unsigned char *data;
+  size_t size;
+  RelocTable *expanded; // set once the table was listed in full
+} PackedTable;
+
+typedef struct _RelocSet
+{
+  size_t ntables;
+  RelocTable *tables;
+  size_t npacked;
+  PackedTable *packed;
+} RelocSet;
+
+typedef struct
+{
+  Elf64_Addr offset;
+  Elf64_Word sym;
+  Elf64_Word type;
+  Elf64_Sxword addend;
+} RelocEntry;
+
+// Expands one packed table a relocation at a time, keeping only the
+// decoder state between calls.
+typedef struct
+{
+  const PackedTable *table;
+  const unsigned char *p;
+  const unsigned char *end;
+  uint64_t (*read_addr) (const unsigned char *p);
+  unsigned int word_bytes;
+  int wide_info; // ELF64 r_info layout
+  int malformed;
+  RelocEntry entry;
+  // RELR: next address a bitmap starts at, and the bits left in it
+  uint64_t bitmap;
+  Elf64_Addr base;
+  unsigned int bit;
+  // APS2: relocations left overall and in the current group
+  uint64_t remaining;
+  uint64_t group_left;
+  uint64_t group_flags;
+  Elf64_Sxword group_delta;
+} PackedIter;
+
+// Totals over the tables of a set.  Entries of tables without a target
+// section are placed by the section their offset falls in; the ones that
+// fall in none are counted at index nsections.
+typedef struct
+{
+  size_t tables;
+  uint64_t entries;
+  uint64_t *type_counts;
+  size_t ntypes;
+  uint64_t *section_counts;
+  size_t nsections;
+  // packed tables: their entries, their size, and the size the same
+  // entries would take as plain REL/RELA tables
+  size_t packed_tables;
+  uint64_t packed_entries;
+  uint64_t packed_bytes;
+  uint64_t unpacked_bytes;
+} RelocSummary;
+
+RelocSet *elf_image_relocs (ElfImage *image);
+int reloc_summarize (const ElfImage *image, const RelocSet *set,
+                     int dynamic_only, RelocSummary *summary);
+void reloc_summary_free (RelocSummary *summary);
+const char *reloc_type_name (const ElfImage *image, Elf64_Word type,
+                             char *buf, size_t size);
+
+void packed_iter_init (PackedIter *it, const ElfImage *image,
+                       const PackedTable *table);
+int packed_iter_next (PackedIter *it, RelocEntry *entry);
+const RelocTable *packed_reloc_table (ElfImage *image, PackedTable *table);
+
+#endif // RELOC_H
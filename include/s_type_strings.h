@@ -33,6 +33,10 @@
 "LOPROC",
 "HIPROC",
 "LOUSER",
-"HIUSER"
+"HIUSER",
+"RELR",
+"ANDROID_REL",
+"ANDROID_RELA",
+"ANDROID_RELR"
 
 #endif // S_TYPE_STRINGS
@@ -0,0 +1,8 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#define SCAN_BATCH_FILES 4096
+
+int do_run_scan (const char *const dirname, int flags, int nthreads);
+
+#endif // SCAN_H
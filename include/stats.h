@@ -0,0 +1,70 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Where the time of a run goes, reported by --stats.  Phases are timed
+// exclusively: a phase entered inside another pauses the outer one, so
+// the phases of a thread add up to the time it spent in any of them.
+typedef enum
+{
+  STAT_PHASE_MAP,     // opening and mapping files
+  STAT_PHASE_PARSE,   // headers, section tables and the name index
+  STAT_PHASE_SYMBOLS, // symbol table decoding
+  STAT_PHASE_FORMAT,  // turning parsed tables into text or JSON
+  STAT_PHASE_DISASM,  // instruction decoding
+  STAT_PHASE_WRITE,   // writing output to its file descriptor
+  STAT_PHASE_RENDER,  // drawing curses screens
+  STAT_PHASE_COUNT
+} StatPhase;
+
+typedef enum
+{
+  STAT_FILES_MAPPED,
+  STAT_BYTES_MAPPED,
+  STAT_PAGES_TOUCHED, // pages under the tables a view was made over
+  STAT_ENTRIES_DECODED,
+  STAT_FORMAT_CALLS,
+  STAT_BYTES_EMITTED,
+  STAT_OBJECTS_PARSED, // by the --deps resolver, once however often needed
+  STAT_COUNTER_COUNT
+} StatCounter;
+
+// nominal page size for STAT_PAGES_TOUCHED
+#define STAT_PAGE_SIZE 4096
+
+// Building with ELFREAD_STATS defined (make STATS=1) compiles the
+// instrumentation in; without it every hook below expands to nothing.
+#ifdef ELFREAD_STATS
+
+typedef struct
+{
+  int phase;
+  int outer;
+} StatTimer;
+
+StatTimer stats_timer_begin (StatPhase phase);
+void stats_timer_end (StatTimer *timer);
+void stats_add (StatCounter counter, uint64_t n);
+
+#define STAT_PASTE(a, b) a##b
+#define STAT_NAME(line) STAT_PASTE (stat_timer_, line)
+
+// times the rest of the enclosing block as PHASE
+#define STAT_SCOPE(phase)                                                     \
+  StatTimer STAT_NAME (__LINE__)                                              \
+      __attribute__ ((cleanup (stats_timer_end), unused))                     \
+      = stats_timer_begin (phase)
+#define STAT_ADD(counter, n) stats_add ((counter), (uint64_t)(n))
+
+#else
+
+#define STAT_SCOPE(phase) ((void)0)
+#define STAT_ADD(counter, n) ((void)0)
+
+#endif // ELFREAD_STATS
+
+void stats_report (FILE *stream);
+
+#endif // STATS_H
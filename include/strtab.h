@@ -0,0 +1,31 @@
+#ifndef STRTAB_H
+#define STRTAB_H
+
+#include <stddef.h>
+
+#include "elf_image.h"
+
+// The non-empty strings of one string section, indexed by where each one
+// starts.  Names may still point inside a string, as merged tails do.  The
+// data stays in the file image; only the index is allocated, and it goes
+// with strtab_free.  A section that does not end in a NUL lists its last
+// string up to the end, but no name offset can reach it.
+typedef struct
+{
+  size_t section;
+  const char *data;
+  size_t size;
+  size_t terminated; // bytes up to the last NUL: the offsets names may use
+  size_t count;
+  size_t *starts; // ascending
+} StringTable;
+
+size_t strtab_terminated (const char *data, size_t size);
+size_t strtab_scan (const char *data, size_t size, size_t *starts);
+int strtab_is_strings (const ElfImage *image, size_t section);
+int strtab_load (StringTable *table, const ElfImage *image, size_t section);
+void strtab_free (StringTable *table);
+size_t strtab_length (const StringTable *table, size_t index);
+long strtab_find (const StringTable *table, size_t offset);
+
+#endif // STRTAB_H
@@ -0,0 +1,32 @@
+#ifndef SYMINDEX_H
+#define SYMINDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "elf_image.h"
+
+#define SYMBOLIZE_BATCH 4096
+
+// Address -> symbol index over the defined functions and objects of
+// .symtab and .dynsym.  Symbol start addresses are kept in Eytzinger
+// (BFS) order so a lookup walks a cache friendly implicit tree, and the
+// remaining columns stay in sorted order for the final interval check.
+// The arrays live in the image's arena and go with it.
+typedef struct
+{
+  size_t count;
+  uint64_t *tree;     // 1-based Eytzinger order, count + 1 entries
+  uint32_t *rank;     // tree slot -> sorted position
+  Elf64_Addr *start;  // sorted
+  Elf64_Addr *end;    // exclusive
+  const char **names; // sorted
+} AddrIndex;
+
+int addrindex_build (AddrIndex *index, ElfImage *image);
+void addrindex_lookup_batch (const AddrIndex *index, const Elf64_Addr *addrs,
+                             size_t n, long *out);
+
+int do_run_symbolize (const char *const filename, int flags);
+
+#endif // SYMINDEX_H
@@ -0,0 +1,51 @@
+#ifndef SYMTAB_H
+#define SYMTAB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "elf_image.h"
+
+// Symbols of one SHT_SYMTAB/SHT_DYNSYM section decoded column by column.
+// Every column lives in a single block of the image's arena, and scans over
+// one attribute stay cache friendly.
+typedef struct _SymbolStore
+{
+  size_t count;
+  Elf64_Addr *value;
+  Elf64_Xword *size;
+  Elf64_Word *name;
+  Elf64_Word *shndx; // reserved SHN_* values are stored as ELF_SHN (value)
+  unsigned char *info;
+  unsigned char *other;
+  const char *strtab;
+  size_t strtab_size; // up to its last NUL, so names below it end inside
+  size_t section;     // index of the symbol table section
+} SymbolStore;
+
+size_t symstore_columns_size (size_t count);
+void symstore_bind_columns (SymbolStore *store, void *block, size_t count);
+int symstore_load (SymbolStore *store, const ElfImage *image, size_t section);
+SymbolStore *elf_image_symbols (ElfImage *image, Elf64_Word sh_type);
+long find_symbol_section (const ElfImage *image, Elf64_Word sh_type);
+const char *symstore_name (const SymbolStore *store, size_t index);
+
+size_t symstore_select_type (const SymbolStore *store, unsigned char type,
+                             uint32_t *sel, size_t n);
+size_t symstore_select_defined (const SymbolStore *store, uint32_t *sel,
+                                size_t n);
+size_t symstore_select_min_size (const SymbolStore *store, Elf64_Xword size,
+                                 uint32_t *sel, size_t n);
+int radix_sort_by_key (const uint64_t *keys, uint32_t *order, size_t n);
+int symstore_sort_by_address (const SymbolStore *store, uint32_t *order,
+                              size_t n);
+int symstore_sort_by_size (const SymbolStore *store, uint32_t *order,
+                           size_t n);
+
+const char *symbol_type_name (unsigned char info);
+int symbol_type_from_name (const char *name);
+const char *symbol_bind_name (unsigned char info);
+const char *symbol_visibility_name (unsigned char other);
+const char *symbol_shndx_name (Elf64_Word shndx, char *buf, size_t size);
+
+#endif // SYMTAB_H
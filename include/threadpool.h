@@ -0,0 +1,16 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <stddef.h>
+
+#define POOL_MAX_THREADS 256
+
+// Runs task (ctx, index, worker) for every index in [0, ntasks).  Each
+// worker starts on its own contiguous slice and steals half of the
+// remaining slice of a busy worker once its own runs dry.
+typedef void (*PoolTask) (void *ctx, size_t index, int worker);
+
+int pool_default_threads (void);
+int pool_run (size_t ntasks, int nthreads, PoolTask task, void *ctx);
+
+#endif // THREADPOOL_H
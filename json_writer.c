@@ -0,0 +1,225 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "./include/json_writer.h"
+#include "./include/outbuf.h"
+#include "./include/stats.h"
+
+static const char hex_digits[] = "0123456789abcdef";
+
+void
+json_writer_init (JsonWriter *jw, OutBuf *out, int ndjson)
+{
+  jw->out = out;
+  jw->ndjson = ndjson;
+  jw->records = 0;
+  jw->fields = 0;
+}
+
+void
+json_array_open (OutBuf *out)
+{
+  outbuf_write (out, "[\n", 2);
+}
+
+void
+json_array_separator (OutBuf *out)
+{
+  outbuf_write (out, ",\n", 2);
+}
+
+void
+json_array_close (OutBuf *out)
+{
+  outbuf_write (out, "\n]\n", 3);
+}
+
+static void
+write_u64 (OutBuf *out, uint64_t value)
+{
+  char digits[20];
+  size_t n = 0;
+
+  do
+    {
+      digits[sizeof (digits) - ++n] = (char)('0' + value % 10);
+      value /= 10;
+    }
+  while (value != 0);
+
+  outbuf_write (out, digits + sizeof (digits) - n, n);
+}
+
+// Length of the well-formed UTF-8 sequence starting at s, or 0 when the
+// bytes there are not one (stray continuation, overlong form, surrogate,
+// beyond U+10FFFF or truncated).
+static size_t
+utf8_sequence_length (const unsigned char *s, size_t avail)
+{
+  size_t n;
+  unsigned char lo = 0x80, hi = 0xbf;
+
+  if (s[0] >= 0xc2 && s[0] <= 0xdf)
+    n = 2;
+  else if (s[0] >= 0xe0 && s[0] <= 0xef)
+    {
+      n = 3;
+      if (s[0] == 0xe0)
+        lo = 0xa0;
+      else if (s[0] == 0xed)
+        hi = 0x9f;
+    }
+  else if (s[0] >= 0xf0 && s[0] <= 0xf4)
+    {
+      n = 4;
+      if (s[0] == 0xf0)
+        lo = 0x90;
+      else if (s[0] == 0xf4)
+        hi = 0x8f;
+    }
+  else
+    return 0;
+
+  if (avail < n || s[1] < lo || s[1] > hi)
+    return 0;
+  for (size_t i = 2; i < n; i++)
+    if ((s[i] & 0xc0) != 0x80)
+      return 0;
+
+  return n;
+}
+
+// ELF names are arbitrary bytes.  Valid UTF-8 is copied through; every
+// byte that is not part of a well-formed sequence becomes U+FFFD so the
+// output always parses.
+static void
+write_string (OutBuf *out, const char *value, size_t len)
+{
+  outbuf_putc (out, '"');
+
+  size_t run = 0;
+  for (size_t i = 0; i < len; i++)
+    {
+      unsigned char c = (unsigned char)value[i];
+      if (c >= 0x80)
+        {
+          size_t n = utf8_sequence_length ((const unsigned char *)value + i,
+                                           len - i);
+          if (n != 0)
+            {
+              i += n - 1;
+              continue;
+            }
+
+          outbuf_write (out, value + run, i - run);
+          run = i + 1;
+          outbuf_write (out, "\\ufffd", 6);
+          continue;
+        }
+
+      if (c >= 0x20 && c != '"' && c != '\\')
+        continue;
+
+      outbuf_write (out, value + run, i - run);
+      run = i + 1;
+
+      switch (c)
+        {
+        case '"':
+          outbuf_write (out, "\\\"", 2);
+          break;
+        case '\\':
+          outbuf_write (out, "\\\\", 2);
+          break;
+        case '\n':
+          outbuf_write (out, "\\n", 2);
+          break;
+        case '\t':
+          outbuf_write (out, "\\t", 2);
+          break;
+        default:
+          {
+            char esc[6] = { '\\', 'u', '0', '0', hex_digits[c >> 4],
+                            hex_digits[c & 0xf] };
+            outbuf_write (out, esc, sizeof (esc));
+          }
+        }
+    }
+  outbuf_write (out, value + run, len - run);
+
+  outbuf_putc (out, '"');
+}
+
+static void
+write_key (JsonWriter *jw, const char *key)
+{
+  if (jw->fields++ > 0)
+    outbuf_putc (jw->out, ',');
+
+  write_string (jw->out, key, strlen (key));
+  outbuf_putc (jw->out, ':');
+}
+
+void
+json_record_begin (JsonWriter *jw, const char *kind)
+{
+  if (jw->records++ > 0 && !jw->ndjson)
+    json_array_separator (jw->out);
+
+  outbuf_putc (jw->out, '{');
+  jw->fields = 0;
+  json_field_str (jw, "record", kind);
+}
+
+void
+json_record_end (JsonWriter *jw)
+{
+  STAT_ADD (STAT_FORMAT_CALLS, 1);
+  outbuf_putc (jw->out, '}');
+  if (jw->ndjson)
+    outbuf_putc (jw->out, '\n');
+}
+
+void
+json_field_str (JsonWriter *jw, const char *key, const char *value)
+{
+  json_field_strn (jw, key, value, strlen (value));
+}
+
+void
+json_field_strn (JsonWriter *jw, const char *key, const char *value,
+                 size_t len)
+{
+  write_key (jw, key);
+  write_string (jw->out, value, len);
+}
+
+void
+json_field_u64 (JsonWriter *jw, const char *key, uint64_t value)
+{
+  write_key (jw, key);
+  write_u64 (jw->out, value);
+}
+
+void
+json_field_i64 (JsonWriter *jw, const char *key, int64_t value)
+{
+  write_key (jw, key);
+  if (value < 0)
+    {
+      outbuf_putc (jw->out, '-');
+      write_u64 (jw->out, -(uint64_t)value);
+    }
+  else
+    write_u64 (jw->out, (uint64_t)value);
+}
+
+void
+json_field_bool (JsonWriter *jw, const char *key, int value)
+{
+  write_key (jw, key);
+  if (value)
+    outbuf_write (jw->out, "true", 4);
+  else
+    outbuf_write (jw->out, "false", 5);
+}
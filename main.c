@@ -1,4 +1,7 @@
+#define _GNU_SOURCE
+
 #include <fcntl.h>
+#include <getopt.h>
 #include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -6,7 +9,70 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include "./include/deps.h"
+#include "./include/elf_cache.h"
 #include "./include/elf_controller.h"
+#include "./include/elf_image.h"
+#include "./include/scan.h"
+#include "./include/stats.h"
+#include "./include/symindex.h"
+#include "./include/symtab.h"
+#include "./include/threadpool.h"
+
+static const char *g_help_menu
+    = { "Usage: elfread [option(s)] elf-file(s)\n"
+        " Display information about the contents of ELF format files.\n"
+        " Without options the interactive menu is started.\n"
+        " Options are:\n"
+        "\n"
+        "-h --file-header               Display the ELF file header\n"
+        "-l --program-headers           Display the program headers\n"
+        "   --segments                  An alias for --program-headers\n"
+        "-S --section-headers           Display the sections' header\n"
+        "   --sections                  An alias for --section-headers\n"
+        "-e --headers                   Equivalent to: -h -l -S\n"
+        "-s --syms                      Display the symbol table\n"
+        "   --symbols                   An alias for --syms\n"
+        "   --dyn-syms                  Display the dynamic symbol table\n"
+        "   --sort-symbols=<address|size>\n"
+        "                               Order symbols by value or size\n"
+        "   --defined-only              List only defined symbols\n"
+        "   --sym-type=<type>           List only symbols of <type>, as\n"
+        "                               shown in the Type column\n"
+        "   --min-size=<bytes>          List only symbols of at least\n"
+        "                               <bytes> bytes\n"
+        "   --lookup=<name>             Report whether each file exports\n"
+        "                               <name> from its dynamic symbols\n"
+        "-r --relocs                    Display the relocations and counts\n"
+        "                               per type and target section\n"
+        "   --dyn-relocs                Display only the dynamic relocations\n"
+        "   --dynamic                   Display the dynamic section\n"
+        "   --string-dump[=<name>]      Display the strings of every string\n"
+        "                               section, or of section <name>\n"
+        "   --deps                      List the shared objects the loader\n"
+        "                               would map, in load order, like ldd\n"
+        "   --bindings                  Bind the symbols of the --deps\n"
+        "                               closure as the loader would and\n"
+        "                               report lookups, unresolved and\n"
+        "                               interposed symbols\n"
+        "   --sysroot=<dir>             Resolve --deps and --bindings under\n"
+        "                               <dir> instead of /\n"
+        "   --symbolize                 Map addresses read from stdin to\n"
+        "                               symbol+offset\n"
+        "-d --disassemble               Disassemble the executable sections\n"
+        "                               (text output only)\n"
+        "-R --recursive=<dir>           Display every ELF file below <dir>\n"
+        "-j --jobs=<number>             Number of threads for -R and -d\n"
+        "   --format=<text|json|ndjson> Output format of every display\n"
+        "                               option except -d, which only has\n"
+        "                               text output\n"
+        "   --cache-dir=<dir>           Keep parsed metadata in <dir> and\n"
+        "                               reuse it while a file is unchanged\n"
+        "   --mem-budget=<size>         Fail files whose parsed state needs\n"
+        "                               more than <size> bytes (K, M, G)\n"
+        "   --stats                     Report time per phase and work\n"
+        "                               counters on stderr when done\n"
+        "-H --help                      Display this information\n" };
 
 int
 app_runner (const char *const filename)
@@ -14,10 +80,323 @@ app_runner (const char *const filename)
 	return do_run_controller (filename);
 }
 
+static int
+batch_runner (int flags, int nfiles, char *const files[])
+{
+  return do_run_batch (nfiles, files, flags);
+}
+
+static int
+parse_sort (const char *name, int *flags)
+{
+  *flags &= ~(BATCH_SORT_ADDRESS | BATCH_SORT_SIZE);
+
+  if (strcmp (name, "address") == 0)
+    *flags |= BATCH_SORT_ADDRESS;
+  else if (strcmp (name, "size") == 0)
+    *flags |= BATCH_SORT_SIZE;
+  else
+    {
+      fprintf (stderr, "Unknown symbol order: %s\n", name);
+      return -1;
+    }
+
+  return 0;
+}
+
+static int
+parse_sym_type (const char *name, int *type)
+{
+  *type = symbol_type_from_name (name);
+  if (*type < 0)
+    {
+      fprintf (stderr, "Unknown symbol type: %s\n", name);
+      return -1;
+    }
+
+  return 0;
+}
+
+static int
+parse_min_size (const char *text, uint64_t *size)
+{
+  char *end;
+  unsigned long long value = strtoull (text, &end, 0);
+
+  if (end == text || *text == '-' || *end != '\0')
+    {
+      fprintf (stderr, "Invalid symbol size: %s\n", text);
+      return -1;
+    }
+
+  *size = value;
+  return 0;
+}
+
+static int
+parse_format (const char *name, int *flags)
+{
+  if (strcmp (name, "text") == 0)
+    *flags &= ~BATCH_FORMAT_MASK;
+  else if (strcmp (name, "json") == 0)
+    *flags = (*flags & ~BATCH_FORMAT_MASK) | BATCH_FORMAT_JSON;
+  else if (strcmp (name, "ndjson") == 0)
+    *flags = (*flags & ~BATCH_FORMAT_MASK) | BATCH_FORMAT_NDJSON;
+  else
+    {
+      fprintf (stderr, "Unknown output format: %s\n", name);
+      return -1;
+    }
+
+  return 0;
+}
+
+static int
+parse_size (const char *text, size_t *size)
+{
+  char *end;
+  unsigned long long value = strtoull (text, &end, 10);
+  int shift = 0;
+
+  if (*end == 'K' || *end == 'k')
+    shift = 10;
+  else if (*end == 'M' || *end == 'm')
+    shift = 20;
+  else if (*end == 'G' || *end == 'g')
+    shift = 30;
+  if (shift != 0)
+    end++;
+
+  if (end == text || *text == '-' || *end != '\0' || value == 0
+      || value > (SIZE_MAX >> shift))
+    {
+      fprintf (stderr, "Invalid memory budget: %s\n", text);
+      return -1;
+    }
+
+  *size = (size_t)value << shift;
+  return 0;
+}
+
 int
 main (int argc, char *argv[])
 {
-	char *filename = argc == 2 ? argv[1] : "testelf";
+  static struct option long_options[]
+      = { { "file-header", no_argument, 0, 'h' },
+          { "program-headers", no_argument, 0, 'l' },
+          { "segments", no_argument, 0, 'l' },
+          { "section-headers", no_argument, 0, 'S' },
+          { "sections", no_argument, 0, 'S' },
+          { "headers", no_argument, 0, 'e' },
+          { "syms", no_argument, 0, 's' },
+          { "symbols", no_argument, 0, 's' },
+          { "dyn-syms", no_argument, 0, 'D' },
+          { "sort-symbols", required_argument, 0, 'O' },
+          { "defined-only", no_argument, 0, 'U' },
+          { "sym-type", required_argument, 0, 'V' },
+          { "min-size", required_argument, 0, 'Z' },
+          { "relocs", no_argument, 0, 'r' },
+          { "dyn-relocs", no_argument, 0, 'W' },
+          { "dynamic", no_argument, 0, 'y' },
+          { "string-dump", optional_argument, 0, 'p' },
+          { "deps", no_argument, 0, 'N' },
+          { "bindings", no_argument, 0, 'B' },
+          { "sysroot", required_argument, 0, 'P' },
+          { "lookup", required_argument, 0, 'L' },
+          { "symbolize", no_argument, 0, 'Y' },
+          { "disassemble", no_argument, 0, 'd' },
+          { "recursive", required_argument, 0, 'R' },
+          { "jobs", required_argument, 0, 'j' },
+          { "format", required_argument, 0, 'F' },
+          { "cache-dir", required_argument, 0, 'C' },
+          { "mem-budget", required_argument, 0, 'M' },
+          { "stats", no_argument, 0, 'T' },
+          { "help", no_argument, 0, 'H' },
+          { 0, 0, 0, 0 } };
+  const char *scan_dir = NULL;
+  const char *sysroot = "/";
+  Resolver *resolver = NULL;
+  int sym_type = -1;
+  uint64_t min_size = 0;
+  int symbolize = 0;
+  int show_stats = 0;
+  int nthreads = pool_default_threads ();
+  int flags = 0;
+  int c;
+
+  while ((c = getopt_long (argc, argv, "hlSesrdR:j:H", long_options, NULL))
+         != -1)
+    {
+      switch (c)
+        {
+        case 'h':
+          flags |= BATCH_FILE_HEADER;
+          break;
+        case 'l':
+          flags |= BATCH_PROGRAM_HEADERS;
+          break;
+        case 'S':
+          flags |= BATCH_SECTION_HEADERS;
+          break;
+        case 'e':
+          flags |= BATCH_FILE_HEADER | BATCH_PROGRAM_HEADERS
+                   | BATCH_SECTION_HEADERS;
+          break;
+        case 's':
+          flags |= BATCH_SYMBOLS;
+          break;
+        case 'D':
+          flags |= BATCH_DYN_SYMBOLS;
+          break;
+        case 'r':
+          flags |= BATCH_RELOCS;
+          break;
+        case 'W':
+          flags |= BATCH_DYN_RELOCS;
+          break;
+        case 'y':
+          flags |= BATCH_DYNAMIC;
+          break;
+        case 'p':
+          if (optarg != NULL)
+            set_string_dump_section (optarg);
+          flags |= BATCH_STRINGS;
+          break;
+        case 'N':
+          flags |= BATCH_DEPS;
+          break;
+        case 'B':
+          flags |= BATCH_BINDINGS;
+          break;
+        case 'P':
+          sysroot = optarg;
+          break;
+        case 'O':
+          if (parse_sort (optarg, &flags) != 0)
+            return 1;
+          break;
+        case 'U':
+          flags |= BATCH_DEFINED_ONLY;
+          break;
+        case 'V':
+          if (parse_sym_type (optarg, &sym_type) != 0)
+            return 1;
+          flags |= BATCH_SYM_FILTER;
+          break;
+        case 'Z':
+          if (parse_min_size (optarg, &min_size) != 0)
+            return 1;
+          flags |= BATCH_SYM_FILTER;
+          break;
+        case 'L':
+          set_lookup_symbol (optarg);
+          flags |= BATCH_LOOKUP;
+          break;
+        case 'Y':
+          symbolize = 1;
+          break;
+        case 'd':
+          flags |= BATCH_DISASSEMBLE;
+          break;
+        case 'R':
+          scan_dir = optarg;
+          break;
+        case 'j':
+          nthreads = atoi (optarg);
+          if (nthreads < 1)
+            {
+              fprintf (stderr, "Invalid number of jobs: %s\n", optarg);
+              return 1;
+            }
+          break;
+        case 'F':
+          if (parse_format (optarg, &flags) != 0)
+            return 1;
+          break;
+        case 'C':
+          if (elf_cache_set_dir (optarg) != 0)
+            return 1;
+          break;
+        case 'M':
+          {
+            size_t budget;
+            if (parse_size (optarg, &budget) != 0)
+              return 1;
+            elf_image_set_memory_budget (budget);
+          }
+          break;
+        case 'T':
+          show_stats = 1;
+          break;
+        case 'H':
+          fputs (g_help_menu, stdout);
+          return 0;
+        default:
+          fputs (g_help_menu, stderr);
+          return 1;
+        }
+    }
+
+  if ((flags & BATCH_DISASSEMBLE) && (flags & BATCH_FORMAT_MASK))
+    {
+      fprintf (stderr, "Disassembly has no JSON output; use --format=text "
+                       "with -d.\n");
+      return 1;
+    }
+
+  set_symbol_filter (sym_type, min_size);
+
+  // files of a -R scan already run in parallel, one thread each
+  set_disasm_threads (scan_dir != NULL ? 1 : nthreads);
+
+  // one resolver for the whole run, so each library is read only once
+  if (flags & (BATCH_DEPS | BATCH_BINDINGS))
+    {
+      resolver = resolver_new (sysroot);
+      if (resolver == NULL)
+        return 1;
+      set_dependency_resolver (resolver);
+    }
+
+  int retval;
+  if (symbolize)
+    {
+      if (optind + 1 != argc)
+        {
+          fputs (g_help_menu, stderr);
+          return 1;
+        }
+      retval = do_run_symbolize (argv[optind], flags);
+    }
+  else if (scan_dir != NULL)
+    {
+      if ((flags & ~BATCH_MODIFIER_MASK) == 0)
+        flags |= BATCH_FILE_HEADER;
+      retval = do_run_scan (scan_dir, flags, nthreads);
+    }
+  else
+    {
+      if ((flags & BATCH_MODIFIER_MASK)
+          && (flags & ~BATCH_MODIFIER_MASK) == 0)
+        flags |= BATCH_FILE_HEADER | BATCH_PROGRAM_HEADERS
+                 | BATCH_SECTION_HEADERS;
+
+      if (flags != 0)
+        {
+          if (optind == argc)
+            {
+              fputs (g_help_menu, stderr);
+              return 1;
+            }
+          retval = batch_runner (flags, argc - optind, argv + optind);
+        }
+      else
+        retval = app_runner (optind < argc ? argv[optind] : "testelf");
+    }
+
+  if (show_stats)
+    stats_report (stderr);
 
-	return app_runner (filename);
+  resolver_free (resolver);
+  return retval;
 }
@@ -0,0 +1,41 @@
+#include <string.h>
+
+#include "./include/msgqueue.h"
+
+void
+msgqueue_init (MsgQueue *queue)
+{
+  memset (queue, 0, sizeof (MsgQueue));
+}
+
+// producer only; -1 when the queue is full
+int
+msgqueue_push (MsgQueue *queue, const Message *msg)
+{
+  size_t tail = __atomic_load_n (&queue->tail, __ATOMIC_RELAXED);
+  size_t head = __atomic_load_n (&queue->head, __ATOMIC_ACQUIRE);
+
+  if (tail - head == MSGQUEUE_SIZE)
+    return -1;
+
+  queue->slots[tail & (MSGQUEUE_SIZE - 1)] = *msg;
+  __atomic_store_n (&queue->tail, tail + 1, __ATOMIC_RELEASE);
+
+  return 0;
+}
+
+// consumer only; -1 when the queue is empty
+int
+msgqueue_pop (MsgQueue *queue, Message *msg)
+{
+  size_t head = __atomic_load_n (&queue->head, __ATOMIC_RELAXED);
+  size_t tail = __atomic_load_n (&queue->tail, __ATOMIC_ACQUIRE);
+
+  if (head == tail)
+    return -1;
+
+  *msg = queue->slots[head & (MSGQUEUE_SIZE - 1)];
+  __atomic_store_n (&queue->head, head + 1, __ATOMIC_RELEASE);
+
+  return 0;
+}
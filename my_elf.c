@@ -10,57 +10,54 @@
 
 #include "./include/fileio.h"
 #include "./include/my_elf.h"
+#include "./include/p_type_perfect.h"
+#include "./include/stats.h"
 
-char *
-get_p_type (unsigned int p_type)
+#define ELF_BITS 32
+#define ELF_DATA ELFDATA2LSB
+#define ELF_SUFFIX 32lsb
+#include "./include/my_elf_layout.h"
+
+#define ELF_BITS 32
+#define ELF_DATA ELFDATA2MSB
+#define ELF_SUFFIX 32msb
+#include "./include/my_elf_layout.h"
+
+#define ELF_BITS 64
+#define ELF_DATA ELFDATA2LSB
+#define ELF_SUFFIX 64lsb
+#include "./include/my_elf_layout.h"
+
+#define ELF_BITS 64
+#define ELF_DATA ELFDATA2MSB
+#define ELF_SUFFIX 64msb
+#include "./include/my_elf_layout.h"
+
+const ElfLayout *
+elf_layout_of (const Elf64_Ehdr *ehdr)
 {
-  switch (p_type)
-    {
-    case 0:
-      return "NULL";
-    case 1:
-      return "LOAD";
-    case 2:
-      return "DYNAMIC";
-    case 3:
-      return "INTERP";
-    case 4:
-      return "NOTE";
-    case 5:
-      return "SHLIB";
-    case 6:
-      return "PHDR";
-    case 7:
-      return "TLS";
-    case 8:
-      return "NUM";
-    case 0x60000000:
-      return "LOOS";
-    case 0x6474e550:
-      return "GNU_EH_FRAME";
-    case 0x6474e551:
-      return "GNU_STACK";
-    case 0x6474e552:
-      return "GNU_RELRO";
-    case 0x6474e553:
-      return "GNU_PROPERTY";
-    case 0x6474e554:
-      return "GNU_SFRAME";
-    case 0x6ffffffa:
-      return "LOSUNW";
-    case 0x6ffffffb:
-      return "SUNWSTACK";
-    case 0x6fffffff:
-      return "HIOS";
-    case 0x70000000:
-      return "LOPROC";
-    case 0x7fffffff:
-      return "HIPROC";
+  int msb = ehdr->e_ident[EI_DATA] == ELFDATA2MSB;
+
+  if (ehdr->e_ident[EI_DATA] != ELFDATA2LSB && !msb)
+    return NULL;
+
+  switch (ehdr->e_ident[EI_CLASS])
+    {
+    case ELFCLASS32:
+      return msb ? &layout_32msb : &layout_32lsb;
+    case ELFCLASS64:
+      return msb ? &layout_64msb : &layout_64lsb;
     default:
-      return "UNKNOWN";
+      return NULL;
     }
 }
 
+char *
+get_p_type (unsigned int p_type)
+{
+  return (char *)p_type_lookup (p_type);
+}
+
 char *
 get_p_flags (uint32_t p_flags, char *buf)
 {
@@ -104,13 +101,15 @@ validate_elf_header (const Elf64_Ehdr *ehdr)
       return -1;
     }
 
-  if (ehdr->e_ident[EI_CLASS] != ELFCLASS64)
+  if (ehdr->e_ident[EI_CLASS] != ELFCLASS32
+      && ehdr->e_ident[EI_CLASS] != ELFCLASS64)
     {
       fprintf (stderr, "Invalid ELF class.\n");
       return -1;
     }
 
-  if (ehdr->e_ident[EI_DATA] != ELFDATA2LSB)
+  if (ehdr->e_ident[EI_DATA] != ELFDATA2LSB
+      && ehdr->e_ident[EI_DATA] != ELFDATA2MSB)
     {
       fprintf (stderr, "Invalid ELF data encoding.\n");
       return -1;
@@ -134,28 +133,37 @@ get_elf_header (void *buffer, size_t size, Elf64_Ehdr *ehdr)
       return -1;
     }
 
-  if (size < sizeof (Elf64_Ehdr))
+  if (size < EI_NIDENT)
     {
       fprintf (stderr, "Buffer is too small to store ELF header.\n");
       return -1;
     }
 
-  if (memcpy (ehdr, buffer, sizeof (Elf64_Ehdr)) == NULL)
+  memset (ehdr, 0, sizeof (Elf64_Ehdr));
+  memcpy (ehdr->e_ident, buffer, EI_NIDENT);
+
+  if (validate_elf_header (ehdr) != 0)
     {
-      fprintf (stderr, "Failed to copy ELF header.\n");
       return -1;
     }
 
-  if (validate_elf_header (ehdr) != 0)
+  const ElfLayout *layout = elf_layout_of (ehdr);
+  if (size < layout->ehdr_size)
     {
+      fprintf (stderr, "Buffer is too small to store ELF header.\n");
       return -1;
     }
 
+  layout->ehdr (buffer, ehdr);
+  STAT_ADD (STAT_ENTRIES_DECODED, 1);
+
   return 0;
 }
 
 int
-get_elf_phdr (void *buffer, off_t offset, Elf64_Ehdr *ehdr, Elf64_Phdr *phdr)
+get_elf_table_view (const void *buffer, size_t size, Elf64_Off offset,
+                    size_t count, size_t stride, size_t entsize, size_t align,
+                    ElfTableView *view)
 {
   if (buffer == NULL)
     {
@@ -163,55 +171,159 @@ get_elf_phdr (void *buffer, off_t offset, Elf64_Ehdr *ehdr, Elf64_Phdr *phdr)
       return -1;
     }
 
-  if (ehdr == NULL)
+  if (view == NULL)
     {
-      fprintf (stderr, "ELF header is NULL.\n");
+      fprintf (stderr, "Table view is NULL.\n");
       return -1;
     }
 
-  if (phdr == NULL)
+  view->base = NULL;
+  view->count = 0;
+  view->stride = stride;
+  view->aligned = 0;
+  view->decode = NULL;
+
+  if (count == 0)
+    return 0;
+
+  if (stride < entsize)
     {
-      fprintf (stderr, "Program header is NULL.\n");
+      fprintf (stderr, "Table entry size is too small.\n");
       return -1;
     }
 
-  if (memcpy (phdr, (char *)buffer + ehdr->e_phoff + offset, ehdr->e_phentsize)
-      == NULL)
+  if (offset > size || count > (size - offset) / stride)
     {
-      fprintf (stderr, "Failed to copy program headers.\n");
+      fprintf (stderr, "Table extends past the end of the file.\n");
       return -1;
     }
 
+  view->base = (const char *)buffer + offset;
+  view->count = count;
+  view->aligned = ((uintptr_t)view->base % align) == 0 && stride % align == 0;
+  STAT_ADD (STAT_PAGES_TOUCHED,
+            (offset + count * stride - 1) / STAT_PAGE_SIZE
+                - offset / STAT_PAGE_SIZE + 1);
+
   return 0;
 }
 
-int
-get_elf_shdr (void *buffer, off_t offset, Elf64_Ehdr *ehdr, Elf64_Shdr *shdr)
+// points view at a table of ehdr's layout, decoded by entry when that
+// layout is not the host's
+static int
+get_layout_view (const void *buffer, size_t size, const Elf64_Ehdr *ehdr,
+                 Elf64_Off offset, size_t count, size_t stride, int shdrs,
+                 ElfTableView *view)
 {
-  if (buffer == NULL)
+  const ElfLayout *layout = elf_layout_of (ehdr);
+  if (layout == NULL)
     {
-      fprintf (stderr, "Buffer is NULL.\n");
+      fprintf (stderr, "Unsupported ELF class or data encoding.\n");
       return -1;
     }
 
+  size_t entsize = shdrs ? layout->shdr_size : layout->phdr_size;
+  size_t align = shdrs ? __alignof__ (Elf64_Shdr) : __alignof__ (Elf64_Phdr);
+  if (get_elf_table_view (buffer, size, offset, count, stride, entsize, align,
+                          view)
+      != 0)
+    return -1;
+
+  view->decode = shdrs ? layout->shdr : layout->phdr;
+  if (view->decode != NULL)
+    view->aligned = 0;
+
+  return 0;
+}
+
+int
+get_elf_counts (const void *buffer, size_t size, const Elf64_Ehdr *ehdr,
+                ElfCounts *counts)
+{
+  counts->phnum = ehdr->e_phnum;
+  counts->shnum = ehdr->e_shnum;
+  counts->shstrndx = ehdr->e_shstrndx;
+
+  if (ehdr->e_shoff == 0
+      || (ehdr->e_shnum != 0 && ehdr->e_shstrndx != SHN_XINDEX
+          && ehdr->e_phnum != PN_XNUM))
+    return 0;
+
+  ElfTableView first;
+  if (get_layout_view (buffer, size, ehdr, ehdr->e_shoff, 1,
+                       ehdr->e_shentsize, 1, &first)
+      != 0)
+    return -1;
+
+  Elf64_Shdr scratch;
+  const Elf64_Shdr *sh0 = elf_shdr_at (&first, 0, &scratch);
+
+  if (ehdr->e_shnum == 0)
+    counts->shnum = sh0->sh_size;
+  if (ehdr->e_shstrndx == SHN_XINDEX)
+    counts->shstrndx = sh0->sh_link;
+  if (ehdr->e_phnum == PN_XNUM)
+    counts->phnum = sh0->sh_info;
+
+  return 0;
+}
+
+int
+get_elf_phdr_view (const void *buffer, size_t size, const Elf64_Ehdr *ehdr,
+                   ElfTableView *view)
+{
   if (ehdr == NULL)
     {
       fprintf (stderr, "ELF header is NULL.\n");
       return -1;
     }
 
-  if (shdr == NULL)
+  ElfCounts counts;
+  if (get_elf_counts (buffer, size, ehdr, &counts) != 0)
+    return -1;
+
+  return get_layout_view (buffer, size, ehdr, ehdr->e_phoff, counts.phnum,
+                          ehdr->e_phentsize, 0, view);
+}
+
+int
+get_elf_shdr_view (const void *buffer, size_t size, const Elf64_Ehdr *ehdr,
+                   ElfTableView *view)
+{
+  if (ehdr == NULL)
     {
-      fprintf (stderr, "Section header is NULL.\n");
+      fprintf (stderr, "ELF header is NULL.\n");
       return -1;
     }
 
-  if (memcpy (shdr, (char *)buffer + ehdr->e_shoff + offset, ehdr->e_shentsize * ehdr->e_shnum)
-      == NULL)
+  ElfCounts counts;
+  if (get_elf_counts (buffer, size, ehdr, &counts) != 0)
+    return -1;
+
+  return get_layout_view (buffer, size, ehdr, ehdr->e_shoff, counts.shnum,
+                          ehdr->e_shentsize, 1, view);
+}
+
+const void *
+elf_view_entry (const ElfTableView *view, size_t index, void *scratch,
+                size_t entsize)
+{
+  if (view == NULL || index >= view->count)
+    return NULL;
+
+  const char *entry = view->base + index * view->stride;
+  if (view->aligned)
+    return entry;
+
+  if (scratch == NULL)
+    return NULL;
+
+  if (view->decode != NULL)
     {
-      fprintf (stderr, "Failed to copy section headers.\n");
-      return -1;
+      view->decode (entry, scratch);
+      STAT_ADD (STAT_ENTRIES_DECODED, 1);
     }
-
-  return 0;
+  else
+    memcpy (scratch, entry, entsize);
+  return scratch;
 }
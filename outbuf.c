@@ -0,0 +1,162 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "./include/outbuf.h"
+#include "./include/stats.h"
+
+int
+outbuf_init (OutBuf *ob, int fd, size_t cap)
+{
+  if (ob == NULL)
+    {
+      fprintf (stderr, "Output buffer is NULL.\n");
+      return -1;
+    }
+
+  ob->data = malloc (cap);
+  if (ob->data == NULL)
+    {
+      fprintf (stderr, "Failed to allocate memory.\n");
+      return -1;
+    }
+
+  ob->len = 0;
+  ob->cap = cap;
+  ob->fd = fd;
+
+  return 0;
+}
+
+void
+outbuf_free (OutBuf *ob)
+{
+  if (ob == NULL)
+    return;
+
+  free (ob->data);
+  ob->data = NULL;
+  ob->len = 0;
+  ob->cap = 0;
+}
+
+int
+outbuf_flush (OutBuf *ob)
+{
+  if (ob->fd == -1)
+    return 0;
+
+  STAT_SCOPE (STAT_PHASE_WRITE);
+  size_t done = 0;
+  while (done < ob->len)
+    {
+      ssize_t n = write (ob->fd, ob->data + done, ob->len - done);
+      if (n == -1)
+        {
+          if (errno == EINTR)
+            continue;
+          fprintf (stderr, "Failed to write output.\n");
+          return -1;
+        }
+      done += (size_t)n;
+    }
+  STAT_ADD (STAT_BYTES_EMITTED, done);
+  ob->len = 0;
+
+  return 0;
+}
+
+// make room for LEN more bytes, flushing first when backed by a file
+int
+outbuf_reserve (OutBuf *ob, size_t len)
+{
+  if (ob->cap - ob->len >= len)
+    return 0;
+
+  if (ob->fd != -1 && outbuf_flush (ob) != 0)
+    return -1;
+
+  if (ob->cap - ob->len >= len)
+    return 0;
+
+  size_t cap = ob->cap ? ob->cap : OUTBUF_DEFAULT_SIZE;
+  while (cap - ob->len < len)
+    cap *= 2;
+
+  char *data = realloc (ob->data, cap);
+  if (data == NULL)
+    {
+      fprintf (stderr, "Failed to allocate memory.\n");
+      return -1;
+    }
+  ob->data = data;
+  ob->cap = cap;
+
+  return 0;
+}
+
+int
+outbuf_write (OutBuf *ob, const void *data, size_t len)
+{
+  if (outbuf_reserve (ob, len) != 0)
+    return -1;
+
+  memcpy (ob->data + ob->len, data, len);
+  ob->len += len;
+
+  return 0;
+}
+
+int
+outbuf_puts (OutBuf *ob, const char *str)
+{
+  return outbuf_write (ob, str, strlen (str));
+}
+
+int
+outbuf_putc (OutBuf *ob, char c)
+{
+  if (ob->len == ob->cap && outbuf_reserve (ob, 1) != 0)
+    return -1;
+
+  ob->data[ob->len++] = c;
+  return 0;
+}
+
+int
+outbuf_vprintf (OutBuf *ob, const char *format, va_list args)
+{
+  va_list copy;
+
+  va_copy (copy, args);
+  int n = vsnprintf (ob->data + ob->len, ob->cap - ob->len, format, copy);
+  va_end (copy);
+
+  if (n < 0)
+    return -1;
+
+  if ((size_t)n >= ob->cap - ob->len)
+    {
+      if (outbuf_reserve (ob, (size_t)n + 1) != 0)
+        return -1;
+      vsnprintf (ob->data + ob->len, ob->cap - ob->len, format, args);
+    }
+  ob->len += (size_t)n;
+
+  return 0;
+}
+
+int
+outbuf_printf (OutBuf *ob, const char *format, ...)
+{
+  va_list args;
+
+  va_start (args, format);
+  int ret = outbuf_vprintf (ob, format, args);
+  va_end (args);
+
+  return ret;
+}
@@ -0,0 +1,726 @@
+#ifdef __APPLE__
+#include <libelf/libelf.h>
+#elif __linux__
+#include <libelf.h>
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./include/elf_image.h"
+#include "./include/fileio.h"
+#include "./include/my_elf.h"
+#include "./include/reloc.h"
+#include "./include/stats.h"
+
+static const char *r_x86_64_id[] = {
+#include "./include/r_x86_64_strings.h"
+};
+static const char *r_386_id[] = {
+#include "./include/r_386_strings.h"
+};
+
+// APS2 group flags
+#define APS2_GROUPED_BY_INFO 1
+#define APS2_GROUPED_BY_OFFSET_DELTA 2
+#define APS2_GROUPED_BY_ADDEND 4
+#define APS2_GROUP_HAS_ADDEND 8
+
+// an allocated section, for placing entries by the address they patch
+typedef struct
+{
+  Elf64_Addr start;
+  Elf64_Addr end;
+  size_t index;
+} SectionRange;
+
+static int
+load_table (RelocTable *table, const ElfImage *image, size_t section,
+            const Elf64_Shdr *sh)
+{
+  const FileContents *file = image->file;
+  const ElfLayout *layout = image->layout;
+  int rela = sh->sh_type == SHT_RELA;
+  size_t entsize = rela ? layout->rela_size : layout->rel_size;
+  size_t stride = sh->sh_entsize ? sh->sh_entsize : entsize;
+
+  ElfTableView view;
+  if (get_elf_table_view (file->buffer, file->length, sh->sh_offset,
+                          sh->sh_size / stride, stride, entsize, 1, &view)
+      != 0)
+    return -1;
+
+  size_t n = view.count;
+  size_t wide = rela ? 2 * sizeof (uint64_t) : sizeof (uint64_t);
+  char *block = arena_alloc (image->arena,
+                             n * (wide + 2 * sizeof (Elf64_Word)));
+  if (block == NULL)
+    return -1;
+
+  memset (table, 0, sizeof (RelocTable));
+  table->section = section;
+  table->symtab = sh->sh_link;
+  table->target = sh->sh_info < image->shdrs.count ? sh->sh_info : 0;
+  table->rela = rela;
+  table->dynamic = (sh->sh_flags & SHF_ALLOC) != 0;
+  table->count = n;
+
+  // the 8-byte columns first so every column stays aligned
+  table->offset = (Elf64_Addr *)block;
+  block += n * sizeof (Elf64_Addr);
+  if (rela)
+    {
+      table->addend = (Elf64_Sxword *)block;
+      block += n * sizeof (Elf64_Sxword);
+    }
+  table->sym = (Elf64_Word *)block;
+  block += n * sizeof (Elf64_Word);
+  table->type = (Elf64_Word *)block;
+
+  ElfRelColumns columns = { table->offset, table->sym, table->type,
+                            table->addend };
+  layout->rels (view.base, view.stride, n, rela, &columns);
+  STAT_ADD (STAT_ENTRIES_DECODED, n);
+
+  return 0;
+}
+
+static int
+is_packed_type (Elf64_Word type)
+{
+  return type == SHT_RELR || type == SHT_ANDROID_RELR
+         || type == SHT_ANDROID_REL || type == SHT_ANDROID_RELA;
+}
+
+// only the bounds and the APS2 magic are checked here; the stream itself
+// is validated as it is iterated
+static int
+load_packed (PackedTable *table, const ElfImage *image, size_t section,
+             const Elf64_Shdr *sh)
+{
+  const FileContents *file = image->file;
+
+  if (sh->sh_offset > file->length
+      || sh->sh_size > file->length - sh->sh_offset)
+    return -1;
+
+  memset (table, 0, sizeof (PackedTable));
+  table->section = section;
+  table->symtab = sh->sh_link;
+  table->dynamic = (sh->sh_flags & SHF_ALLOC) != 0;
+  table->data = (const unsigned char *)file->buffer + sh->sh_offset;
+  table->size = sh->sh_size;
+
+  if (sh->sh_type == SHT_RELR || sh->sh_type == SHT_ANDROID_RELR)
+    {
+      table->kind = PACKED_RELR;
+      return 0;
+    }
+
+  if (table->size < 4 || memcmp (table->data, "APS2", 4) != 0)
+    return -1;
+  table->kind = PACKED_APS2;
+  table->rela = sh->sh_type == SHT_ANDROID_RELA;
+
+  return 0;
+}
+
+// Decoded on first use and kept with the image; tables that do not fit
+// in the file are left out.  Packed tables are only located here.
+RelocSet *
+elf_image_relocs (ElfImage *image)
+{
+  if (image->relocs != NULL)
+    return image->relocs;
+
+  STAT_SCOPE (STAT_PHASE_PARSE);
+  size_t ntables = 0;
+  size_t npacked = 0;
+  for (size_t i = 0; i < image->shdrs.count; i++)
+    {
+      Elf64_Shdr scratch;
+      const Elf64_Shdr *sh = elf_image_shdr (image, i, &scratch);
+      if (sh->sh_type == SHT_REL || sh->sh_type == SHT_RELA)
+        ntables++;
+      else if (is_packed_type (sh->sh_type))
+        npacked++;
+    }
+
+  RelocSet *set = arena_alloc (image->arena, sizeof (RelocSet));
+  if (set == NULL)
+    return NULL;
+  set->ntables = 0;
+  set->npacked = 0;
+  set->tables = arena_alloc (image->arena, ntables * sizeof (RelocTable));
+  set->packed = arena_alloc (image->arena, npacked * sizeof (PackedTable));
+  if (set->tables == NULL || set->packed == NULL)
+    return NULL;
+
+  for (size_t i = 0; i < image->shdrs.count; i++)
+    {
+      Elf64_Shdr scratch;
+      const Elf64_Shdr *sh = elf_image_shdr (image, i, &scratch);
+      if ((sh->sh_type == SHT_REL || sh->sh_type == SHT_RELA)
+          && set->ntables < ntables)
+        {
+          if (load_table (&set->tables[set->ntables], image, i, sh) == 0)
+            set->ntables++;
+        }
+      else if (is_packed_type (sh->sh_type) && set->npacked < npacked)
+        {
+          if (load_packed (&set->packed[set->npacked], image, i, sh) == 0)
+            set->npacked++;
+        }
+    }
+
+  image->relocs = set;
+  return set;
+}
+
+// the type RELR entries stand for
+static Elf64_Word
+relative_type (const ElfImage *image)
+{
+  switch (image->ehdr.e_machine)
+    {
+    case EM_X86_64:
+      return R_X86_64_RELATIVE;
+    case EM_386:
+      return R_386_RELATIVE;
+    case EM_AARCH64:
+      return R_AARCH64_RELATIVE;
+    case EM_ARM:
+      return R_ARM_RELATIVE;
+    case EM_RISCV:
+      return R_RISCV_RELATIVE;
+    default:
+      return 0;
+    }
+}
+
+static int
+read_sleb128 (PackedIter *it, int64_t *value)
+{
+  uint64_t result = 0;
+  unsigned int shift = 0;
+  unsigned char byte;
+
+  do
+    {
+      if (it->p == it->end || shift >= 64)
+        return -1;
+      byte = *it->p++;
+      result |= (uint64_t)(byte & 0x7f) << shift;
+      shift += 7;
+    }
+  while (byte & 0x80);
+
+  if (shift < 64 && (byte & 0x40))
+    result |= ~(uint64_t)0 << shift;
+
+  *value = (int64_t)result;
+  return 0;
+}
+
+void
+packed_iter_init (PackedIter *it, const ElfImage *image,
+                  const PackedTable *table)
+{
+  memset (it, 0, sizeof (PackedIter));
+  it->table = table;
+  it->p = table->data;
+  it->end = table->data + table->size;
+  it->read_addr = image->layout->read_addr;
+  it->word_bytes = image->layout->addr_bits / 8;
+  it->wide_info = image->layout->addr_bits == 64;
+
+  if (table->kind == PACKED_RELR)
+    {
+      it->entry.type = relative_type (image);
+      return;
+    }
+
+  // past the magic: the count, then the offset deltas start from
+  int64_t count;
+  int64_t offset;
+  it->p += 4;
+  // groups sharing every field take no bytes per entry, so the count is
+  // all that bounds the work; no file relocates more words than it has
+  if (read_sleb128 (it, &count) != 0 || read_sleb128 (it, &offset) != 0
+      || count < 0 || (uint64_t)count > image->file->length)
+    {
+      it->malformed = 1;
+      return;
+    }
+  it->remaining = (uint64_t)count;
+  it->entry.offset = (Elf64_Addr)offset;
+}
+
+// Each even word is an address to relocate; each odd word is a bitmap of
+// the words after the last address, one bit per word from bit 1 up.
+static int
+relr_next (PackedIter *it, RelocEntry *entry)
+{
+  unsigned int bits = it->word_bytes * 8;
+
+  for (;;)
+    {
+      while (it->bit != 0 && it->bit < bits)
+        {
+          unsigned int bit = it->bit++;
+          if (it->bitmap >> bit & 1)
+            {
+              it->entry.offset = it->base + (bit - 1) * it->word_bytes;
+              *entry = it->entry;
+              return 1;
+            }
+        }
+      if (it->bit != 0)
+        {
+          it->base += (Elf64_Addr)(bits - 1) * it->word_bytes;
+          it->bit = 0;
+        }
+
+      if ((size_t)(it->end - it->p) < it->word_bytes)
+        return 0;
+      uint64_t word = it->read_addr (it->p);
+      it->p += it->word_bytes;
+
+      if (word & 1)
+        {
+          it->bitmap = word;
+          it->bit = 1;
+          continue;
+        }
+
+      it->entry.offset = word;
+      it->base = word + it->word_bytes;
+      *entry = it->entry;
+      return 1;
+    }
+}
+
+static int
+aps2_read_group (PackedIter *it)
+{
+  int64_t size;
+  int64_t flags;
+  int64_t value;
+
+  if (read_sleb128 (it, &size) != 0 || read_sleb128 (it, &flags) != 0
+      || size <= 0 || (uint64_t)size > it->remaining)
+    return -1;
+  it->group_left = (uint64_t)size;
+  it->group_flags = (uint64_t)flags;
+
+  if (flags & APS2_GROUPED_BY_OFFSET_DELTA)
+    {
+      if (read_sleb128 (it, &value) != 0)
+        return -1;
+      it->group_delta = value;
+    }
+
+  if (flags & APS2_GROUPED_BY_INFO)
+    {
+      if (read_sleb128 (it, &value) != 0)
+        return -1;
+      it->entry.sym = it->wide_info ? ELF64_R_SYM (value)
+                                    : ELF32_R_SYM ((uint32_t)value);
+      it->entry.type = it->wide_info ? ELF64_R_TYPE (value)
+                                     : ELF32_R_TYPE ((uint32_t)value);
+    }
+
+  if (!(flags & APS2_GROUP_HAS_ADDEND))
+    it->entry.addend = 0;
+  else if (flags & APS2_GROUPED_BY_ADDEND)
+    {
+      if (read_sleb128 (it, &value) != 0)
+        return -1;
+      it->entry.addend += value;
+    }
+
+  return 0;
+}
+
+// Android's stream: the count and first offset, then groups of entries
+// that share whichever of offset delta, info and addend their flags say,
+// every other field coded per entry as a delta or value.
+static int
+aps2_next (PackedIter *it, RelocEntry *entry)
+{
+  int64_t value;
+
+  if (it->remaining == 0)
+    return 0;
+  if (it->group_left == 0 && aps2_read_group (it) != 0)
+    return -1;
+
+  if (it->group_flags & APS2_GROUPED_BY_OFFSET_DELTA)
+    it->entry.offset += it->group_delta;
+  else
+    {
+      if (read_sleb128 (it, &value) != 0)
+        return -1;
+      it->entry.offset += value;
+    }
+
+  if (!(it->group_flags & APS2_GROUPED_BY_INFO))
+    {
+      if (read_sleb128 (it, &value) != 0)
+        return -1;
+      it->entry.sym = it->wide_info ? ELF64_R_SYM (value)
+                                    : ELF32_R_SYM ((uint32_t)value);
+      it->entry.type = it->wide_info ? ELF64_R_TYPE (value)
+                                     : ELF32_R_TYPE ((uint32_t)value);
+    }
+
+  if ((it->group_flags & APS2_GROUP_HAS_ADDEND)
+      && !(it->group_flags & APS2_GROUPED_BY_ADDEND))
+    {
+      if (read_sleb128 (it, &value) != 0)
+        return -1;
+      it->entry.addend += value;
+    }
+
+  it->group_left--;
+  it->remaining--;
+  *entry = it->entry;
+  return 1;
+}
+
+// 1 with the next entry, 0 at the end, -1 when the stream is malformed
+int
+packed_iter_next (PackedIter *it, RelocEntry *entry)
+{
+  if (it->malformed)
+    return -1;
+  if (it->table->kind == PACKED_RELR)
+    return relr_next (it, entry);
+
+  int ret = aps2_next (it, entry);
+  if (ret < 0)
+    it->malformed = 1;
+  return ret;
+}
+
+// The whole table as plain columns, expanded on first request and kept
+// in the image's arena for the views that need random access.  A
+// malformed stream is cut at the fault.
+const RelocTable *
+packed_reloc_table (ElfImage *image, PackedTable *table)
+{
+  if (table->expanded != NULL)
+    return table->expanded;
+
+  PackedIter it;
+  RelocEntry entry;
+  size_t n = 0;
+  int ret;
+
+  packed_iter_init (&it, image, table);
+  while ((ret = packed_iter_next (&it, &entry)) > 0)
+    n++;
+  if (ret < 0)
+    fprintf (stderr, "Malformed packed relocations in section %zu.\n",
+             table->section);
+
+  int rela = table->kind == PACKED_APS2 && table->rela;
+  size_t wide = rela ? 2 * sizeof (uint64_t) : sizeof (uint64_t);
+  RelocTable *out = arena_alloc (image->arena, sizeof (RelocTable));
+  char *block = arena_alloc (image->arena,
+                             n * (wide + 2 * sizeof (Elf64_Word)));
+  if (out == NULL || block == NULL)
+    return NULL;
+
+  memset (out, 0, sizeof (RelocTable));
+  out->section = table->section;
+  out->symtab = table->symtab;
+  out->rela = rela;
+  out->dynamic = table->dynamic;
+  out->count = n;
+  out->offset = (Elf64_Addr *)block;
+  block += n * sizeof (Elf64_Addr);
+  if (rela)
+    {
+      out->addend = (Elf64_Sxword *)block;
+      block += n * sizeof (Elf64_Sxword);
+    }
+  out->sym = (Elf64_Word *)block;
+  block += n * sizeof (Elf64_Word);
+  out->type = (Elf64_Word *)block;
+
+  packed_iter_init (&it, image, table);
+  for (size_t i = 0; i < n && packed_iter_next (&it, &entry) > 0; i++)
+    {
+      out->offset[i] = entry.offset;
+      out->sym[i] = entry.sym;
+      out->type[i] = entry.type;
+      if (rela)
+        out->addend[i] = entry.addend;
+    }
+
+  table->expanded = out;
+  return out;
+}
+
+// what one entry of a packed table would take as a plain table: RELR
+// stands in for the RELA of 64-bit files and the REL of 32-bit ones
+static size_t
+unpacked_entry_size (const ElfImage *image, const PackedTable *table)
+{
+  const ElfLayout *layout = image->layout;
+
+  if (table->kind == PACKED_RELR)
+    return layout->addr_bits == 64 ? layout->rela_size : layout->rel_size;
+  return table->rela ? layout->rela_size : layout->rel_size;
+}
+
+static int
+compare_ranges (const void *a, const void *b)
+{
+  const SectionRange *x = a;
+  const SectionRange *y = b;
+
+  return x->start < y->start ? -1 : x->start > y->start;
+}
+
+static size_t
+collect_ranges (const ElfImage *image, SectionRange *ranges)
+{
+  size_t n = 0;
+
+  for (size_t i = 1; i < image->shdrs.count; i++)
+    {
+      Elf64_Shdr scratch;
+      const Elf64_Shdr *sh = elf_image_shdr (image, i, &scratch);
+      if (!(sh->sh_flags & SHF_ALLOC) || sh->sh_size == 0
+          || sh->sh_addr + sh->sh_size < sh->sh_addr)
+        continue;
+      ranges[n].start = sh->sh_addr;
+      ranges[n].end = sh->sh_addr + sh->sh_size;
+      ranges[n].index = i;
+      n++;
+    }
+
+  qsort (ranges, n, sizeof (SectionRange), compare_ranges);
+  return n;
+}
+
+// last range starting at or before addr, if it covers addr
+static const SectionRange *
+find_range (const SectionRange *ranges, size_t n, Elf64_Addr addr)
+{
+  size_t lo = 0;
+  size_t hi = n;
+
+  while (lo < hi)
+    {
+      size_t mid = lo + (hi - lo) / 2;
+      if (ranges[mid].start <= addr)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  if (lo == 0 || addr >= ranges[lo - 1].end)
+    return NULL;
+  return &ranges[lo - 1];
+}
+
+// Dynamic tables patch their targets roughly in address order, so most
+// entries land in the same section as the one before and skip the search.
+static void
+count_address (Elf64_Addr addr, const SectionRange *ranges, size_t nranges,
+               const SectionRange **last, RelocSummary *summary)
+{
+  if (*last == NULL || addr < (*last)->start || addr >= (*last)->end)
+    *last = find_range (ranges, nranges, addr);
+  summary->section_counts[*last != NULL ? (*last)->index
+                                        : summary->nsections]++;
+}
+
+static void
+count_type (Elf64_Word type, RelocSummary *summary)
+{
+  if (type >= summary->ntypes)
+    type = summary->ntypes - 1;
+  summary->type_counts[type]++;
+}
+
+// packed entries are counted as they are expanded, never stored
+static void
+count_packed (const ElfImage *image, const PackedTable *table,
+              const SectionRange *ranges, size_t nranges,
+              RelocSummary *summary)
+{
+  const SectionRange *last = NULL;
+  PackedIter it;
+  RelocEntry entry;
+  uint64_t n = 0;
+
+  packed_iter_init (&it, image, table);
+  while (packed_iter_next (&it, &entry) > 0)
+    {
+      count_type (entry.type, summary);
+      count_address (entry.offset, ranges, nranges, &last, summary);
+      n++;
+    }
+
+  summary->entries += n;
+  summary->tables++;
+  summary->packed_tables++;
+  summary->packed_entries += n;
+  summary->packed_bytes += table->size;
+  summary->unpacked_bytes += n * unpacked_entry_size (image, table);
+}
+
+int
+reloc_summarize (const ElfImage *image, const RelocSet *set,
+                 int dynamic_only, RelocSummary *summary)
+{
+  memset (summary, 0, sizeof (RelocSummary));
+
+  // one bucket per type up to the largest in use
+  Elf64_Word max_type = 0;
+  for (size_t t = 0; t < set->ntables; t++)
+    {
+      const RelocTable *table = &set->tables[t];
+      if (dynamic_only && !table->dynamic)
+        continue;
+      for (size_t i = 0; i < table->count; i++)
+        if (table->type[i] > max_type)
+          max_type = table->type[i];
+    }
+  // APS2 types are only known once expanded
+  for (size_t t = 0; t < set->npacked; t++)
+    {
+      const PackedTable *table = &set->packed[t];
+      if (dynamic_only && !table->dynamic)
+        continue;
+      if (table->kind == PACKED_APS2)
+        max_type = RELOC_TYPE_MAX;
+      else if (relative_type (image) > max_type)
+        max_type = relative_type (image);
+    }
+  if (max_type > RELOC_TYPE_MAX)
+    max_type = RELOC_TYPE_MAX;
+
+  summary->ntypes = (size_t)max_type + 1;
+  summary->nsections = image->shdrs.count;
+  summary->type_counts = calloc (summary->ntypes, sizeof (uint64_t));
+  summary->section_counts = calloc (summary->nsections + 1,
+                                    sizeof (uint64_t));
+  SectionRange *ranges = malloc ((summary->nsections + 1)
+                                 * sizeof (SectionRange));
+  if (summary->type_counts == NULL || summary->section_counts == NULL
+      || ranges == NULL)
+    {
+      fprintf (stderr, "Failed to allocate memory.\n");
+      free (ranges);
+      reloc_summary_free (summary);
+      return -1;
+    }
+
+  size_t nranges = collect_ranges (image, ranges);
+
+  for (size_t t = 0; t < set->ntables; t++)
+    {
+      const RelocTable *table = &set->tables[t];
+      if (dynamic_only && !table->dynamic)
+        continue;
+
+      for (size_t i = 0; i < table->count; i++)
+        count_type (table->type[i], summary);
+
+      if (table->target != 0)
+        summary->section_counts[table->target] += table->count;
+      else
+        {
+          const SectionRange *last = NULL;
+          for (size_t i = 0; i < table->count; i++)
+            count_address (table->offset[i], ranges, nranges, &last,
+                           summary);
+        }
+
+      summary->entries += table->count;
+      summary->tables++;
+    }
+
+  for (size_t t = 0; t < set->npacked; t++)
+    if (!dynamic_only || set->packed[t].dynamic)
+      count_packed (image, &set->packed[t], ranges, nranges, summary);
+
+  free (ranges);
+  return 0;
+}
+
+void
+reloc_summary_free (RelocSummary *summary)
+{
+  free (summary->type_counts);
+  free (summary->section_counts);
+  memset (summary, 0, sizeof (RelocSummary));
+}
+
+static const char *
+aarch64_type_name (Elf64_Word type)
+{
+  switch (type)
+    {
+    case R_AARCH64_NONE:
+      return "R_AARCH64_NONE";
+    case R_AARCH64_ABS64:
+      return "R_AARCH64_ABS64";
+    case R_AARCH64_COPY:
+      return "R_AARCH64_COPY";
+    case R_AARCH64_GLOB_DAT:
+      return "R_AARCH64_GLOB_DAT";
+    case R_AARCH64_JUMP_SLOT:
+      return "R_AARCH64_JUMP_SLOT";
+    case R_AARCH64_RELATIVE:
+      return "R_AARCH64_RELATIVE";
+    case R_AARCH64_TLS_DTPMOD:
+      return "R_AARCH64_TLS_DTPMOD";
+    case R_AARCH64_TLS_DTPREL:
+      return "R_AARCH64_TLS_DTPREL";
+    case R_AARCH64_TLS_TPREL:
+      return "R_AARCH64_TLS_TPREL";
+    case R_AARCH64_TLSDESC:
+      return "R_AARCH64_TLSDESC";
+    case R_AARCH64_IRELATIVE:
+      return "R_AARCH64_IRELATIVE";
+    default:
+      return NULL;
+    }
+}
+
+// names for the machines we have tables for, the number otherwise
+const char *
+reloc_type_name (const ElfImage *image, Elf64_Word type, char *buf,
+                 size_t size)
+{
+  const char *name = NULL;
+
+  switch (image->ehdr.e_machine)
+    {
+    case EM_X86_64:
+      if (type < sizeof (r_x86_64_id) / sizeof (r_x86_64_id[0]))
+        name = r_x86_64_id[type];
+      break;
+    case EM_386:
+      if (type < sizeof (r_386_id) / sizeof (r_386_id[0]))
+        name = r_386_id[type];
+      break;
+    case EM_AARCH64:
+      name = aarch64_type_name (type);
+      break;
+    }
+
+  if (name != NULL)
+    return name;
+
+  snprintf (buf, size, "type 0x%x", type);
+  return buf;
+}
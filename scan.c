@@ -0,0 +1,255 @@
+#define _DEFAULT_SOURCE
+
+#ifdef __APPLE__
+#include <libelf/libelf.h>
+#elif __linux__
+#include <libelf.h>
+#endif
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "./include/arena.h"
+#include "./include/elf_controller.h"
+#include "./include/elf_image.h"
+#include "./include/fileio.h"
+#include "./include/json_writer.h"
+#include "./include/outbuf.h"
+#include "./include/scan.h"
+#include "./include/threadpool.h"
+
+typedef struct
+{
+  char **paths;
+  size_t count;
+  size_t cap;
+} PathList;
+
+typedef struct
+{
+  int worker;
+  size_t offset;
+  size_t length;
+  int failed;
+} ScanResult;
+
+typedef struct
+{
+  char **paths;
+  ScanResult *results;
+  OutBuf *buffers; // one per worker
+  Arena *arenas;   // one per worker, reset between files
+  int flags;
+} ScanJob;
+
+static int
+path_list_add (PathList *list, const char *path)
+{
+  if (list->count == list->cap)
+    {
+      size_t cap = list->cap ? list->cap * 2 : 1024;
+      char **paths = realloc (list->paths, cap * sizeof (char *));
+      if (paths == NULL)
+        {
+          fprintf (stderr, "Failed to allocate memory.\n");
+          return -1;
+        }
+      list->paths = paths;
+      list->cap = cap;
+    }
+
+  list->paths[list->count] = strdup (path);
+  if (list->paths[list->count] == NULL)
+    {
+      fprintf (stderr, "Failed to allocate memory.\n");
+      return -1;
+    }
+  list->count++;
+
+  return 0;
+}
+
+static void
+path_list_free (PathList *list)
+{
+  for (size_t i = 0; i < list->count; i++)
+    free (list->paths[i]);
+  free (list->paths);
+}
+
+// cheap pre-filter so the walk never maps files that cannot be ELF
+static int
+has_elf_magic (const char *path)
+{
+  unsigned char ident[SELFMAG];
+
+  int fd = open (path, O_RDONLY);
+  if (fd == -1)
+    return 0;
+
+  ssize_t n = pread (fd, ident, sizeof (ident), 0);
+  close (fd);
+
+  return n == SELFMAG && memcmp (ident, ELFMAG, SELFMAG) == 0;
+}
+
+static int
+walk_tree (const char *dirname, PathList *list)
+{
+  DIR *dir = opendir (dirname);
+  if (dir == NULL)
+    {
+      fprintf (stderr, "%s: failed to open directory\n", dirname);
+      return 0;
+    }
+
+  char path[PATH_MAX];
+  struct dirent *entry;
+  int ret = 0;
+
+  while (ret == 0 && (entry = readdir (dir)) != NULL)
+    {
+      if (strcmp (entry->d_name, ".") == 0 || strcmp (entry->d_name, "..") == 0)
+        continue;
+
+      int n = snprintf (path, sizeof (path), "%s/%s", dirname, entry->d_name);
+      if (n < 0 || (size_t)n >= sizeof (path))
+        continue;
+
+      // symlinks are not followed, so every file is visited at most once
+      struct stat sb;
+      if (lstat (path, &sb) != 0)
+        continue;
+
+      if (S_ISDIR (sb.st_mode))
+        ret = walk_tree (path, list);
+      else if (S_ISREG (sb.st_mode) && sb.st_size >= (off_t)sizeof (Elf32_Ehdr)
+               && has_elf_magic (path))
+        ret = path_list_add (list, path);
+    }
+
+  closedir (dir);
+  return ret;
+}
+
+static int
+compare_paths (const void *a, const void *b)
+{
+  return strcmp (*(char *const *)a, *(char *const *)b);
+}
+
+static void
+scan_one (void *ctx, size_t index, int worker)
+{
+  ScanJob *job = ctx;
+  OutBuf *out = &job->buffers[worker];
+  ScanResult *result = &job->results[index];
+
+  result->worker = worker;
+  result->offset = out->len;
+  result->failed = do_batch_to (out, job->paths[index], job->flags, 1,
+                                &job->arenas[worker]);
+  result->length = out->len - result->offset;
+  arena_reset (&job->arenas[worker]);
+}
+
+int
+do_run_scan (const char *const dirname, int flags, int nthreads)
+{
+  PathList list = { NULL, 0, 0 };
+  int retval = 1;
+  int failed = 0;
+
+  if (walk_tree (dirname, &list) != 0)
+    goto clean;
+
+  qsort (list.paths, list.count, sizeof (char *), compare_paths);
+
+  OutBuf *buffers = calloc ((size_t)nthreads, sizeof (OutBuf));
+  Arena *arenas = calloc ((size_t)nthreads, sizeof (Arena));
+  ScanResult *results = calloc (SCAN_BATCH_FILES, sizeof (ScanResult));
+  if (buffers == NULL || arenas == NULL || results == NULL)
+    {
+      fprintf (stderr, "Failed to allocate memory.\n");
+      free (buffers);
+      free (arenas);
+      free (results);
+      goto clean;
+    }
+
+  OutBuf out;
+  if (outbuf_init (&out, STDOUT_FILENO, OUTBUF_DEFAULT_SIZE) != 0)
+    {
+      free (buffers);
+      free (arenas);
+      free (results);
+      goto clean;
+    }
+
+  if (flags & BATCH_FORMAT_JSON)
+    json_array_open (&out);
+
+  retval = 0;
+  for (int i = 0; i < nthreads; i++)
+    {
+      if (outbuf_init (&buffers[i], -1, OUTBUF_DEFAULT_SIZE) != 0)
+        retval = 1;
+      arena_init (&arenas[i], elf_image_memory_budget ());
+    }
+
+  // files are processed in windows so buffered output stays bounded; each
+  // window is written out in path order no matter which worker ran a file
+  for (size_t base = 0; retval == 0 && base < list.count;
+       base += SCAN_BATCH_FILES)
+    {
+      size_t n = list.count - base;
+      if (n > SCAN_BATCH_FILES)
+        n = SCAN_BATCH_FILES;
+
+      ScanJob job = { list.paths + base, results, buffers, arenas, flags };
+      if (pool_run (n, nthreads, scan_one, &job) != 0)
+        {
+          retval = 1;
+          break;
+        }
+
+      for (size_t i = 0; i < n; i++)
+        {
+          OutBuf *src = &buffers[results[i].worker];
+          if ((flags & BATCH_FORMAT_JSON) && base + i > 0)
+            json_array_separator (&out);
+          outbuf_write (&out, src->data + results[i].offset,
+                        results[i].length);
+          failed |= results[i].failed;
+        }
+
+      for (int i = 0; i < nthreads; i++)
+        buffers[i].len = 0;
+    }
+
+  if (flags & BATCH_FORMAT_JSON)
+    json_array_close (&out);
+
+  if (outbuf_flush (&out) != 0)
+    retval = 1;
+
+  outbuf_free (&out);
+  for (int i = 0; i < nthreads; i++)
+    {
+      outbuf_free (&buffers[i]);
+      arena_release (&arenas[i]);
+    }
+  free (buffers);
+  free (arenas);
+  free (results);
+
+clean:
+  path_list_free (&list);
+  return retval | failed;
+}
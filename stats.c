@@ -0,0 +1,155 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "./include/stats.h"
+
+#ifdef ELFREAD_STATS
+
+static const char *phase_names[STAT_PHASE_COUNT]
+    = { "map", "parse", "symbols", "format", "disasm", "write", "render" };
+static const char *counter_names[STAT_COUNTER_COUNT]
+    = { "files mapped",    "bytes mapped",  "pages touched",
+        "entries decoded", "format calls",  "bytes emitted",
+        "objects parsed" };
+
+#define NO_PHASE (-1)
+
+// One block per thread that ever recorded anything.  Blocks are only
+// written by their own thread and outlive it, so the report can sum them
+// without locks once the work is done.
+typedef struct _StatsBlock
+{
+  uint64_t phase_ns[STAT_PHASE_COUNT];
+  uint64_t phase_entries[STAT_PHASE_COUNT];
+  uint64_t counters[STAT_COUNTER_COUNT];
+  int current; // phase being timed, NO_PHASE outside any
+  uint64_t since;
+  struct _StatsBlock *next;
+} StatsBlock;
+
+static pthread_mutex_t blocks_lock = PTHREAD_MUTEX_INITIALIZER;
+static StatsBlock *blocks = NULL;
+static __thread StatsBlock *local = NULL;
+
+// absorbs the counts of a thread whose block could not be allocated
+static __thread StatsBlock discard;
+
+static uint64_t
+now_ns (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static StatsBlock *
+local_block (void)
+{
+  if (local != NULL)
+    return local;
+
+  StatsBlock *block = calloc (1, sizeof (StatsBlock));
+  if (block == NULL)
+    {
+      discard.current = NO_PHASE;
+      local = &discard;
+      return local;
+    }
+
+  block->current = NO_PHASE;
+  pthread_mutex_lock (&blocks_lock);
+  block->next = blocks;
+  blocks = block;
+  pthread_mutex_unlock (&blocks_lock);
+
+  local = block;
+  return block;
+}
+
+StatTimer
+stats_timer_begin (StatPhase phase)
+{
+  StatsBlock *block = local_block ();
+  uint64_t now = now_ns ();
+  StatTimer timer = { phase, block->current };
+
+  if (block->current != NO_PHASE)
+    block->phase_ns[block->current] += now - block->since;
+  block->current = phase;
+  block->since = now;
+  block->phase_entries[phase]++;
+
+  return timer;
+}
+
+void
+stats_timer_end (StatTimer *timer)
+{
+  StatsBlock *block = local_block ();
+  uint64_t now = now_ns ();
+
+  block->phase_ns[timer->phase] += now - block->since;
+  block->current = timer->outer;
+  block->since = now;
+}
+
+void
+stats_add (StatCounter counter, uint64_t n)
+{
+  local_block ()->counters[counter] += n;
+}
+
+void
+stats_report (FILE *stream)
+{
+  uint64_t phase_ns[STAT_PHASE_COUNT] = { 0 };
+  uint64_t phase_entries[STAT_PHASE_COUNT] = { 0 };
+  uint64_t counters[STAT_COUNTER_COUNT] = { 0 };
+  uint64_t total_ns = 0;
+  int threads = 0;
+
+  pthread_mutex_lock (&blocks_lock);
+  for (const StatsBlock *b = blocks; b != NULL; b = b->next)
+    {
+      for (int i = 0; i < STAT_PHASE_COUNT; i++)
+        {
+          phase_ns[i] += b->phase_ns[i];
+          phase_entries[i] += b->phase_entries[i];
+          total_ns += b->phase_ns[i];
+        }
+      for (int i = 0; i < STAT_COUNTER_COUNT; i++)
+        counters[i] += b->counters[i];
+      threads++;
+    }
+  pthread_mutex_unlock (&blocks_lock);
+
+  fprintf (stream, "\nPhase            Time (ms)   Share    Entered\n");
+  for (int i = 0; i < STAT_PHASE_COUNT; i++)
+    fprintf (stream, "%-14s %11.3f %6.1f%% %10" PRIu64 "\n", phase_names[i],
+             phase_ns[i] / 1e6,
+             total_ns ? 100.0 * phase_ns[i] / total_ns : 0.0,
+             phase_entries[i]);
+  fprintf (stream, "%-14s %11.3f  (summed over %d thread%s)\n", "total",
+           total_ns / 1e6, threads, threads == 1 ? "" : "s");
+
+  fprintf (stream, "\nCounter                        Value\n");
+  for (int i = 0; i < STAT_COUNTER_COUNT; i++)
+    fprintf (stream, "%-18s %18" PRIu64 "\n", counter_names[i], counters[i]);
+}
+
+#else
+
+void
+stats_report (FILE *stream)
+{
+  fprintf (stream, "Statistics were not compiled in; rebuild with "
+                   "make STATS=1.\n");
+}
+
+#endif // ELFREAD_STATS
@@ -0,0 +1,235 @@
+#ifdef __APPLE__
+#include <libelf/libelf.h>
+#elif __linux__
+#include <libelf.h>
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define STRTAB_X86 1
+#endif
+
+#include "./include/elf_image.h"
+#include "./include/fileio.h"
+#include "./include/stats.h"
+#include "./include/strtab.h"
+
+// one past the last NUL, so that any offset below it names a string that
+// ends inside the table
+size_t
+strtab_terminated (const char *data, size_t size)
+{
+  while (size > 0 && data[size - 1] != '\0')
+    size--;
+
+  return size;
+}
+
+// the string starts after the NULs set in one 64 byte block's mask
+static inline size_t
+take_mask (uint64_t mask, size_t base, size_t *starts)
+{
+  if (starts == NULL)
+    return (size_t)__builtin_popcountll (mask);
+
+  size_t n = 0;
+  for (; mask != 0; mask &= mask - 1)
+    starts[n++] = base + (size_t)__builtin_ctzll (mask) + 1;
+
+  return n;
+}
+
+static size_t
+scan_scalar (const char *data, size_t begin, size_t end, size_t *starts)
+{
+  const char *p = data + begin;
+  const char *stop = data + end;
+  size_t n = 0;
+
+  while ((p = memchr (p, '\0', (size_t)(stop - p))) != NULL)
+    {
+      if (starts != NULL)
+        starts[n] = (size_t)(p - data) + 1;
+      n++;
+      p++;
+    }
+
+  return n;
+}
+
+#ifdef __SSE2__
+static size_t
+scan_sse2 (const char *data, size_t size, size_t *starts)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  size_t n = 0;
+  size_t i = 0;
+
+  for (; size - i >= 64; i += 64)
+    {
+      uint64_t mask = 0;
+      for (int k = 0; k < 4; k++)
+        {
+          __m128i v = _mm_loadu_si128 ((const __m128i *)(data + i + k * 16));
+          uint32_t bits
+              = (uint32_t)_mm_movemask_epi8 (_mm_cmpeq_epi8 (v, zero));
+          mask |= (uint64_t)bits << (k * 16);
+        }
+      n += take_mask (mask, i, starts != NULL ? starts + n : NULL);
+    }
+
+  return n + scan_scalar (data, i, size, starts != NULL ? starts + n : NULL);
+}
+#endif
+
+#ifdef STRTAB_X86
+__attribute__ ((target ("avx2,popcnt"))) static size_t
+scan_avx2 (const char *data, size_t size, size_t *starts)
+{
+  const __m256i zero = _mm256_setzero_si256 ();
+  size_t n = 0;
+  size_t i = 0;
+
+  for (; size - i >= 64; i += 64)
+    {
+      __m256i lo = _mm256_loadu_si256 ((const __m256i *)(data + i));
+      __m256i hi = _mm256_loadu_si256 ((const __m256i *)(data + i + 32));
+      uint64_t mask
+          = (uint32_t)_mm256_movemask_epi8 (_mm256_cmpeq_epi8 (lo, zero))
+            | (uint64_t)(uint32_t)_mm256_movemask_epi8 (
+                  _mm256_cmpeq_epi8 (hi, zero))
+                  << 32;
+      n += take_mask (mask, i, starts != NULL ? starts + n : NULL);
+    }
+
+  return n + scan_scalar (data, i, size, starts != NULL ? starts + n : NULL);
+}
+#endif
+
+// Counts the NULs of data, and with starts stores where the string after
+// each one begins.  Blocks of 64 bytes are compared at once and turned into
+// a bit mask, with AVX2 where the CPU has it and SSE2 otherwise; strings
+// are short enough that stopping at every NUL would cost more than the
+// comparisons.
+size_t
+strtab_scan (const char *data, size_t size, size_t *starts)
+{
+#ifdef STRTAB_X86
+  if (__builtin_cpu_supports ("avx2"))
+    return scan_avx2 (data, size, starts);
+#endif
+#ifdef __SSE2__
+  return scan_sse2 (data, size, starts);
+#else
+  return scan_scalar (data, 0, size, starts);
+#endif
+}
+
+// String tables proper, and sections of merged strings such as .debug_str
+// and .comment.  Compressed sections are left out; their bytes are not
+// strings until inflated.
+int
+strtab_is_strings (const ElfImage *image, size_t section)
+{
+  Elf64_Shdr scratch;
+  const Elf64_Shdr *sh = elf_image_shdr (image, section, &scratch);
+  if (sh == NULL || sh->sh_type == SHT_NOBITS
+      || (sh->sh_flags & SHF_COMPRESSED))
+    return 0;
+
+  return sh->sh_type == SHT_STRTAB
+         || ((sh->sh_flags & SHF_STRINGS) && sh->sh_entsize <= 1);
+}
+
+// The section is scanned twice, once to count its strings and once to
+// store where they start, so the index is allocated at its final size.
+int
+strtab_load (StringTable *table, const ElfImage *image, size_t section)
+{
+  STAT_SCOPE (STAT_PHASE_PARSE);
+  const FileContents *file = image->file;
+  Elf64_Shdr scratch;
+  const Elf64_Shdr *sh = elf_image_shdr (image, section, &scratch);
+
+  memset (table, 0, sizeof (StringTable));
+  table->section = section;
+  if (sh->sh_offset > file->length
+      || sh->sh_size > file->length - sh->sh_offset)
+    {
+      fprintf (stderr, "String table extends past the end of the file.\n");
+      return -1;
+    }
+
+  table->data = file->buffer + sh->sh_offset;
+  table->size = sh->sh_size;
+  table->terminated = strtab_terminated (table->data, table->size);
+  if (table->size == 0)
+    return 0;
+
+  size_t nuls = strtab_scan (table->data, table->size, NULL);
+  table->starts = robust_malloc ((nuls + 1) * sizeof (size_t));
+  if (table->starts == NULL)
+    return -1;
+
+  table->starts[0] = 0;
+  strtab_scan (table->data, table->size, table->starts + 1);
+
+  // runs of NULs leave empty strings, which are not listed
+  size_t n = 0;
+  for (size_t i = 0; i <= nuls; i++)
+    if (table->starts[i] < table->size
+        && table->data[table->starts[i]] != '\0')
+      table->starts[n++] = table->starts[i];
+
+  table->count = n;
+  STAT_ADD (STAT_ENTRIES_DECODED, n);
+  return 0;
+}
+
+void
+strtab_free (StringTable *table)
+{
+  free (table->starts);
+  memset (table, 0, sizeof (StringTable));
+}
+
+// bytes of the index'th string, up to its NUL or the table's end
+size_t
+strtab_length (const StringTable *table, size_t index)
+{
+  size_t start = table->starts[index];
+  size_t limit
+      = index + 1 < table->count ? table->starts[index + 1] : table->size;
+  const char *nul = memchr (table->data + start, '\0', limit - start);
+
+  return nul != NULL ? (size_t)(nul - (table->data + start)) : limit - start;
+}
+
+// the string that offset falls in, -1 for an offset past the end or on a
+// NUL between strings
+long
+strtab_find (const StringTable *table, size_t offset)
+{
+  size_t lo = 0;
+  size_t hi = table->count;
+
+  while (lo < hi)
+    {
+      size_t mid = lo + (hi - lo) / 2;
+      if (table->starts[mid] <= offset)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  if (lo == 0
+      || offset - table->starts[lo - 1] >= strtab_length (table, lo - 1))
+    return -1;
+
+  return (long)(lo - 1);
+}
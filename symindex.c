@@ -0,0 +1,385 @@
+#ifdef __APPLE__
+#include <libelf/libelf.h>
+#elif __linux__
+#include <libelf.h>
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "./include/elf_controller.h"
+#include "./include/elf_image.h"
+#include "./include/fileio.h"
+#include "./include/json_writer.h"
+#include "./include/outbuf.h"
+#include "./include/stats.h"
+#include "./include/symindex.h"
+#include "./include/symtab.h"
+
+#define LOOKUP_LANES 8
+#define SYMBOLIZE_READ_SIZE (1 << 20)
+
+static const char hex_digits[] = "0123456789abcdef";
+
+static int
+is_code_or_data (const SymbolStore *store, size_t i)
+{
+  unsigned char type = ELF64_ST_TYPE (store->info[i]);
+  Elf64_Word shndx = store->shndx[i];
+
+  if (shndx == SHN_UNDEF || shndx >= ELF_SHN_RESERVED)
+    return 0;
+
+  return type == STT_FUNC || type == STT_OBJECT || type == STT_GNU_IFUNC;
+}
+
+// in-order walk of the implicit tree, handing out sorted keys
+static size_t
+fill_tree (AddrIndex *index, size_t pos, size_t k)
+{
+  if (k <= index->count)
+    {
+      pos = fill_tree (index, pos, 2 * k);
+      index->tree[k] = index->start[pos];
+      index->rank[k] = (uint32_t)pos;
+      pos = fill_tree (index, pos + 1, 2 * k + 1);
+    }
+
+  return pos;
+}
+
+int
+addrindex_build (AddrIndex *index, ElfImage *image)
+{
+  SymbolStore *stores[2] = { elf_image_symbols (image, SHT_SYMTAB),
+                             elf_image_symbols (image, SHT_DYNSYM) };
+  size_t total = 0;
+
+  STAT_SCOPE (STAT_PHASE_SYMBOLS);
+  memset (index, 0, sizeof (AddrIndex));
+
+  for (int s = 0; s < 2; s++)
+    if (stores[s] != NULL)
+      total += stores[s]->count;
+
+  uint64_t *addr = robust_malloc ((total + 1) * sizeof (uint64_t));
+  uint64_t *size = robust_malloc ((total + 1) * sizeof (uint64_t));
+  const char **name = robust_malloc ((total + 1) * sizeof (const char *));
+  uint32_t *order = robust_malloc ((total + 1) * sizeof (uint32_t));
+  int retval = -1;
+
+  if (addr == NULL || size == NULL || name == NULL || order == NULL)
+    goto clean;
+
+  // .symtab comes first so the stable sort prefers its names on ties
+  size_t m = 0;
+  for (int s = 0; s < 2; s++)
+    {
+      const SymbolStore *store = stores[s];
+      if (store == NULL)
+        continue;
+
+      for (size_t i = 0; i < store->count; i++)
+        {
+          if (!is_code_or_data (store, i))
+            continue;
+          addr[m] = store->value[i];
+          size[m] = store->size[i];
+          name[m] = symstore_name (store, i);
+          order[m] = (uint32_t)m;
+          m++;
+        }
+    }
+
+  if (radix_sort_by_key (addr, order, m) != 0)
+    goto clean;
+
+  // collapse aliases, keeping the largest symbol at each address
+  size_t n = 0;
+  for (size_t i = 0; i < m; i++)
+    {
+      uint32_t o = order[i];
+      if (n > 0 && addr[order[n - 1]] == addr[o])
+        {
+          if (size[o] > size[order[n - 1]])
+            order[n - 1] = o;
+          continue;
+        }
+      order[n++] = o;
+    }
+
+  // the index outlives the scratch above and goes with the image
+  size_t block_size = (n + 1) * sizeof (uint64_t)
+                      + 2 * n * sizeof (Elf64_Addr)
+                      + n * sizeof (const char *)
+                      + (n + 1) * sizeof (uint32_t);
+  char *block = arena_alloc (image->arena, block_size);
+  if (block == NULL)
+    goto clean;
+
+  index->tree = (uint64_t *)block;
+  block += (n + 1) * sizeof (uint64_t);
+  index->start = (Elf64_Addr *)block;
+  block += n * sizeof (Elf64_Addr);
+  index->end = (Elf64_Addr *)block;
+  block += n * sizeof (Elf64_Addr);
+  index->names = (const char **)block;
+  block += n * sizeof (const char *);
+  index->rank = (uint32_t *)block;
+  index->count = n;
+
+  for (size_t i = 0; i < n; i++)
+    {
+      uint32_t o = order[i];
+      index->start[i] = addr[o];
+      index->names[i] = name[o];
+
+      // unsized symbols run up to the next one
+      if (size[o] != 0)
+        index->end[i] = addr[o] + size[o];
+      else if (i + 1 < n)
+        index->end[i] = addr[order[i + 1]];
+      else
+        index->end[i] = addr[o] + 1;
+    }
+
+  index->tree[0] = 0;
+  index->rank[0] = 0;
+  fill_tree (index, 0, 1);
+  retval = 0;
+
+clean:
+  free (addr);
+  free (size);
+  free (name);
+  free (order);
+
+  return retval;
+}
+
+// K is the tree slot reached after falling off the bottom; strip the
+// trailing right turns to find the first key greater than ADDR
+static long
+resolve_slot (const AddrIndex *index, size_t k, Elf64_Addr addr)
+{
+  k >>= __builtin_ffsl ((long)~k);
+
+  size_t pos = k == 0 ? index->count : index->rank[k];
+  if (pos == 0)
+    return -1;
+
+  pos--;
+  if (addr >= index->end[pos])
+    return -1;
+
+  return (long)pos;
+}
+
+// walks LOOKUP_LANES searches down the tree in lockstep so their cache
+// misses overlap instead of being paid one after another
+void
+addrindex_lookup_batch (const AddrIndex *index, const Elf64_Addr *addrs,
+                        size_t n, long *out)
+{
+  size_t count = index->count;
+
+  for (size_t base = 0; base < n; base += LOOKUP_LANES)
+    {
+      size_t lanes = n - base < LOOKUP_LANES ? n - base : LOOKUP_LANES;
+      size_t k[LOOKUP_LANES];
+      int active = 1;
+
+      for (size_t j = 0; j < lanes; j++)
+        k[j] = 1;
+
+      while (active)
+        {
+          active = 0;
+          for (size_t j = 0; j < lanes; j++)
+            {
+              if (k[j] > count)
+                continue;
+              __builtin_prefetch (index->tree + k[j] * 8);
+              k[j] = 2 * k[j] + (index->tree[k[j]] <= addrs[base + j]);
+              active = 1;
+            }
+        }
+
+      for (size_t j = 0; j < lanes; j++)
+        out[base + j] = resolve_slot (index, k[j], addrs[base + j]);
+    }
+}
+
+static void
+put_hex (OutBuf *out, uint64_t value)
+{
+  char digits[18] = { '0', 'x' };
+  size_t n = 2;
+  int shift = 60;
+
+  while (shift > 0 && ((value >> shift) & 0xf) == 0)
+    shift -= 4;
+  for (; shift >= 0; shift -= 4)
+    digits[n++] = hex_digits[(value >> shift) & 0xf];
+
+  outbuf_write (out, digits, n);
+}
+
+static void
+emit_symbolized (OutBuf *out, JsonWriter *jw, const AddrIndex *index,
+                 const Elf64_Addr *addrs, const long *hits, size_t n)
+{
+  for (size_t i = 0; i < n; i++)
+    {
+      long hit = hits[i];
+
+      if (jw != NULL)
+        {
+          json_record_begin (jw, "symbolize");
+          json_field_u64 (jw, "address", addrs[i]);
+          if (hit >= 0)
+            {
+              json_field_str (jw, "symbol", index->names[hit]);
+              json_field_u64 (jw, "offset", addrs[i] - index->start[hit]);
+            }
+          json_record_end (jw);
+          continue;
+        }
+
+      put_hex (out, addrs[i]);
+      outbuf_putc (out, ' ');
+      if (hit < 0)
+        outbuf_write (out, "??\n", 3);
+      else
+        {
+          outbuf_puts (out, index->names[hit]);
+          outbuf_write (out, "+", 1);
+          put_hex (out, addrs[i] - index->start[hit]);
+          outbuf_putc (out, '\n');
+        }
+    }
+}
+
+static int
+hex_value (unsigned char c)
+{
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  c |= 0x20;
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+
+  return -1;
+}
+
+// reads whitespace separated hex addresses (0x prefix optional) from stdin
+int
+do_run_symbolize (const char *const filename, int flags)
+{
+  ElfImage *image = elf_image_open (filename);
+  if (image == NULL)
+    {
+      fprintf (stderr, "%s: not a readable ELF file\n", filename);
+      return 1;
+    }
+
+  AddrIndex index;
+  OutBuf out;
+  int retval = 1;
+
+  if (addrindex_build (&index, image) != 0)
+    goto close_image;
+
+  if (outbuf_init (&out, STDOUT_FILENO, OUTBUF_DEFAULT_SIZE) != 0)
+    goto close_image;
+
+  char *input = robust_malloc (SYMBOLIZE_READ_SIZE);
+  Elf64_Addr *addrs = robust_malloc (SYMBOLIZE_BATCH * sizeof (Elf64_Addr));
+  long *hits = robust_malloc (SYMBOLIZE_BATCH * sizeof (long));
+  if (input == NULL || addrs == NULL || hits == NULL)
+    goto free_buffers;
+
+  JsonWriter jw;
+  JsonWriter *jwp = NULL;
+  if (flags & BATCH_FORMAT_MASK)
+    {
+      json_writer_init (&jw, &out, flags & BATCH_FORMAT_NDJSON);
+      jwp = &jw;
+    }
+  if (flags & BATCH_FORMAT_JSON)
+    json_array_open (&out);
+
+  uint64_t value = 0;
+  int digits = 0;
+  int bad = 0;
+  size_t n = 0;
+  ssize_t len;
+
+  while ((len = read (STDIN_FILENO, input, SYMBOLIZE_READ_SIZE)) > 0)
+    for (ssize_t i = 0; i <= len; i++)
+      {
+        int c = i < len ? (unsigned char)input[i] : -1;
+        int v = c >= 0 ? hex_value ((unsigned char)c) : -1;
+
+        if (v >= 0)
+          {
+            value = (value << 4) | (unsigned)v;
+            digits++;
+            continue;
+          }
+        if ((c == 'x' || c == 'X') && digits == 1 && value == 0)
+          {
+            digits = 0;
+            continue;
+          }
+        if (c == -1)
+          break; // a token may continue in the next read
+
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r')
+          {
+            bad = 1;
+            continue;
+          }
+
+        if (digits > 0 && !bad)
+          {
+            addrs[n++] = value;
+            if (n == SYMBOLIZE_BATCH)
+              {
+                addrindex_lookup_batch (&index, addrs, n, hits);
+                emit_symbolized (&out, jwp, &index, addrs, hits, n);
+                n = 0;
+              }
+          }
+        else if (bad)
+          fprintf (stderr, "Skipping malformed address.\n");
+
+        value = 0;
+        digits = 0;
+        bad = 0;
+      }
+
+  if (digits > 0 && !bad)
+    addrs[n++] = value;
+
+  addrindex_lookup_batch (&index, addrs, n, hits);
+  emit_symbolized (&out, jwp, &index, addrs, hits, n);
+
+  if (flags & BATCH_FORMAT_JSON)
+    json_array_close (&out);
+
+  retval = outbuf_flush (&out) != 0 || len < 0;
+
+free_buffers:
+  free (input);
+  free (addrs);
+  free (hits);
+  outbuf_free (&out);
+close_image:
+  elf_image_close (image);
+
+  return retval;
+}
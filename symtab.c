@@ -0,0 +1,390 @@
+#ifdef __APPLE__
+#include <libelf/libelf.h>
+#elif __linux__
+#include <libelf.h>
+#endif
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./include/elf_image.h"
+#include "./include/fileio.h"
+#include "./include/my_elf.h"
+#include "./include/stats.h"
+#include "./include/strtab.h"
+#include "./include/symtab.h"
+
+#define COLUMN_ALIGN 16
+
+static const char *sym_type_id[] = { "NOTYPE", "OBJECT", "FUNC", "SECTION",
+                                     "FILE",   "COMMON", "TLS" };
+static const char *sym_bind_id[] = { "LOCAL", "GLOBAL", "WEAK" };
+static const char *sym_visibility_id[]
+    = { "DEFAULT", "INTERNAL", "HIDDEN", "PROTECTED" };
+
+static size_t
+column_size (size_t count, size_t width)
+{
+  return (count * width + COLUMN_ALIGN - 1) & ~(size_t)(COLUMN_ALIGN - 1);
+}
+
+size_t
+symstore_columns_size (size_t count)
+{
+  return column_size (count, sizeof (Elf64_Addr))
+         + column_size (count, sizeof (Elf64_Xword))
+         + column_size (count, sizeof (Elf64_Word))
+         + column_size (count, sizeof (Elf64_Word)) * 2
+         + column_size (count, 1) * 2;
+}
+
+// points the columns of store at a block laid out by symstore_columns_size
+void
+symstore_bind_columns (SymbolStore *store, void *block, size_t count)
+{
+  char *p = block;
+
+  store->value = (Elf64_Addr *)p;
+  p += column_size (count, sizeof (Elf64_Addr));
+  store->size = (Elf64_Xword *)p;
+  p += column_size (count, sizeof (Elf64_Xword));
+  store->name = (Elf64_Word *)p;
+  p += column_size (count, sizeof (Elf64_Word));
+  store->shndx = (Elf64_Word *)p;
+  p += column_size (count, sizeof (Elf64_Word));
+  store->info = (unsigned char *)p;
+  p += column_size (count, 1);
+  store->other = (unsigned char *)p;
+}
+
+long
+find_symbol_section (const ElfImage *image, Elf64_Word sh_type)
+{
+  for (size_t i = 0; i < image->shdrs.count; i++)
+    {
+      Elf64_Shdr scratch;
+      const Elf64_Shdr *sh = elf_image_shdr (image, i, &scratch);
+      if (sh->sh_type == sh_type)
+        return (long)i;
+    }
+
+  return -1;
+}
+
+// symbols whose st_shndx is SHN_XINDEX find their section in the
+// SHT_SYMTAB_SHNDX table linked to the symbol table, one word per symbol
+static void
+resolve_xindex (SymbolStore *store, const ElfImage *image)
+{
+  const FileContents *file = image->file;
+
+  for (size_t i = 0; i < image->shdrs.count; i++)
+    {
+      Elf64_Shdr scratch;
+      const Elf64_Shdr *sh = elf_image_shdr (image, i, &scratch);
+      if (sh->sh_type != SHT_SYMTAB_SHNDX || sh->sh_link != store->section)
+        continue;
+
+      if (sh->sh_offset > file->length
+          || sh->sh_size > file->length - sh->sh_offset)
+        return;
+
+      const unsigned char *table
+          = (const unsigned char *)file->buffer + sh->sh_offset;
+      size_t n = sh->sh_size / sizeof (Elf64_Word);
+
+      for (size_t k = 0; k < store->count; k++)
+        if (store->shndx[k] == ELF_SHN (SHN_XINDEX))
+          store->shndx[k] = k < n ? image->layout->read_word (
+                                table + k * sizeof (Elf64_Word))
+                                  : SHN_UNDEF;
+      return;
+    }
+}
+
+int
+symstore_load (SymbolStore *store, const ElfImage *image, size_t section)
+{
+  STAT_SCOPE (STAT_PHASE_SYMBOLS);
+  const FileContents *file = image->file;
+
+  memset (store, 0, sizeof (SymbolStore));
+  store->section = section;
+
+  Elf64_Shdr scratch;
+  const Elf64_Shdr *sh = elf_image_shdr (image, section, &scratch);
+  if (sh == NULL)
+    {
+      fprintf (stderr, "Symbol table section is out of range.\n");
+      return -1;
+    }
+
+  const ElfLayout *layout = image->layout;
+  size_t entsize = sh->sh_entsize ? sh->sh_entsize : layout->sym_size;
+  ElfTableView syms;
+  if (get_elf_table_view (file->buffer, file->length, sh->sh_offset,
+                          sh->sh_size / entsize, entsize, layout->sym_size,
+                          __alignof__ (Elf64_Sym), &syms)
+      != 0)
+    return -1;
+
+  Elf64_Shdr strtab_scratch;
+  const Elf64_Shdr *strtab = elf_image_shdr (image, sh->sh_link,
+                                             &strtab_scratch);
+  if (strtab != NULL && strtab->sh_offset <= file->length
+      && strtab->sh_size <= file->length - strtab->sh_offset)
+    {
+      store->strtab = file->buffer + strtab->sh_offset;
+      store->strtab_size = strtab_terminated (store->strtab, strtab->sh_size);
+    }
+
+  size_t n = syms.count;
+  size_t total = symstore_columns_size (n);
+
+  char *columns_block = arena_alloc (image->arena, total);
+  if (columns_block == NULL)
+    return -1;
+
+  symstore_bind_columns (store, columns_block, n);
+
+  // one loop specialized for the file's layout, no per-field dispatch
+  ElfSymColumns columns = { store->value, store->size, store->name,
+                            store->shndx, store->info, store->other };
+  layout->syms (syms.base, syms.stride, n, &columns);
+  store->count = n;
+  STAT_ADD (STAT_ENTRIES_DECODED, n);
+
+  resolve_xindex (store, image);
+
+  return 0;
+}
+
+// decoded on first use and kept with the image
+SymbolStore *
+elf_image_symbols (ElfImage *image, Elf64_Word sh_type)
+{
+  int slot = sh_type == SHT_DYNSYM;
+
+  if (image->symbols[slot] != NULL)
+    return image->symbols[slot];
+
+  long section = find_symbol_section (image, sh_type);
+  if (section < 0)
+    return NULL;
+
+  // the store lives in the image's arena, so a failed load is only
+  // reclaimed with the rest of it
+  SymbolStore *store = arena_alloc (image->arena, sizeof (SymbolStore));
+  if (store == NULL)
+    return NULL;
+
+  if (symstore_load (store, image, (size_t)section) != 0)
+    return NULL;
+
+  image->symbols[slot] = store;
+  return store;
+}
+
+const char *
+symstore_name (const SymbolStore *store, size_t index)
+{
+  Elf64_Word off = store->name[index];
+
+  if (store->strtab == NULL || off >= store->strtab_size)
+    return "";
+
+  return store->strtab + off;
+}
+
+// The selectors narrow a selection of symbol indices in place and return
+// how many are left.  They only touch one column and write every index
+// unconditionally, which keeps the loops branch free.
+size_t
+symstore_select_type (const SymbolStore *store, unsigned char type,
+                      uint32_t *sel, size_t n)
+{
+  size_t m = 0;
+
+  for (size_t k = 0; k < n; k++)
+    {
+      uint32_t i = sel[k];
+      sel[m] = i;
+      m += ELF64_ST_TYPE (store->info[i]) == type;
+    }
+
+  return m;
+}
+
+size_t
+symstore_select_defined (const SymbolStore *store, uint32_t *sel, size_t n)
+{
+  size_t m = 0;
+
+  for (size_t k = 0; k < n; k++)
+    {
+      uint32_t i = sel[k];
+      sel[m] = i;
+      m += store->shndx[i] != SHN_UNDEF;
+    }
+
+  return m;
+}
+
+size_t
+symstore_select_min_size (const SymbolStore *store, Elf64_Xword size,
+                          uint32_t *sel, size_t n)
+{
+  size_t m = 0;
+
+  for (size_t k = 0; k < n; k++)
+    {
+      uint32_t i = sel[k];
+      sel[m] = i;
+      m += store->size[i] >= size;
+    }
+
+  return m;
+}
+
+// stable LSD radix sort of ORDER by a 64-bit key column, skipping the byte
+// positions on which every key agrees
+int
+radix_sort_by_key (const uint64_t *keys, uint32_t *order, size_t n)
+{
+  if (n < 2)
+    return 0;
+
+  uint32_t *tmp = robust_malloc (n * sizeof (uint32_t));
+  if (tmp == NULL)
+    return -1;
+
+  uint32_t *src = order;
+  uint32_t *dst = tmp;
+
+  for (int shift = 0; shift < 64; shift += 8)
+    {
+      size_t count[256] = { 0 };
+
+      for (size_t i = 0; i < n; i++)
+        count[(keys[src[i]] >> shift) & 0xff]++;
+
+      if (count[(keys[src[0]] >> shift) & 0xff] == n)
+        continue;
+
+      size_t pos = 0;
+      for (int b = 0; b < 256; b++)
+        {
+          size_t c = count[b];
+          count[b] = pos;
+          pos += c;
+        }
+
+      for (size_t i = 0; i < n; i++)
+        dst[count[(keys[src[i]] >> shift) & 0xff]++] = src[i];
+
+      uint32_t *swap = src;
+      src = dst;
+      dst = swap;
+    }
+
+  if (src != order)
+    memcpy (order, src, n * sizeof (uint32_t));
+  free (tmp);
+
+  return 0;
+}
+
+int
+symstore_sort_by_address (const SymbolStore *store, uint32_t *order, size_t n)
+{
+  return radix_sort_by_key (store->value, order, n);
+}
+
+int
+symstore_sort_by_size (const SymbolStore *store, uint32_t *order, size_t n)
+{
+  return radix_sort_by_key (store->size, order, n);
+}
+
+const char *
+symbol_type_name (unsigned char info)
+{
+  unsigned char type = ELF64_ST_TYPE (info);
+
+  if (type < sizeof (sym_type_id) / sizeof (sym_type_id[0]))
+    return sym_type_id[type];
+  if (type == STT_GNU_IFUNC)
+    return "IFUNC";
+  if (type >= STT_LOPROC)
+    return "PROC";
+
+  return "OS";
+}
+
+// name against one of the upper case names above, in any case
+static int
+is_type_name (const char *upper, const char *name)
+{
+  while (*upper != '\0' && toupper ((unsigned char)*name) == *upper)
+    upper++, name++;
+
+  return *upper == '\0' && *name == '\0';
+}
+
+// the STT_* value symbol_type_name gives name, or -1
+int
+symbol_type_from_name (const char *name)
+{
+  for (size_t type = 0; type < sizeof (sym_type_id) / sizeof (sym_type_id[0]);
+       type++)
+    if (is_type_name (sym_type_id[type], name))
+      return (int)type;
+
+  if (is_type_name ("IFUNC", name))
+    return STT_GNU_IFUNC;
+
+  return -1;
+}
+
+const char *
+symbol_bind_name (unsigned char info)
+{
+  unsigned char bind = ELF64_ST_BIND (info);
+
+  if (bind < sizeof (sym_bind_id) / sizeof (sym_bind_id[0]))
+    return sym_bind_id[bind];
+  if (bind == STB_GNU_UNIQUE)
+    return "UNIQUE";
+  if (bind >= STB_LOPROC)
+    return "PROC";
+
+  return "OS";
+}
+
+const char *
+symbol_visibility_name (unsigned char other)
+{
+  return sym_visibility_id[ELF64_ST_VISIBILITY (other)];
+}
+
+const char *
+symbol_shndx_name (Elf64_Word shndx, char *buf, size_t size)
+{
+  switch (shndx)
+    {
+    case SHN_UNDEF:
+      return "UND";
+    case ELF_SHN (SHN_ABS):
+      return "ABS";
+    case ELF_SHN (SHN_COMMON):
+      return "COM";
+    default:
+      if (shndx >= ELF_SHN_RESERVED)
+        shndx &= ~ELF_SHN_RESERVED;
+      snprintf (buf, size, "%u", (unsigned)shndx);
+      return buf;
+    }
+}
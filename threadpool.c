@@ -0,0 +1,167 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "./include/threadpool.h"
+
+typedef struct
+{
+  pthread_mutex_t lock;
+  size_t head;
+  size_t tail;
+} WorkDeque;
+
+typedef struct
+{
+  WorkDeque *deques;
+  int nthreads;
+  PoolTask task;
+  void *ctx;
+} Pool;
+
+typedef struct
+{
+  Pool *pool;
+  int id;
+} Worker;
+
+int
+pool_default_threads (void)
+{
+  long n = sysconf (_SC_NPROCESSORS_ONLN);
+  if (n < 1)
+    return 1;
+  if (n > POOL_MAX_THREADS)
+    return POOL_MAX_THREADS;
+
+  return (int)n;
+}
+
+// owner side: take the next task from the front of our own slice
+static int
+pop_task (WorkDeque *deque, size_t *index)
+{
+  int found = 0;
+
+  pthread_mutex_lock (&deque->lock);
+  if (deque->head < deque->tail)
+    {
+      *index = deque->head++;
+      found = 1;
+    }
+  pthread_mutex_unlock (&deque->lock);
+
+  return found;
+}
+
+// thief side: move the back half of a victim's slice into our own deque
+static int
+steal_tasks (Pool *pool, int self)
+{
+  for (int i = 1; i < pool->nthreads; i++)
+    {
+      WorkDeque *victim = &pool->deques[(self + i) % pool->nthreads];
+      size_t head = 0;
+      size_t tail = 0;
+
+      pthread_mutex_lock (&victim->lock);
+      size_t left = victim->tail - victim->head;
+      if (left > 0)
+        {
+          size_t take = (left + 1) / 2;
+          tail = victim->tail;
+          head = tail - take;
+          victim->tail = head;
+        }
+      pthread_mutex_unlock (&victim->lock);
+
+      if (head < tail)
+        {
+          WorkDeque *own = &pool->deques[self];
+          pthread_mutex_lock (&own->lock);
+          own->head = head;
+          own->tail = tail;
+          pthread_mutex_unlock (&own->lock);
+          return 1;
+        }
+    }
+
+  return 0;
+}
+
+static void *
+worker_main (void *arg)
+{
+  Worker *worker = arg;
+  Pool *pool = worker->pool;
+  WorkDeque *own = &pool->deques[worker->id];
+  size_t index;
+
+  do
+    {
+      while (pop_task (own, &index))
+        pool->task (pool->ctx, index, worker->id);
+    }
+  while (steal_tasks (pool, worker->id));
+
+  return NULL;
+}
+
+int
+pool_run (size_t ntasks, int nthreads, PoolTask task, void *ctx)
+{
+  if (task == NULL)
+    {
+      fprintf (stderr, "Pool task is NULL.\n");
+      return -1;
+    }
+
+  if (nthreads < 1)
+    nthreads = 1;
+  if (nthreads > POOL_MAX_THREADS)
+    nthreads = POOL_MAX_THREADS;
+  if ((size_t)nthreads > ntasks)
+    nthreads = ntasks > 0 ? (int)ntasks : 1;
+
+  Pool pool = { NULL, nthreads, task, ctx };
+  Worker workers[POOL_MAX_THREADS];
+  pthread_t threads[POOL_MAX_THREADS];
+
+  pool.deques = calloc ((size_t)nthreads, sizeof (WorkDeque));
+  if (pool.deques == NULL)
+    {
+      fprintf (stderr, "Failed to allocate memory.\n");
+      return -1;
+    }
+
+  for (int i = 0; i < nthreads; i++)
+    {
+      pthread_mutex_init (&pool.deques[i].lock, NULL);
+      pool.deques[i].head = ntasks * (size_t)i / (size_t)nthreads;
+      pool.deques[i].tail = ntasks * (size_t)(i + 1) / (size_t)nthreads;
+      workers[i].pool = &pool;
+      workers[i].id = i;
+    }
+
+  // the calling thread is worker 0
+  int started = 1;
+  for (int i = 1; i < nthreads; i++, started++)
+    if (pthread_create (&threads[i], NULL, worker_main, &workers[i]) != 0)
+      {
+        fprintf (stderr, "Failed to start worker thread.\n");
+        break;
+      }
+
+  // workers that failed to start simply have their slices stolen
+  worker_main (&workers[0]);
+
+  for (int i = 1; i < started; i++)
+    pthread_join (threads[i], NULL);
+
+  for (int i = 0; i < nthreads; i++)
+    pthread_mutex_destroy (&pool.deques[i].lock);
+  free (pool.deques);
+
+  return 0;
+}
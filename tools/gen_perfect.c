@@ -0,0 +1,194 @@
+/* gen_perfect.c
+ * Build-time generator for the perfect-hash lookup tables.
+ * usage:
+ * $ ./tools/gen_perfect p_type > include/p_type_perfect.h
+ *
+ * Each table is an X-macro list in include/<name>_table.def.  The keys are
+ * resolved by the compiler, then a multiplier is searched for that sends
+ * every key to its own slot of a power-of-two table, so a lookup is one
+ * multiply, one shift and one compare with no data-dependent branches.
+ */
+
+#ifdef __APPLE__
+#include <libelf/libelf.h>
+#elif __linux__
+#include <libelf.h>
+#endif
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/elf_android.h"
+
+#define MAX_TABLE_BITS 10
+#define MAX_TRIES 1000000
+
+typedef struct
+{
+  uint32_t key;
+  const char *key_name;
+  const char *value;
+} Entry;
+
+typedef struct
+{
+  const char *name;
+  const char *value_type;
+  const char *fallback;
+  const Entry *entries;
+  size_t count;
+} Table;
+
+#define PERFECT_ENTRY(key, value) { (key), #key, #value },
+
+static const Entry p_type_entries[] = {
+#include "../include/p_type_table.def"
+};
+
+static const Entry s_type_entries[] = {
+#include "../include/s_type_table.def"
+};
+
+static const Entry osabi_entries[] = {
+#include "../include/osabi_table.def"
+};
+
+#undef PERFECT_ENTRY
+
+#define TABLE(name, type, fallback)                                           \
+  {                                                                           \
+    #name, type, fallback, name##_entries,                                    \
+        sizeof (name##_entries) / sizeof (name##_entries[0])                  \
+  }
+
+static const Table tables[] = {
+  TABLE (p_type, "const char *", "\"UNKNOWN\""),
+  TABLE (s_type, "int", "0"),
+  TABLE (osabi, "int", "14"), // "<unknown>" in e_osabi_strings.h
+};
+
+// must match the emitted perfect_slot()
+static uint32_t
+slot_of (uint32_t key, uint32_t mult, int bits)
+{
+  key ^= key >> 15;
+  return (uint32_t)(key * mult) >> (32 - bits);
+}
+
+static uint32_t
+next_random (uint32_t *state)
+{
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+static int
+is_perfect (const Table *table, uint32_t mult, int bits, int *slots)
+{
+  memset (slots, -1, sizeof (int) << bits);
+
+  for (size_t i = 0; i < table->count; i++)
+    {
+      uint32_t slot = slot_of (table->entries[i].key, mult, bits);
+      if (slots[slot] != -1)
+        return 0;
+      slots[slot] = (int)i;
+    }
+
+  return 1;
+}
+
+static int
+is_pointer (const char *type)
+{
+  return type[strlen (type) - 1] == '*';
+}
+
+static int
+emit_table (const Table *table)
+{
+  static int slots[1 << MAX_TABLE_BITS];
+  int bits = 1;
+
+  while (((size_t)1 << bits) < table->count)
+    bits++;
+
+  // deterministic search so rebuilding never changes the output
+  uint32_t state = 0x9e3779b9;
+  for (; bits <= MAX_TABLE_BITS; bits++)
+    for (int tries = 0; tries < MAX_TRIES; tries++)
+      {
+        uint32_t mult = next_random (&state) | 1;
+        if (!is_perfect (table, mult, bits, slots))
+          continue;
+
+        printf ("/* generated by tools/gen_perfect.c from "
+                "include/%s_table.def -- do not edit */\n",
+                table->name);
+        char guard[64];
+        size_t g = 0;
+        for (; table->name[g] && g < sizeof (guard) - 1; g++)
+          guard[g] = (char)toupper ((unsigned char)table->name[g]);
+        guard[g] = '\0';
+
+        printf ("#ifndef %s_PERFECT_H\n#define %s_PERFECT_H\n\n", guard,
+                guard);
+        printf ("#include <stdint.h>\n\n");
+        printf ("static const struct\n{\n  uint32_t key;\n  %s%svalue;\n}"
+                " %s_perfect[%d] = {\n",
+                table->value_type, is_pointer (table->value_type) ? "" : " ",
+                table->name, 1 << bits);
+        for (int s = 0; s < (1 << bits); s++)
+          {
+            // empty slots hold the fallback, so a key mismatch and an
+            // unused slot give the same answer
+            if (slots[s] == -1)
+              printf ("  { 0x%08xu, %s },\n", (unsigned)~0u, table->fallback);
+            else
+              printf ("  { 0x%08xu, %s }, /* %s */\n",
+                      (unsigned)table->entries[slots[s]].key,
+                      table->entries[slots[s]].value,
+                      table->entries[slots[s]].key_name);
+          }
+        printf ("};\n\n");
+        printf ("static inline %s\n%s_lookup (uint32_t key)\n{\n",
+                table->value_type, table->name);
+        printf ("  uint32_t slot = (uint32_t)((key ^ (key >> 15)) * 0x%08xu)"
+                " >> %d;\n",
+                (unsigned)mult, 32 - bits);
+        printf ("  return %s_perfect[slot].key == key ? "
+                "%s_perfect[slot].value\n"
+                "                                    : %s;\n}\n\n",
+                table->name, table->name, table->fallback);
+        printf ("#endif // %s_PERFECT_H\n", guard);
+
+        return 0;
+      }
+
+  fprintf (stderr, "No perfect hash found for %s.\n", table->name);
+  return -1;
+}
+
+int
+main (int argc, char **argv)
+{
+  if (argc != 2)
+    {
+      fprintf (stderr, "Usage: %s <table>\n", argv[0]);
+      return 1;
+    }
+
+  for (size_t i = 0; i < sizeof (tables) / sizeof (tables[0]); i++)
+    if (strcmp (tables[i].name, argv[1]) == 0)
+      return emit_table (&tables[i]) != 0;
+
+  fprintf (stderr, "Unknown table: %s\n", argv[1]);
+  return 1;
+}